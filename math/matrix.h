@@ -222,6 +222,21 @@ template <typename Float, int N, int Options = Eigen::ColMajor> struct Matrix {
     return mat_[idx];
   }
 
+  const Vector &operator[](int idx) const
+  {
+    return mat_[idx];
+  }
+
+  bool operator==(const Matrix &b) const
+  {
+    for (int i = 0; i < N; i++) {
+      if (mat_[i] != b.mat_[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
   int size()
   {
     return N;
@@ -280,6 +295,17 @@ private:
   }
 };
 
+/** Combines the hashes of the rows. */
+template <typename Float, int N, int Options>
+inline hash::HashInt hash(const Matrix<Float, N, Options> &m)
+{
+  hash::HashInt h = hash(m[0]);
+  for (int i = 1; i < N; i++) {
+    h = hash::hash_combine(h, hash(m[i]));
+  }
+  return h;
+}
+
 using mat3 = Matrix<double, 3>;
 using mat4 = Matrix<double, 4>;
 
@@ -19,6 +19,7 @@
 #include <utility>
 
 #include "util/compiler_util.h"
+#include "util/hash.h"
 #include "util/type_tags.h"
 
 namespace litestl::math {
@@ -124,6 +125,23 @@ public:
     return vec_[idx];
   }
 
+  /** True when all components compare equal. */
+  inline constexpr bool operator==(const Vec &b) const
+  {
+    for (int i = 0; i < vec_size; i++) {
+      if (!(vec_[i] == b.vec_[i])) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  inline constexpr bool operator!=(const Vec &b) const
+  {
+    return !(*this == b);
+  }
+
 /**
  * Defines component-wise arithmetic operators for a given operator symbol.
  *
@@ -362,6 +380,16 @@ private:
   T vec_[vec_size];
 };
 
+/** Combines the hashes of the components, so float -0.0 and 0.0 hash alike. */
+template <typename T, int vec_size> inline hash::HashInt hash(const Vec<T, vec_size> &v)
+{
+  hash::HashInt h = hash::hash(v[0]);
+  for (int i = 1; i < vec_size; i++) {
+    h = hash::hash_combine(h, hash::hash(v[i]));
+  }
+  return h;
+}
+
 #ifdef DEF_VECS
 #undef DEF_VECS
 #endif
@@ -0,0 +1,304 @@
+#include "platform/memory.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif !defined(WASM)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace litestl::platform {
+static uintptr_t align_up(uintptr_t n, size_t align)
+{
+  return (n + align - 1) & ~uintptr_t(align - 1);
+}
+
+#if defined(_WIN32)
+size_t page_size()
+{
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return info.dwPageSize;
+}
+
+size_t huge_page_size()
+{
+  return 0;
+}
+
+void *map_pages(size_t size, size_t align, unsigned /*hints*/)
+{
+  /* VirtualAlloc already aligns to the allocation granularity (64kb). */
+  void *mem = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+  if (!mem || (uintptr_t(mem) & (align - 1)) == 0) {
+    return mem;
+  }
+
+  /* Reserve an oversized range to find an aligned address, then map into it. */
+  VirtualFree(mem, 0, MEM_RELEASE);
+
+  for (int attempt = 0; attempt < 8; attempt++) {
+    void *probe = VirtualAlloc(nullptr, size + align, MEM_RESERVE, PAGE_NOACCESS);
+    if (!probe) {
+      return nullptr;
+    }
+
+    VirtualFree(probe, 0, MEM_RELEASE);
+    void *aligned = reinterpret_cast<void *>(align_up(uintptr_t(probe), align));
+    mem = VirtualAlloc(aligned, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if (mem) {
+      return mem;
+    }
+  }
+
+  return nullptr;
+}
+
+void unmap_pages(void *ptr, size_t /*size*/)
+{
+  VirtualFree(ptr, 0, MEM_RELEASE);
+}
+
+void *remap_pages(void * /*ptr*/,
+                  size_t /*old_size*/,
+                  size_t /*new_size*/,
+                  size_t /*align*/,
+                  unsigned /*hints*/)
+{
+  return nullptr;
+}
+
+void *reserve_pages(size_t size)
+{
+  return VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+}
+
+bool commit_pages(void *ptr, size_t size)
+{
+  return VirtualAlloc(ptr, size, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+}
+
+void decommit_pages(void *ptr, size_t size)
+{
+  VirtualFree(ptr, size, MEM_DECOMMIT);
+}
+
+void release_pages(void *ptr, size_t /*size*/)
+{
+  VirtualFree(ptr, 0, MEM_RELEASE);
+}
+#elif defined(WASM)
+size_t page_size()
+{
+  return 65536;
+}
+
+size_t huge_page_size()
+{
+  return 0;
+}
+
+void *map_pages(size_t size, size_t align, unsigned /*hints*/)
+{
+  align = align < sizeof(void *) ? sizeof(void *) : align;
+  void *mem = aligned_alloc(align, align_up(size, align));
+  if (mem) {
+    memset(mem, 0, size);
+  }
+  return mem;
+}
+
+void unmap_pages(void *ptr, size_t /*size*/)
+{
+  free(ptr);
+}
+
+void *remap_pages(void * /*ptr*/,
+                  size_t /*old_size*/,
+                  size_t /*new_size*/,
+                  size_t /*align*/,
+                  unsigned /*hints*/)
+{
+  return nullptr;
+}
+
+void *reserve_pages(size_t size)
+{
+  return map_pages(size, page_size());
+}
+
+bool commit_pages(void * /*ptr*/, size_t /*size*/)
+{
+  return true;
+}
+
+void decommit_pages(void * /*ptr*/, size_t /*size*/) {}
+
+void release_pages(void *ptr, size_t size)
+{
+  unmap_pages(ptr, size);
+}
+#else
+size_t page_size()
+{
+  static size_t size = size_t(sysconf(_SC_PAGESIZE));
+  return size;
+}
+
+size_t huge_page_size()
+{
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+  static size_t size = []() -> size_t {
+    size_t size = 0;
+
+    if (FILE *file = fopen("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", "r")) {
+      unsigned long long value;
+      if (fscanf(file, "%llu", &value) == 1) {
+        size = size_t(value);
+      }
+      fclose(file);
+    }
+
+    return size;
+  }();
+  return size;
+#else
+  return 0;
+#endif
+}
+
+/** Applies map_pages @p hints to a fresh mapping. */
+static void apply_hints(void *mem, size_t size, unsigned hints)
+{
+#ifdef MADV_HUGEPAGE
+  /* Must precede the first fault for the range to be backed by huge pages. */
+  if (hints & map_huge_pages) {
+    madvise(mem, size, MADV_HUGEPAGE);
+  }
+#endif
+
+  if (hints & map_populate) {
+#ifdef MADV_POPULATE_WRITE
+    if (madvise(mem, size, MADV_POPULATE_WRITE) == 0) {
+      return;
+    }
+#endif
+    /* Older kernels: write fault every page. */
+    const size_t page = page_size();
+    for (size_t offset = 0; offset < size; offset += page) {
+      static_cast<volatile char *>(mem)[offset] = 0;
+    }
+  }
+}
+
+void *map_pages(size_t size, size_t align, unsigned hints)
+{
+  const size_t page = page_size();
+  if (align <= page) {
+    void *mem =
+        mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+      return nullptr;
+    }
+
+    apply_hints(mem, size, hints);
+    return mem;
+  }
+
+  /* Over-map, then trim the unaligned head and the tail. */
+  size_t map_size = size + align - page;
+  void *mem =
+      mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mem == MAP_FAILED) {
+    return nullptr;
+  }
+
+  uintptr_t start = uintptr_t(mem);
+  uintptr_t aligned = align_up(start, align);
+  size_t head = aligned - start;
+  size_t tail = map_size - head - size;
+
+  if (head) {
+    munmap(mem, head);
+  }
+  if (tail) {
+    munmap(reinterpret_cast<void *>(aligned + size), tail);
+  }
+
+  apply_hints(reinterpret_cast<void *>(aligned), size, hints);
+  return reinterpret_cast<void *>(aligned);
+}
+
+void unmap_pages(void *ptr, size_t size)
+{
+  munmap(ptr, size);
+}
+
+void *remap_pages(
+    void *ptr, size_t old_size, size_t new_size, size_t align, unsigned hints)
+{
+#ifdef __linux__
+  /* Shrinking always succeeds in place, growing does if the following range is free. */
+  void *mem = mremap(ptr, old_size, new_size, 0);
+  if (mem != MAP_FAILED) {
+    return mem;
+  }
+
+  /* Move the pages into the head of a fresh aligned range, the page tables move
+   * instead of the data. */
+  void *dst = map_pages(new_size, align, hints & ~map_populate);
+  if (!dst) {
+    return nullptr;
+  }
+
+  mem = mremap(ptr, old_size, old_size, MREMAP_MAYMOVE | MREMAP_FIXED, dst);
+  if (mem == MAP_FAILED) {
+    munmap(dst, new_size);
+    return nullptr;
+  }
+
+  return dst;
+#else
+  (void)ptr;
+  (void)old_size;
+  (void)new_size;
+  (void)align;
+  (void)hints;
+  return nullptr;
+#endif
+}
+
+void *reserve_pages(size_t size)
+{
+  void *mem =
+      mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  return mem == MAP_FAILED ? nullptr : mem;
+}
+
+bool commit_pages(void *ptr, size_t size)
+{
+  return mprotect(ptr, size, PROT_READ | PROT_WRITE) == 0;
+}
+
+void decommit_pages(void *ptr, size_t size)
+{
+  /* Mapping over the range drops its pages and makes it inaccessible again. */
+  mmap(ptr,
+       size,
+       PROT_NONE,
+       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED,
+       -1,
+       0);
+}
+
+void release_pages(void *ptr, size_t size)
+{
+  munmap(ptr, size);
+}
+#endif
+} // namespace litestl::platform
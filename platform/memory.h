@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+
+/** Virtual memory primitives used by the allocator. */
+namespace litestl::platform {
+/** Returns the OS virtual memory page size. */
+size_t page_size();
+/** Returns the transparent huge page size, or 0 if the platform has none. */
+size_t huge_page_size();
+
+/** Hints for map_pages, ignored where unsupported. */
+enum MapHints : unsigned {
+  map_default = 0,
+  /** Back the range with transparent huge pages (align it to huge_page_size()). */
+  map_huge_pages = 1 << 0,
+  /** Fault all pages in up front instead of on first touch. */
+  map_populate = 1 << 1,
+};
+
+/**
+ * Maps @p size bytes of zeroed, read-write memory directly from the OS.
+ * @p align must be a power of two; the result is aligned to at least
+ * max(@p align, page_size()). Returns nullptr on failure.
+ */
+void *map_pages(size_t size, size_t align, unsigned hints = map_default);
+
+/**
+ * Returns memory obtained from map_pages to the OS.  @p size must match the
+ * mapped size.
+ */
+void unmap_pages(void *ptr, size_t size);
+
+/**
+ * Resizes a map_pages mapping of @p old_size bytes to @p new_size without
+ * copying, moving it to a new @p align aligned address if it can't grow in
+ * place.  Added pages are zeroed; @p hints apply to a newly mapped range.
+ * Returns nullptr if the platform can't remap (only Linux can), in which case
+ * @p ptr is left untouched.
+ */
+void *remap_pages(void *ptr, size_t old_size, size_t new_size, size_t align,
+                  unsigned hints = map_default);
+
+/**
+ * Reserves @p size bytes (a multiple of page_size()) of address space without
+ * backing memory.  The range is inaccessible until committed.  Returns
+ * nullptr on failure.  WASM has no virtual memory, there the whole range is
+ * allocated up front.
+ */
+void *reserve_pages(size_t size);
+/**
+ * Makes page aligned [@p ptr, @p ptr + @p size) of a reserved range readable
+ * and writable.  Pages read as zero and only take memory once touched.
+ * Returns false if the OS refuses.
+ */
+bool commit_pages(void *ptr, size_t size);
+/** Returns committed pages to the OS, leaving them reserved but inaccessible. */
+void decommit_pages(void *ptr, size_t size);
+/** Frees a range obtained from reserve_pages, @p size must match the reserved size. */
+void release_pages(void *ptr, size_t size);
+} // namespace litestl::platform
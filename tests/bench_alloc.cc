@@ -0,0 +1,174 @@
+#include "bench_util.h"
+#include "litestl/util/alloc.h"
+#include "litestl/util/map.h"
+#include "litestl/util/pool.h"
+#include "litestl/util/string.h"
+#include "litestl/util/vector.h"
+
+#include <cstdlib>
+#include <thread>
+
+/*
+ * Compares alloc::alloc against plain malloc on allocation patterns taken from
+ * Vector/Map growth, and times container-heavy loops.  Build once as is and once
+ * with -DNO_DEBUG_ALLOC to compare the tracked and untracked paths.
+ */
+
+using namespace litestl;
+using namespace litestl::util;
+
+static constexpr int iterations = 20000;
+
+/* Sizes a Vector<int> passes through while growing to @p count elements. */
+template <typename Alloc, typename Free> static void vector_growth(Alloc a, Free f)
+{
+  for (int i = 0; i < iterations; i++) {
+    size_t capacity = 1;
+    void *mem = nullptr;
+    int count = 16 + (i & 255);
+
+    for (int size = 0; size < count; size++) {
+      if (size_t(size + 1) >= capacity) {
+        capacity = ((size + 2) << 1) - ((size + 1) >> 1);
+        void *mem2 = a(capacity * sizeof(int));
+        if (mem) {
+          memcpy(mem2, mem, size * sizeof(int));
+          f(mem);
+        }
+        mem = mem2;
+      }
+      static_cast<int *>(mem)[size] = size;
+    }
+
+    f(mem);
+  }
+}
+
+static void vector_loop()
+{
+  for (int i = 0; i < iterations; i++) {
+    Vector<int> list;
+    Vector<string> names;
+
+    for (int j = 0; j < 16 + (i & 127); j++) {
+      list.append(j);
+    }
+    for (int j = 0; j < 8; j++) {
+      names.append("a string long enough to need the heap");
+    }
+
+    bench_keep(list);
+    bench_keep(names);
+  }
+}
+
+static void map_loop()
+{
+  for (int i = 0; i < iterations / 10; i++) {
+    Map<int, int> map;
+
+    for (int j = 0; j < 256; j++) {
+      map.add(j * 7, j);
+    }
+
+    bench_keep(map);
+  }
+}
+
+/* Refcount-block sized objects, a window of 64 alive at a time. */
+struct ControlBlock {
+  int users;
+  void *ptr;
+  void *weak[2];
+};
+
+template <typename New, typename Delete>
+static void object_churn(New make, Delete destroy)
+{
+  ControlBlock *window[64] = {};
+
+  for (int i = 0; i < iterations * 20; i++) {
+    ControlBlock *&slot = window[(i * 7) & 63];
+    if (slot) {
+      destroy(slot);
+    }
+    slot = make();
+    slot->users = i;
+  }
+
+  for (ControlBlock *block : window) {
+    if (block) {
+      destroy(block);
+    }
+  }
+}
+
+template <typename Fn> static void threaded(Fn fn, int thread_count)
+{
+  std::thread *threads[64];
+
+  for (int i = 0; i < thread_count; i++) {
+    threads[i] = new std::thread(fn);
+  }
+  for (int i = 0; i < thread_count; i++) {
+    threads[i]->join();
+    delete threads[i];
+  }
+}
+
+int main()
+{
+  auto sys_alloc = [](size_t size) { return malloc(size); };
+  auto sys_free = [](void *mem) { free(mem); };
+  auto lt_alloc = [](size_t size) { return alloc::alloc("bench", size); };
+  auto lt_free = [](void *mem) { alloc::release(mem); };
+
+#ifdef NO_DEBUG_ALLOC
+  printf("alloc mode: untracked\n");
+#else
+  printf("alloc mode: tracked\n");
+#endif
+
+  bench_run("vector growth trace, malloc", [&]() { vector_growth(sys_alloc, sys_free); });
+  bench_run("vector growth trace, alloc::alloc",
+            [&]() { vector_growth(lt_alloc, lt_free); });
+
+  bench_run("vector growth trace x4 threads, malloc", [&]() {
+    threaded([&]() { vector_growth(sys_alloc, sys_free); }, 4);
+  });
+  bench_run("vector growth trace x4 threads, alloc::alloc", [&]() {
+    threaded([&]() { vector_growth(lt_alloc, lt_free); }, 4);
+  });
+
+  bench_run("small object churn, alloc::New", []() {
+    object_churn([]() { return alloc::New<ControlBlock>("control block"); },
+                 [](ControlBlock *block) { alloc::Delete(block); });
+  });
+  bench_run("small object churn, alloc::Pool", []() {
+    alloc::Pool<ControlBlock> pool("control blocks");
+    object_churn([&]() { return pool.New(); },
+                 [&](ControlBlock *block) { pool.Delete(block); });
+  });
+  bench_run("small object churn x4 threads, thread-caching Pool", []() {
+    alloc::Pool<ControlBlock, true> pool("control blocks");
+    threaded(
+        [&]() {
+          object_churn([&]() { return pool.New(); },
+                       [&](ControlBlock *block) { pool.Delete(block); });
+        },
+        4);
+  });
+
+  bench_run("Vector<int>/Vector<string> loop", vector_loop);
+  bench_run("Map<int, int> loop", map_loop);
+  bench_run("Vector/Map loop x4 threads", []() {
+    threaded(
+        []() {
+          vector_loop();
+          map_loop();
+        },
+        4);
+  });
+
+  return 0;
+}
@@ -0,0 +1,185 @@
+#include "bench_util.h"
+#include "litestl/platform/cpu.h"
+#include "litestl/util/concurrent_map.h"
+#include "litestl/util/map.h"
+#include "litestl/util/vector.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+
+using namespace litestl;
+using namespace litestl::util;
+
+/*
+ * ConcurrentMap against a Map behind one mutex, from 1 to N threads (the core
+ * count, or the first argument).  Each thread does the same number of
+ * operations, so perfect scaling keeps the time constant as threads are
+ * added.
+ *
+ *   read-mostly: 90% lookups, 10% overwrites of random keys of a full map
+ *   inserts:     every thread adds its own keys to an empty map
+ */
+
+static constexpr int key_count = 1 << 20;
+static constexpr int ops_per_thread = 1 << 19;
+
+static uint64_t next_random(uint64_t &state)
+{
+  /* splitmix64 */
+  uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+template <typename Fn> static void threaded(int thread_count, Fn fn)
+{
+  Vector<std::thread *> threads;
+  for (int t = 0; t < thread_count; t++) {
+    threads.append(new std::thread([&fn, t]() { fn(t); }));
+  }
+  for (std::thread *thread : threads) {
+    thread->join();
+    delete thread;
+  }
+}
+
+/** The current practice: a Map with one mutex around every call. */
+struct LockedMap {
+  std::mutex mutex;
+  Map<int, int> map;
+
+  bool lookup(int key, int *r_value)
+  {
+    std::lock_guard guard(mutex);
+    if (const int *value = map.lookup_ptr(key)) {
+      *r_value = *value;
+      return true;
+    }
+    return false;
+  }
+
+  void add_overwrite(int key, int value)
+  {
+    std::lock_guard guard(mutex);
+    map.add_overwrite(key, value);
+  }
+
+  void add(int key, int value)
+  {
+    std::lock_guard guard(mutex);
+    map.add(key, value);
+  }
+};
+
+template <typename MapT> static void read_mostly(MapT &map, int thread_count)
+{
+  threaded(thread_count, [&](int t) {
+    uint64_t state = uint64_t(t + 1);
+    int64_t sum = 0;
+
+    for (int i = 0; i < ops_per_thread; i++) {
+      const uint64_t r = next_random(state);
+      const int key = int(r % key_count);
+
+      if ((r >> 40) % 10 == 0) {
+        map.add_overwrite(key, i);
+      } else {
+        int value;
+        sum += map.lookup(key, &value) ? value : 0;
+      }
+    }
+    bench_keep(sum);
+  });
+}
+
+template <typename MapT> static void inserts(MapT &map, int thread_count)
+{
+  threaded(thread_count, [&](int t) {
+    uint64_t state = uint64_t(t + 1) << 32;
+
+    for (int i = 0; i < ops_per_thread; i++) {
+      map.add(int(next_random(state) >> 33), i);
+    }
+  });
+}
+
+int main(int argc, char **argv)
+{
+  const int max_threads = argc > 1 ? atoi(argv[1]) : platform::cpu_core_count();
+
+  Vector<int> thread_counts;
+  for (int n = 1; n < max_threads; n *= 2) {
+    thread_counts.append(n);
+  }
+  thread_counts.append(max_threads);
+
+  LockedMap locked;
+  ConcurrentMap<int, int> concurrent;
+  for (int i = 0; i < key_count; i++) {
+    locked.map.add(i, i);
+    concurrent.add(i, i);
+  }
+
+  printf("read-mostly, %d keys, %d ops per thread\n", key_count, ops_per_thread);
+  double locked_base = 0.0, concurrent_base = 0.0;
+
+  for (int n : thread_counts) {
+    char name[96];
+
+    snprintf(name, sizeof(name), "Map + mutex, %d threads", n);
+    const double locked_ms = bench_run(name, [&]() { read_mostly(locked, n); }, 3);
+
+    snprintf(name, sizeof(name), "ConcurrentMap, %d threads", n);
+    const double concurrent_ms = bench_run(
+        name, [&]() { read_mostly(concurrent, n); }, 3);
+
+    if (n == 1) {
+      locked_base = locked_ms;
+      concurrent_base = concurrent_ms;
+    }
+
+    /* Speedup over one thread: total work grew n times. */
+    printf("  scaling: Map + mutex %.2fx, ConcurrentMap %.2fx\n",
+           locked_base * n / locked_ms,
+           concurrent_base * n / concurrent_ms);
+  }
+
+  printf("\ninserts into an empty map, %d per thread\n", ops_per_thread);
+
+  for (int n : thread_counts) {
+    char name[96];
+
+    snprintf(name, sizeof(name), "Map + mutex, %d threads", n);
+    const double locked_ms = bench_run(
+        name,
+        [&]() {
+          LockedMap map;
+          inserts(map, n);
+        },
+        3);
+
+    snprintf(name, sizeof(name), "ConcurrentMap, %d threads", n);
+    const double concurrent_ms = bench_run(
+        name,
+        [&]() {
+          ConcurrentMap<int, int> map;
+          inserts(map, n);
+        },
+        3);
+
+    if (n == 1) {
+      locked_base = locked_ms;
+      concurrent_base = concurrent_ms;
+    }
+
+    printf("  scaling: Map + mutex %.2fx, ConcurrentMap %.2fx\n",
+           locked_base * n / locked_ms,
+           concurrent_base * n / concurrent_ms);
+  }
+
+  return 0;
+}
@@ -0,0 +1,114 @@
+#include "bench_util.h"
+#include "litestl/math/vector.h"
+#include "litestl/util/simd_find.h"
+#include "litestl/util/vector.h"
+
+#include <cstdint>
+#include <cstdio>
+
+using namespace litestl;
+using namespace litestl::math;
+using namespace litestl::util;
+
+/*
+ * simd::find and simd::count against the plain == loops they replace, for a
+ * value that isn't present (so every search scans the whole array).  Build
+ * with -mavx2 to get the AVX2 path, SSE2 is the x86-64 default.
+ */
+
+template <typename T> static IndexInt scalar_find(const Vector<T> &vec, const T &value)
+{
+  for (int i = 0; i < int(vec.size()); i++) {
+    if (vec[i] == value) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+template <typename T> static size_t scalar_count(const Vector<T> &vec, const T &value)
+{
+  size_t total = 0;
+  for (int i = 0; i < int(vec.size()); i++) {
+    total += vec[i] == value;
+  }
+  return total;
+}
+
+template <typename T, typename Make>
+static void bench_type(const char *label, Make make, int size)
+{
+  Vector<T> vec;
+  for (int i = 0; i < size; i++) {
+    vec.append(make(i));
+  }
+
+  const T missing = make(-1);
+  const std::span<const T> items(vec.data(), vec.size());
+  /* Same amount of work per size. */
+  const int repeat = std::max((1 << 26) / size, 1);
+  char name[96];
+
+  printf("\n%s, %d elements x %d searches\n", label, size, repeat);
+
+  IndexInt found = 0;
+  snprintf(name, sizeof(name), "scalar find");
+  const double base_find = bench_run(name, [&]() {
+    for (int r = 0; r < repeat; r++) {
+      found += scalar_find(vec, missing);
+    }
+    bench_keep(found);
+  });
+
+  snprintf(name, sizeof(name), "simd::find");
+  const double simd_find = bench_run(name, [&]() {
+    for (int r = 0; r < repeat; r++) {
+      found += simd::find(items, missing);
+    }
+    bench_keep(found);
+  });
+
+  size_t total = 0;
+  snprintf(name, sizeof(name), "scalar count");
+  const double base_count = bench_run(name, [&]() {
+    for (int r = 0; r < repeat; r++) {
+      total += scalar_count(vec, missing);
+    }
+    bench_keep(total);
+  });
+
+  snprintf(name, sizeof(name), "simd::count");
+  const double simd_count = bench_run(name, [&]() {
+    for (int r = 0; r < repeat; r++) {
+      total += simd::count(items, missing);
+    }
+    bench_keep(total);
+  });
+
+  printf("  speedup: %.2fx find, %.2fx count\n",
+         base_find / simd_find,
+         base_count / simd_count);
+}
+
+int main()
+{
+#if defined(LITESTL_SIMD_FIND_AVX2)
+  printf("AVX2\n");
+#elif defined(LITESTL_SIMD_FIND_SSE2)
+  printf("SSE2\n");
+#else
+  printf("scalar\n");
+#endif
+
+  for (int size : {64, 4096, 1 << 20}) {
+    bench_type<int>("int", [](int i) { return i; }, size);
+  }
+  bench_type<uint8_t>(
+      "uint8_t", [](int i) { return uint8_t(i < 0 ? 255 : i % 255); }, 4096);
+  bench_type<int64_t>("int64_t", [](int i) { return int64_t(i); }, 4096);
+  bench_type<void *>("pointer", [](int i) { return (void *)(intptr_t(i) * 16); }, 4096);
+  bench_type<float>("float", [](int i) { return float(i); }, 4096);
+  bench_type<float2>("float2", [](int i) { return float2(float(i)); }, 4096);
+
+  return 0;
+}
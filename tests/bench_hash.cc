@@ -0,0 +1,215 @@
+#include "bench_util.h"
+#include "litestl/util/hash.h"
+#include "litestl/util/map.h"
+#include "litestl/util/string.h"
+#include "litestl/util/vector.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+
+using namespace litestl;
+using namespace litestl::util;
+
+/*
+ * hash::hash against the hashes it replaced: throughput on strings of
+ * various sizes, and how well keys with a common structure (numbered names,
+ * aligned integers and pointers) spread over a power of two table.
+ */
+
+namespace legacy {
+static hash::HashInt hash_string(const char *str)
+{
+  hash::HashInt h = 0;
+  for (const char *c = str; *c; c++) {
+    h = ((h + *c) * (*c) + 23423432) & ((1 << 19) - 1);
+  }
+  return h;
+}
+
+static hash::HashInt hash_int(int64_t i)
+{
+  return hash::HashInt(i);
+}
+
+static hash::HashInt hash_pointer(const void *ptr)
+{
+  return hash::HashInt(reinterpret_cast<uintptr_t>(ptr)) << 16;
+}
+
+/** String key that hashes like the old hash(const char *), found by hash_of(). */
+struct Key {
+  stringref str;
+
+  bool operator==(const Key &b) const
+  {
+    return str == b.str;
+  }
+};
+
+static hash::HashInt hash(const Key &key)
+{
+  return hash_string(key.str.c_str());
+}
+} // namespace legacy
+
+static void bench_throughput()
+{
+  printf("\nthroughput\n");
+
+  /* Room for the largest size plus a terminator for the legacy hash. */
+  Vector<char> buffer;
+  buffer.resize((1 << 16) + 1);
+  for (int i = 0; i < int(buffer.size()); i++) {
+    buffer[i] = char('a' + i % 26);
+  }
+
+  for (int size : {4, 8, 16, 32, 64, 256, 4096, 1 << 16}) {
+    const int count = std::max((1 << 24) / std::max(size, 16), 1);
+    buffer[size] = 0;
+    hash::HashInt sum = 0;
+    char name[96];
+
+    snprintf(name, sizeof(name), "legacy string hash, %d bytes", size);
+    const double old_ms = bench_run(
+        name,
+        [&]() {
+          for (int i = 0; i < count; i++) {
+            buffer[0] = char(i);
+            sum += legacy::hash_string(buffer.data());
+          }
+          bench_keep(sum);
+        },
+        3);
+
+    snprintf(name, sizeof(name), "hash::hash_bytes, %d bytes", size);
+    const double new_ms = bench_run(
+        name,
+        [&]() {
+          for (int i = 0; i < count; i++) {
+            buffer[0] = char(i);
+            sum += hash::hash_bytes(buffer.data(), size_t(size));
+          }
+          bench_keep(sum);
+        },
+        3);
+
+    buffer[size] = char('a' + size % 26);
+    printf("  %.2f GB/s, %.1fx legacy\n",
+           double(size) * count / (new_ms * 1e6),
+           old_ms / new_ms);
+  }
+}
+
+/** Prints how many distinct hashes and table buckets @p hashes hit. */
+static void report_spread(const char *label,
+                          Vector<hash::HashInt> &hashes,
+                          int bucket_bits)
+{
+  const hash::HashInt mask = (hash::HashInt(1) << bucket_bits) - 1;
+  Vector<hash::HashInt> buckets;
+  for (hash::HashInt h : hashes) {
+    buckets.append(h & mask);
+  }
+
+  auto distinct = [](Vector<hash::HashInt> &values) {
+    std::sort(values.begin(), values.end());
+    return std::unique(values.begin(), values.end()) - values.begin();
+  };
+
+  const size_t count = hashes.size();
+  const size_t unique_hashes = size_t(distinct(hashes));
+  const size_t used_buckets = size_t(distinct(buckets));
+
+  /* With random hashes, the keys occupy 1 - e^(-keys / buckets) of the buckets. */
+  printf("%-48s %8zu of %zu hashes distinct, %8zu buckets used of 2^%d\n",
+         label,
+         unique_hashes,
+         count,
+         used_buckets,
+         bucket_bits);
+}
+
+static void bench_collisions()
+{
+  constexpr int count = 1 << 20;
+  printf("\ncollisions, %d keys, low bits as bucket index\n", count);
+
+  Vector<hash::HashInt> old_hashes, new_hashes;
+  char name[32];
+
+  for (int i = 0; i < count; i++) {
+    snprintf(name, sizeof(name), "item_%d", i);
+    old_hashes.append(legacy::hash_string(name));
+    new_hashes.append(hash::hash(static_cast<const char *>(name)));
+  }
+  report_spread("legacy, strings \"item_N\"", old_hashes, 20);
+  report_spread("hash::hash, strings \"item_N\"", new_hashes, 20);
+
+  old_hashes.clear();
+  new_hashes.clear();
+  for (int i = 0; i < count; i++) {
+    old_hashes.append(legacy::hash_int(int64_t(i) << 20));
+    new_hashes.append(hash::hash(int64_t(i) << 20));
+  }
+  report_spread("legacy, integers N << 20", old_hashes, 20);
+  report_spread("hash::hash, integers N << 20", new_hashes, 20);
+
+  old_hashes.clear();
+  new_hashes.clear();
+  for (int i = 0; i < count; i++) {
+    const void *ptr = reinterpret_cast<const void *>(uintptr_t(0x7f0000000000ull) +
+                                                     uintptr_t(i) * 64);
+    old_hashes.append(legacy::hash_pointer(ptr));
+    new_hashes.append(hash::hash(ptr));
+  }
+  report_spread("legacy, pointers 64 bytes apart", old_hashes, 20);
+  report_spread("hash::hash, pointers 64 bytes apart", new_hashes, 20);
+}
+
+/* Map<stringref> with both hashes, on strings too many for 19 bits. */
+static void bench_string_map()
+{
+  constexpr int count = 1 << 20;
+  printf("\nMap with %d string keys\n", count);
+
+  Vector<string> names;
+  char name[32];
+  for (int i = 0; i < count; i++) {
+    snprintf(name, sizeof(name), "item_%d", i);
+    names.append(string(name));
+  }
+
+  Map<legacy::Key, int> old_map;
+  Map<stringref, int> new_map;
+  for (int i = 0; i < count; i++) {
+    old_map.add(legacy::Key{stringref(names[i].c_str())}, i);
+    new_map.add(stringref(names[i].c_str()), i);
+  }
+
+  int64_t sum = 0;
+  const double old_ms = bench_run("legacy hash, Map lookups", [&]() {
+    for (const string &key : names) {
+      sum += *old_map.lookup_ptr(legacy::Key{stringref(key.c_str())});
+    }
+    bench_keep(sum);
+  });
+
+  const double new_ms = bench_run("hash::hash, Map lookups", [&]() {
+    for (const string &key : names) {
+      sum += *new_map.lookup_ptr(stringref(key.c_str()));
+    }
+    bench_keep(sum);
+  });
+
+  printf("  speedup: %.2fx\n", old_ms / new_ms);
+}
+
+int main()
+{
+  bench_throughput();
+  bench_collisions();
+  bench_string_map();
+
+  return 0;
+}
@@ -0,0 +1,175 @@
+#include "bench_util.h"
+#include "litestl/util/map.h"
+#include "litestl/util/set.h"
+#include "litestl/util/string.h"
+#include "litestl/util/vector.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <unordered_map>
+
+using namespace litestl;
+using namespace litestl::util;
+
+/*
+ * Map and Set insert, lookup and remove, with std::unordered_map on the same
+ * keys for reference.  Sizes go from cache resident to well past the last
+ * level cache.
+ */
+
+static uint64_t next_random(uint64_t &state)
+{
+  /* splitmix64 */
+  uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+static void bench_size(int size)
+{
+  uint64_t state = uint64_t(size);
+  Vector<int> keys, misses;
+
+  for (int i = 0; i < size; i++) {
+    /* Even keys are present, odd ones are misses. */
+    keys.append(int(next_random(state) >> 33) & ~1);
+    misses.append(int(next_random(state) >> 33) | 1);
+  }
+
+  printf("\nint keys, %d elements\n", size);
+
+  std::unordered_map<int, int> std_map;
+  const double std_insert = bench_run("std::unordered_map insert", [&]() {
+    std_map = std::unordered_map<int, int>();
+    for (int key : keys) {
+      std_map.emplace(key, key);
+    }
+    bench_keep(std_map);
+  });
+
+  Map<int, int> map;
+  const double insert = bench_run("Map::add", [&]() {
+    map = Map<int, int>();
+    for (int key : keys) {
+      map.add(key, key);
+    }
+    bench_keep(map);
+  });
+
+  int64_t sum = 0;
+  const double std_hit = bench_run("std::unordered_map lookup, hits", [&]() {
+    sum = 0;
+    for (int key : keys) {
+      sum += std_map.find(key)->second;
+    }
+    bench_keep(sum);
+  });
+
+  const double hit = bench_run("Map::lookup_ptr, hits", [&]() {
+    sum = 0;
+    for (int key : keys) {
+      sum += *map.lookup_ptr(key);
+    }
+    bench_keep(sum);
+  });
+
+  const double std_miss = bench_run("std::unordered_map lookup, misses", [&]() {
+    sum = 0;
+    for (int key : misses) {
+      sum += std_map.count(key);
+    }
+    bench_keep(sum);
+  });
+
+  const double miss = bench_run("Map::contains, misses", [&]() {
+    sum = 0;
+    for (int key : misses) {
+      sum += map.contains(key);
+    }
+    bench_keep(sum);
+  });
+
+  /* Removes and re-adds the first half, leaving the table as it was. */
+  const double remove = bench_run("Map::remove + add", [&]() {
+    for (int i = 0; i < size / 2; i++) {
+      map.remove(keys[i]);
+    }
+    for (int i = 0; i < size / 2; i++) {
+      map.add(keys[i], keys[i]);
+    }
+    bench_keep(map);
+  });
+
+  Set<int> set;
+  bench_run("Set::add", [&]() {
+    set = Set<int>();
+    for (int key : keys) {
+      set.add(key);
+    }
+    bench_keep(set);
+  });
+
+  bench_run("Set::contains, hits", [&]() {
+    sum = 0;
+    for (int key : keys) {
+      sum += set.contains(key);
+    }
+    bench_keep(sum);
+  });
+
+  printf("  vs std::unordered_map: %.2fx insert, %.2fx hits, %.2fx misses (remove + add "
+         "%.3f ms)\n",
+         std_insert / insert,
+         std_hit / hit,
+         std_miss / miss,
+         remove);
+}
+
+/* Map<string> searched with C strings: converted to a string first, or as is. */
+static void bench_string_keys(int size)
+{
+  Vector<string> names;
+  char name[96];
+  for (int i = 0; i < size; i++) {
+    snprintf(name, sizeof(name), "a key too long to be stored inside a string, %d", i);
+    names.append(string(name));
+  }
+
+  Map<string, int> map;
+  for (int i = 0; i < size; i++) {
+    map.add(names[i], i);
+  }
+
+  printf("\nstring keys, %d elements\n", size);
+
+  int64_t sum = 0;
+  const double converted = bench_run("Map::lookup_ptr(string(c_str))", [&]() {
+    for (const string &key : names) {
+      sum += *map.lookup_ptr(string(key.c_str()));
+    }
+    bench_keep(sum);
+  });
+
+  const double transparent = bench_run("Map::lookup_ptr(c_str)", [&]() {
+    for (const string &key : names) {
+      sum += *map.lookup_ptr(key.c_str());
+    }
+    bench_keep(sum);
+  });
+
+  printf("  speedup: %.2fx\n", converted / transparent);
+}
+
+int main()
+{
+  for (int size : {1 << 10, 1 << 16, 1 << 20, 1 << 22}) {
+    bench_size(size);
+  }
+
+  for (int size : {1 << 10, 1 << 16, 1 << 20}) {
+    bench_string_keys(size);
+  }
+
+  return 0;
+}
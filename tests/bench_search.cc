@@ -0,0 +1,110 @@
+#include "bench_util.h"
+#include "litestl/util/search_index.h"
+#include "litestl/util/vector.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+
+using namespace litestl;
+using namespace litestl::util;
+
+/*
+ * SearchIndex against std::lower_bound on the same sorted table, from cache
+ * resident sizes up to tables well past the last level cache.
+ */
+
+static uint64_t next_random(uint64_t &state)
+{
+  /* splitmix64 */
+  uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+template <typename T> static T random_key(uint64_t &state)
+{
+  if constexpr (std::is_floating_point_v<T>) {
+    return T(double(next_random(state) >> 11) / double(uint64_t(1) << 53));
+  } else {
+    return T(next_random(state) >> 33);
+  }
+}
+
+template <typename T> static void bench_size(const char *label, int size, int query_count)
+{
+  uint64_t state = uint64_t(size);
+  Vector<T> sorted;
+  Vector<T> queries;
+  Vector<IndexInt> results;
+
+  for (int i = 0; i < size; i++) {
+    sorted.append(random_key<T>(state));
+  }
+  std::sort(sorted.begin(), sorted.end());
+
+  for (int i = 0; i < query_count; i++) {
+    queries.append(random_key<T>(state));
+  }
+  results.resize(query_count);
+
+  SearchIndex<T> index(sorted);
+  char name[96];
+
+  printf("\n%s, %d elements, %d lookups\n", label, size, query_count);
+
+  const T *begin = sorted.data();
+  const T *end = sorted.data() + sorted.size();
+  IndexInt expect = 0;
+
+  snprintf(name, sizeof(name), "std::lower_bound");
+  const double base = bench_run(name, [&]() {
+    expect = 0;
+    for (const T &key : queries) {
+      expect += IndexInt(std::lower_bound(begin, end, key) - begin);
+    }
+    bench_keep(expect);
+  });
+
+  IndexInt sum = 0;
+  snprintf(name, sizeof(name), "SearchIndex::lower_bound");
+  const double single = bench_run(name, [&]() {
+    sum = 0;
+    for (const T &key : queries) {
+      sum += index.lower_bound(key);
+    }
+    bench_keep(sum);
+  });
+  if (sum != expect) {
+    printf("  result mismatch!\n");
+  }
+
+  snprintf(name, sizeof(name), "SearchIndex::lower_bound, batched");
+  const double batched = bench_run(name, [&]() {
+    index.lower_bound(std::span<const T>(queries.data(), queries.size()),
+                      std::span<IndexInt>(results.data(), results.size()));
+    bench_keep(results[0]);
+  });
+  sum = 0;
+  for (IndexInt i : results) {
+    sum += i;
+  }
+  if (sum != expect) {
+    printf("  result mismatch!\n");
+  }
+
+  printf("  speedup over std::lower_bound: %.2fx single, %.2fx batched\n",
+         base / single,
+         base / batched);
+}
+
+int main()
+{
+  for (int size : {1 << 10, 1 << 16, 1 << 20, 1 << 23}) {
+    bench_size<int>("int", size, 1 << 20);
+  }
+  bench_size<float>("float", 1 << 23, 1 << 20);
+
+  return 0;
+}
@@ -0,0 +1,102 @@
+#include "bench_util.h"
+#include "litestl/platform/cpu.h"
+#include "litestl/util/parallel_sort.h"
+#include "litestl/util/radix_sort.h"
+#include "litestl/util/vector.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+using namespace litestl;
+using namespace litestl::util;
+
+/*
+ * Scaling of Vector::parallel_sort against Vector::sort for a few sizes and
+ * thread counts, and radix_sort on the same keys.  Every run sorts a fresh
+ * copy of the same shuffled input.
+ */
+
+struct Record {
+  uint64_t key;
+  uint32_t payload[2];
+};
+
+static uint64_t next_key(uint64_t &state)
+{
+  /* splitmix64 */
+  uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+template <typename T, typename Sort>
+static double bench_sort(const char *name, const Vector<T> &input, Sort sort)
+{
+  Vector<T> vec;
+
+  return bench_run(name, [&]() {
+    vec.clear();
+    vec.extend(input);
+    sort(vec);
+    bench_keep(vec[0]);
+  });
+}
+
+template <typename T> static void bench_size(const char *label, int size)
+{
+  Vector<T> input;
+  uint64_t state = uint64_t(size);
+
+  for (int i = 0; i < size; i++) {
+    T value;
+    memset(static_cast<void *>(&value), 0, sizeof(T));
+    value.key = next_key(state);
+    input.append(value);
+  }
+
+  auto cmp = [](const T &a, const T &b) {
+    return a.key < b.key ? -1 : (a.key > b.key ? 1 : 0);
+  };
+  char name[96];
+
+  printf("\n%s, %d elements\n", label, size);
+
+  snprintf(name, sizeof(name), "sort");
+  const double serial = bench_sort(name, input, [&](Vector<T> &vec) { vec.sort(cmp); });
+
+  Vector<T> scratch;
+  snprintf(name, sizeof(name), "radix_sort");
+  const double radix = bench_sort(name, input, [&](Vector<T> &vec) {
+    radix_sort(vec, [](const T &value) { return value.key; }, scratch);
+  });
+  printf("  speedup over sort: %.2fx\n", serial / radix);
+
+  for (int threads = 1; threads <= platform::max_thread_count() * 2; threads *= 2) {
+    snprintf(name, sizeof(name), "parallel_sort, %d threads", threads);
+    const double ms = bench_sort(
+        name, input, [&](Vector<T> &vec) { vec.parallel_sort(cmp, threads); });
+
+    snprintf(name, sizeof(name), "parallel_stable_sort, %d threads", threads);
+    bench_sort(
+        name, input, [&](Vector<T> &vec) { vec.parallel_stable_sort(cmp, threads); });
+
+    printf("  speedup over sort: %.2fx\n", serial / ms);
+  }
+}
+
+struct Key {
+  uint64_t key;
+};
+
+int main()
+{
+  printf("max_thread_count() = %d\n", platform::max_thread_count());
+
+  bench_size<Key>("uint64 keys", 1 << 16);
+  bench_size<Key>("uint64 keys", 1 << 22);
+  bench_size<Record>("16 byte records", 1 << 22);
+
+  return 0;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+/**
+ * Runs @p fn @p repeat times and prints the fastest run in milliseconds.
+ * Returns the fastest run.
+ */
+template <typename Fn> static double bench_run(const char *name, Fn fn, int repeat = 5)
+{
+  double best = 1e300;
+
+  for (int i = 0; i < repeat; i++) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto end = std::chrono::steady_clock::now();
+
+    best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+  }
+
+  printf("%-48s %10.3f ms\n", name, best);
+  fflush(stdout);
+  return best;
+}
+
+/** Keeps the optimizer from discarding @p value. */
+template <typename T> static void bench_keep(const T &value)
+{
+  asm volatile("" : : "g"(&value) : "memory");
+}
@@ -0,0 +1,387 @@
+#include "test_util.h"
+#include "litestl/platform/memory.h"
+#include "litestl/util/alloc.h"
+#include "litestl/util/alloc_engine.h"
+#include "litestl/util/alloc_profile.h"
+#include "litestl/util/alloc_stats.h"
+#include "litestl/util/vector.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+test_init;
+
+using namespace litestl;
+
+/* Blocks allocated on one thread and released on others. */
+static void test_cross_thread_release()
+{
+  constexpr int count = 4096;
+  constexpr int thread_count = 4;
+
+  int64_t start_size = alloc::getMemorySize();
+  void *blocks[count];
+
+  for (int i = 0; i < count; i++) {
+    blocks[i] = alloc::alloc("cross thread block", 16 + (i % 512));
+  }
+
+#ifndef NO_DEBUG_ALLOC
+  test_assert(alloc::getMemorySize() > start_size);
+#endif
+
+  std::thread *threads[thread_count];
+  for (int t = 0; t < thread_count; t++) {
+    threads[t] = new std::thread([t, &blocks]() {
+      for (int i = t; i < count; i += thread_count) {
+        alloc::release(blocks[i]);
+      }
+    });
+  }
+
+  for (int t = 0; t < thread_count; t++) {
+    threads[t]->join();
+    delete threads[t];
+  }
+
+  test_assert(alloc::getMemorySize() == start_size);
+}
+
+/* Blocks allocated on a thread that exits before they are released. */
+static void test_orphaned_release()
+{
+  litestl::util::Vector<void *> blocks;
+
+  std::thread thread([&blocks]() {
+    for (int i = 0; i < 256; i++) {
+      blocks.append(alloc::alloc("orphaned block", 32 + i));
+    }
+  });
+  thread.join();
+
+  for (void *block : blocks) {
+    alloc::release(block);
+  }
+}
+
+#ifndef NO_DEBUG_ALLOC
+/*
+ * Many short-lived threads, whose blocks outlive them and are released by
+ * later threads.  Exited threads' lists are reused, so the number of lists
+ * stays at the most threads alive at once.
+ */
+static void test_thread_churn()
+{
+  constexpr int rounds = 200, thread_count = 4, per_thread = 64;
+
+  const int64_t start_size = alloc::getMemorySize();
+  const int start_lists = alloc::detail::mem_list_count();
+  void *blocks[2][thread_count][per_thread];
+
+  for (int round = 0; round < rounds; round++) {
+    std::thread *threads[thread_count];
+
+    for (int t = 0; t < thread_count; t++) {
+      threads[t] = new std::thread([t, round, &blocks]() {
+        void **own = blocks[round % 2][t];
+        void **previous = blocks[(round + 1) % 2][(t + 1) % thread_count];
+
+        for (int i = 0; i < per_thread; i++) {
+          if (round > 0) {
+            alloc::release(previous[i]);
+          }
+          own[i] = alloc::alloc("churn block", 16 + i);
+        }
+      });
+    }
+
+    for (int t = 0; t < thread_count; t++) {
+      threads[t]->join();
+      delete threads[t];
+    }
+  }
+
+  test_assert(alloc::detail::mem_list_count() <= start_lists + thread_count);
+  test_assert(alloc::getMemorySize() > start_size);
+
+  for (int t = 0; t < thread_count; t++) {
+    for (int i = 0; i < per_thread; i++) {
+      alloc::release(blocks[(rounds - 1) % 2][t][i]);
+    }
+  }
+  test_assert(alloc::getMemorySize() == start_size);
+}
+#endif
+
+static alloc::TagStats find_tag_stats(const char *tag)
+{
+  struct Search {
+    const char *tag;
+    alloc::TagStats stats;
+  } search = {tag, {}};
+
+  alloc::for_each_tag_stats(
+      [](const alloc::TagStats &stats, void *userdata) {
+        Search *search = static_cast<Search *>(userdata);
+        if (strcmp(stats.tag, search->tag) == 0) {
+          search->stats = stats;
+        }
+      },
+      static_cast<void *>(&search));
+
+  return search.stats;
+}
+
+/* Per-tag counters, with blocks released on another thread. */
+static void test_tag_stats()
+{
+  constexpr int count = 1000;
+  void *blocks[count];
+
+  /* Not the literal below, tags are matched by content. */
+  char tag[] = "tag stats block";
+
+  for (int i = 0; i < count; i++) {
+    blocks[i] = alloc::alloc(i % 2 ? "tag stats block" : tag, 100);
+  }
+
+  alloc::TagStats stats = find_tag_stats("tag stats block");
+  test_assert(stats.count == count);
+  test_assert(stats.histogram[3] == count);
+  test_assert(stats.bytes >= int64_t(count * 100));
+  test_assert(stats.peak_bytes >= stats.bytes);
+  const int64_t bytes = stats.bytes;
+
+  std::thread thread([&blocks]() {
+    for (int i = 0; i < count; i++) {
+      alloc::release(blocks[i]);
+    }
+  });
+  thread.join();
+
+  stats = find_tag_stats("tag stats block");
+  test_assert(stats.bytes == 0);
+  /* Peaks are tracked in 64kb steps. */
+  test_assert(stats.peak_bytes >= bytes - 64 * 1024);
+
+  char *json = nullptr;
+  size_t json_size = 0;
+  FILE *file = open_memstream(&json, &json_size);
+  alloc::report(file);
+  fclose(file);
+
+  test_assert(strstr(json, "{\"tag\": \"tag stats block\", \"bytes\": 0,") != nullptr);
+  free(json);
+}
+
+/* alloc_aligned across alignments and sizes, small and large blocks. */
+static void test_aligned()
+{
+  const size_t sizes[] = {1, 24, 100, 4000, 70000, 300000};
+
+  for (size_t align = 16; align <= 4096; align <<= 1) {
+    for (size_t size : sizes) {
+      char *ptr = static_cast<char *>(alloc::alloc_aligned("aligned block", size, align));
+
+      test_assert(reinterpret_cast<uintptr_t>(ptr) % align == 0);
+      memset(ptr, 0xAB, size);
+      alloc::release(ptr);
+    }
+  }
+
+  struct alignas(64) Line {
+    char bytes[64];
+  };
+
+  Line *line = alloc::New<Line>("aligned line");
+  test_assert(reinterpret_cast<uintptr_t>(line) % 64 == 0);
+  alloc::Delete(line);
+}
+
+#ifndef NO_DEBUG_ALLOC
+/* Tags and sizes of tracked blocks, plain and aligned. */
+static void test_block_tags()
+{
+  int64_t heap_size = alloc::getMemorySize();
+  char *plain = static_cast<char *>(alloc::alloc("listed block", 40));
+  char *aligned =
+      static_cast<char *>(alloc::alloc_aligned("listed aligned block", 40, 256));
+
+  test_assert(strcmp(alloc::getMemoryTag(plain), "listed block") == 0);
+  test_assert(strcmp(alloc::getMemoryTag(aligned), "listed aligned block") == 0);
+  test_assert(alloc::getMemorySize() - heap_size > 80);
+  test_assert(alloc::print_blocks(false));
+
+  alloc::release(plain);
+  alloc::release(aligned);
+  test_assert(alloc::getMemorySize() == heap_size);
+}
+#endif
+
+/* realloc keeps contents across in-place, remapped and copied resizes. */
+static void test_realloc()
+{
+  int64_t heap_size = alloc::getMemorySize();
+  size_t size = 24;
+  char *ptr = static_cast<char *>(alloc::realloc("realloc block", nullptr, 0, size));
+
+  memset(ptr, 1, size);
+  for (int i = 2; i < 16; i++) {
+    size_t newsize = size * 3;
+    ptr = static_cast<char *>(alloc::realloc("realloc block", ptr, size, newsize));
+    test_assert(ptr != nullptr);
+
+    bool kept = true;
+    for (size_t j = 0; j < size; j++) {
+      kept = kept && ptr[j] == i - 1;
+    }
+    test_assert(kept);
+
+    memset(ptr, i, newsize);
+    size = newsize;
+  }
+
+  /* Shrink back down to a small block. */
+  ptr = static_cast<char *>(alloc::realloc("realloc block", ptr, size, 100));
+  test_assert(ptr[0] == 15 && ptr[99] == 15);
+  alloc::release(ptr);
+
+  test_assert(alloc::getMemorySize() == heap_size);
+
+  /* Growing a large vector of simple elements. */
+  util::Vector<float> list;
+  for (int i = 0; i < 4 * 1024 * 1024; i++) {
+    list.append(float(i));
+  }
+  for (int i = 0; i < int(list.size()); i += 4093) {
+    test_assert(list[i] == float(i));
+  }
+}
+
+/* Large block threshold, huge pages and prefaulting. */
+static void test_large_blocks()
+{
+  const alloc::LargeBlockConfig saved = alloc::get_large_block_config();
+  alloc::LargeBlockConfig config;
+
+  config.threshold = 64 * 1024;
+  config.huge_page_threshold = 4 << 20;
+  config.populate = true;
+  alloc::set_large_block_config(config);
+
+  const alloc::engine::Stats before = alloc::engine::get_stats();
+  void *medium = alloc::alloc("large block", 100 * 1024);
+  char *big = static_cast<char *>(alloc::alloc("large block", 8 << 20));
+  const alloc::engine::Stats during = alloc::engine::get_stats();
+
+  test_assert(during.large_count == before.large_count + 2);
+  test_assert(during.huge_count ==
+              before.huge_count + (platform::huge_page_size() ? 1 : 0));
+  memset(big, 1, 8 << 20);
+
+  alloc::release(medium);
+  alloc::release(big);
+
+  const alloc::engine::Stats after = alloc::engine::get_stats();
+  test_assert(after.large_count == before.large_count);
+  test_assert(after.huge_bytes == before.huge_bytes);
+  test_assert(after.mapped_bytes == before.mapped_bytes);
+
+  alloc::set_large_block_config(saved);
+}
+
+/* Sums the values of a folded-stack heap profile. */
+static int64_t profile_total(bool include_released)
+{
+  char *text = nullptr;
+  size_t text_size = 0;
+  FILE *file = open_memstream(&text, &text_size);
+
+  alloc::write_heap_profile(file, include_released);
+  fclose(file);
+
+  int64_t total = 0;
+  for (char *line = strtok(text, "\n"); line; line = strtok(nullptr, "\n")) {
+    total += atoll(strrchr(line, ' ') + 1);
+  }
+
+  free(text);
+  return total;
+}
+
+/* Sampled estimates land near the real number of bytes allocated. */
+static void test_heap_profile()
+{
+  if (!alloc::start_heap_profile(4096)) {
+    return;
+  }
+
+  const int count = 4000;
+  util::Vector<void *> blocks;
+  for (int i = 0; i < count; i++) {
+    blocks.append(alloc::alloc("profiled block", 1000));
+  }
+
+  const int64_t live = profile_total(false);
+  test_assert(live > count * 1000 * 7 / 10 && live < count * 1000 * 13 / 10);
+
+  for (void *block : blocks) {
+    alloc::release(block);
+  }
+  alloc::stop_heap_profile();
+
+  test_assert(profile_total(false) < 64 * 1024);
+  test_assert(profile_total(true) >= live);
+}
+
+/* Blocks with alignment above the default are sampled, and dropped on release. */
+static void test_aligned_heap_profile()
+{
+  /* Not a Vector, whose own buffer would be sampled too. */
+  void *blocks[128 * 8];
+  int count = 0;
+
+  if (!alloc::start_heap_profile(1)) {
+    return;
+  }
+
+  /* The first few kb may still count down an interval from the last profile. */
+  int64_t size = 0;
+  for (int i = 0; i < 128; i++) {
+    for (size_t align = 32; align <= 4096; align <<= 1) {
+      blocks[count++] = alloc::alloc_aligned("profiled aligned block", 1000, align);
+      size += 1000;
+    }
+  }
+
+  test_assert(profile_total(false) > size * 9 / 10);
+
+  for (int i = 0; i < count; i++) {
+    alloc::release(blocks[i]);
+  }
+  alloc::stop_heap_profile();
+
+  test_assert(profile_total(false) == 0);
+}
+
+int main()
+{
+  test_cross_thread_release();
+  test_orphaned_release();
+  test_aligned();
+#ifndef NO_DEBUG_ALLOC
+  test_block_tags();
+  test_thread_churn();
+#endif
+  test_realloc();
+  test_large_blocks();
+  test_heap_profile();
+  test_aligned_heap_profile();
+#ifndef NO_ALLOC_STATS
+  test_tag_stats();
+#endif
+
+  return test_end();
+}
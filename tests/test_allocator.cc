@@ -0,0 +1,178 @@
+#include "test_util.h"
+#include "litestl/util/allocator.h"
+#include "litestl/util/array.h"
+#include "litestl/util/map.h"
+#include "litestl/util/set.h"
+#include "litestl/util/string.h"
+#include "litestl/util/vector.h"
+
+#include <cstdio>
+
+test_init;
+
+using namespace litestl;
+using namespace litestl::util;
+
+/* Stateful policy counting live blocks. */
+struct CountingAllocator {
+  int *live;
+
+  void *allocate(const char *tag, size_t size)
+  {
+    (*live)++;
+    return alloc::alloc(tag, size);
+  }
+
+  void deallocate(void *ptr)
+  {
+    (*live)--;
+    alloc::release(ptr);
+  }
+};
+
+static_assert(alloc::AllocatorPolicy<CountingAllocator>);
+static_assert(sizeof(Vector<int, 4>) == sizeof(Vector<int, 4, alloc::TaggedAllocator>));
+static_assert(sizeof(Vector<int, 4, CountingAllocator>) > sizeof(Vector<int, 4>));
+
+static void test_counting()
+{
+  int live = 0;
+  CountingAllocator counter{&live};
+
+  {
+    Vector<int, 4, CountingAllocator> list(counter);
+    Map<int, int, 16, CountingAllocator> map(counter);
+    Set<int, 4, CountingAllocator> set(counter);
+    Array<int, CountingAllocator> array(100, counter);
+    String<char, 40, CountingAllocator> str(counter);
+
+    for (int i = 0; i < 1000; i++) {
+      list.append(i);
+      map.add(i, i);
+      set.add(i);
+      str += 'x';
+    }
+
+    test_assert(live > 0);
+
+    /* Copies and moves carry the policy along. */
+    Vector<int, 4, CountingAllocator> list2 = list;
+    Map<int, int, 16, CountingAllocator> map2 = std::move(map);
+    test_assert(list2.get_allocator().live == &live);
+    test_assert(map2.get_allocator().live == &live);
+    test_assert(map2.lookup(999) == 999);
+    test_assert(list2[999] == 999);
+  }
+
+  test_assert(live == 0);
+}
+
+static void test_arena_allocator()
+{
+  alloc::Arena arena(4096);
+  int64_t heap_size = alloc::getMemorySize();
+
+  {
+    alloc::ArenaAllocator allocator(arena);
+    Vector<int, 4, alloc::ArenaAllocator> list(allocator);
+    Map<int, int, 16, alloc::ArenaAllocator> map(allocator);
+
+    for (int i = 0; i < 1000; i++) {
+      list.append(i);
+      map.add(i, i * 2);
+    }
+
+    for (int i = 0; i < 1000; i++) {
+      test_assert(list[i] == i);
+      test_assert(map.lookup(i) == i * 2);
+    }
+
+    test_assert(alloc::getMemorySize() == heap_size);
+    test_assert(arena.used() > 1000 * sizeof(int));
+  }
+
+  arena.reset();
+}
+
+/* Ranges from the vector itself, whose temporary copy keeps the arena policy. */
+static void test_arena_self_insert()
+{
+  alloc::Arena arena(4096);
+  const int64_t heap_size = alloc::getMemorySize();
+
+  {
+    Vector<int, 4, alloc::ArenaAllocator> list{alloc::ArenaAllocator(arena)};
+    for (int i = 0; i < 6; i++) {
+      list.append(i);
+    }
+
+    list.insert(2, std::span<const int>(list.data(), 3));
+    const int expect[] = {0, 1, 0, 1, 2, 2, 3, 4, 5};
+    test_assert(list.size() == array_size(expect));
+    for (size_t i = 0; i < array_size(expect); i++) {
+      test_assert(list[i] == expect[i]);
+    }
+
+    /* Growing moves the elements the iterators point at. */
+    list.extend(list.begin(), list.end());
+    test_assert(list.size() == 2 * array_size(expect));
+    for (size_t i = 0; i < list.size(); i++) {
+      test_assert(list[i] == expect[i % array_size(expect)]);
+    }
+
+    test_assert(alloc::getMemorySize() == heap_size);
+  }
+
+  arena.reset();
+}
+
+struct alignas(64) CacheLine {
+  int value;
+};
+
+template <typename T> static bool is_aligned(const T *ptr)
+{
+  return reinterpret_cast<uintptr_t>(ptr) % alignof(T) == 0;
+}
+
+/* Over-aligned element types, in static storage and on the heap. */
+static void test_overaligned()
+{
+  Vector<CacheLine, 2> list;
+  Map<int, CacheLine, 4> map;
+  Array<CacheLine> array(10);
+
+  test_assert(is_aligned(list.data()));
+  for (int i = 0; i < 100; i++) {
+    list.append({i});
+    test_assert(is_aligned(list.data()));
+    map.add(i, {i});
+  }
+
+  for (int i = 0; i < 100; i++) {
+    test_assert(list[i].value == i);
+    test_assert(is_aligned(&map.lookup(i)));
+    test_assert(map.lookup(i).value == i);
+  }
+
+  test_assert(is_aligned(&array[0]));
+
+  alloc::Arena arena(4096);
+  {
+    Vector<CacheLine, 1, alloc::ArenaAllocator> arena_list{alloc::ArenaAllocator(arena)};
+    for (int i = 0; i < 20; i++) {
+      arena_list.append({i});
+      test_assert(is_aligned(arena_list.data()));
+    }
+  }
+}
+
+int main()
+{
+  test_counting();
+  test_arena_allocator();
+  test_arena_self_insert();
+  test_overaligned();
+
+  return test_end();
+}
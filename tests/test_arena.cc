@@ -0,0 +1,92 @@
+#include "test_util.h"
+#include "litestl/util/alloc.h"
+#include "litestl/util/arena.h"
+#include "litestl/util/map.h"
+#include "litestl/util/string.h"
+#include "litestl/util/vector.h"
+
+#include <cstdio>
+
+test_init;
+
+using namespace litestl;
+using namespace litestl::util;
+
+static void test_containers()
+{
+  alloc::Arena arena(4096);
+  int64_t heap_size = alloc::getMemorySize();
+
+  for (int pass = 0; pass < 3; pass++) {
+    {
+      alloc::ArenaScope scope(arena);
+
+      Vector<int> list;
+      Map<int, int> map;
+      string str = "a string that does not fit in static storage, not at all";
+
+      for (int i = 0; i < 1000; i++) {
+        list.append(i);
+        map.add(i, i * 2);
+        str += 'x';
+      }
+
+      for (int i = 0; i < 1000; i++) {
+        test_assert(list[i] == i);
+        test_assert(map.lookup(i) == i * 2);
+      }
+
+      test_assert(str.size() > 1000);
+      test_assert(alloc::getMemorySize() == heap_size);
+    }
+
+    test_assert(arena.used() > 0);
+    size_t reserved = arena.reserved();
+
+    arena.reset();
+    test_assert(arena.used() == 0);
+    test_assert(arena.reserved() == reserved);
+  }
+}
+
+static void test_marks()
+{
+  alloc::Arena arena(1024);
+
+  int *a = arena.New<int>(1);
+  alloc::Arena::Mark outer = arena.mark();
+
+  arena.alloc(100);
+  alloc::Arena::Mark inner = arena.mark();
+  size_t inner_used = arena.used();
+
+  /* Bigger than a chunk. */
+  void *big = arena.alloc(8000, 64);
+  test_assert((uintptr_t(big) & 63) == 0);
+
+  arena.rewind(inner);
+  test_assert(arena.used() == inner_used);
+
+  arena.rewind(outer);
+  int *b = arena.New<int>(2);
+  test_assert(*a == 1 && *b == 2);
+
+  size_t used = arena.used();
+  {
+    alloc::ArenaScope scope(arena, true);
+    alloc::alloc("rewound", 5000);
+  }
+  test_assert(arena.used() == used);
+
+  arena.reset();
+  arena.trim();
+  test_assert(arena.reserved() == 0);
+}
+
+int main()
+{
+  test_containers();
+  test_marks();
+
+  return test_end();
+}
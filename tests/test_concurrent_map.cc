@@ -0,0 +1,196 @@
+#include "test_util.h"
+#include "litestl/util/concurrent_map.h"
+#include "litestl/util/string.h"
+#include "litestl/util/task.h"
+#include "litestl/util/vector.h"
+
+#include <atomic>
+#include <cstdio>
+#include <thread>
+
+test_init;
+
+using namespace litestl;
+using namespace litestl::util;
+
+/** Runs @p fn(thread_index) on @p count threads and waits for them. */
+template <typename Fn> static void run_threads(int count, Fn fn)
+{
+  Vector<std::thread *> threads;
+
+  for (int t = 0; t < count; t++) {
+    threads.append(alloc::New<std::thread>("std::thread", [&fn, t]() { fn(t); }));
+  }
+  for (std::thread *thread : threads) {
+    thread->join();
+    alloc::Delete(thread);
+  }
+}
+
+static void test_serial()
+{
+  ConcurrentMap<int, int> map;
+
+  for (int i = 0; i < 100000; i++) {
+    test_assert(map.add(i, i * 2));
+  }
+  test_assert(!map.add(5, 0) && map.size() == 100000);
+
+  int value = -1;
+  test_assert(map.lookup(5, &value) && value == 10);
+  test_assert(!map.lookup(100000, &value) && !map.contains(-1));
+
+  test_assert(!map.add_overwrite(5, 7) && map.lookup(5, &value) && value == 7);
+  test_assert(map.modify(5, [](int &v) { v++; }) && map.lookup(5, &value) && value == 8);
+  test_assert(!map.modify(-5, [](int &v) { v++; }));
+
+  test_assert(map.remove(5, &value) && value == 8);
+  test_assert(!map.remove(5) && !map.contains(5) && map.size() == 99999);
+
+  /* Every entry is in exactly one shard. */
+  size_t count = 0;
+  int64_t sum = 0;
+  for (int i = 0; i < map.shard_count; i++) {
+    auto shard = map.shard(i);
+    count += shard.size();
+
+    for (const auto &pair : shard) {
+      test_assert(pair.value == pair.key * 2);
+      sum += pair.key;
+    }
+  }
+  test_assert(count == 99999 && sum == int64_t(99999) * 100000 / 2 - 5);
+
+  map.clear();
+  test_assert(map.size() == 0 && !map.contains(1));
+
+  ConcurrentMap<string, string, 2> strings;
+  strings.reserve(1000);
+  for (int i = 0; i < 1000; i++) {
+    char name[64];
+    snprintf(name, sizeof(name), "a key long enough to live on the heap %d", i);
+    strings.add(string(name), string(name));
+  }
+  string text;
+  test_assert(strings.lookup(string("a key long enough to live on the heap 999"), &text));
+  test_assert(text == string("a key long enough to live on the heap 999"));
+  test_assert(strings.size() == 1000);
+}
+
+/* All threads add the same keys, each key is added by exactly one of them. */
+static void test_parallel_add()
+{
+  constexpr int threads = 8, count = 50000;
+  ConcurrentMap<int, int> map;
+  std::atomic<int> added = 0;
+
+  run_threads(threads, [&](int t) {
+    for (int i = 0; i < count; i++) {
+      const int key = (i * 7919 + t * 13) % count;
+      added += map.add(key, t);
+    }
+  });
+
+  test_assert(added == count && map.size() == count);
+
+  bool ok = true;
+  for (int i = 0; i < count; i++) {
+    int value = -1;
+    ok = ok && map.lookup(i, &value) && value >= 0 && value < threads;
+  }
+  test_assert(ok);
+}
+
+/* Concurrent upserts count every call. */
+static void test_parallel_upsert()
+{
+  constexpr int threads = 8, keys = 1000, rounds = 20;
+  ConcurrentMap<int, int, 3> map;
+
+  run_threads(threads, [&](int /*t*/) {
+    for (int r = 0; r < rounds; r++) {
+      for (int i = 0; i < keys; i++) {
+        map.add_callback(i, []() { return 1; }, [](int &count) { count++; });
+      }
+    }
+  });
+
+  bool ok = map.size() == keys;
+  for (int i = 0; i < keys; i++) {
+    int value = 0;
+    ok = ok && map.lookup(i, &value) && value == threads * rounds;
+  }
+  test_assert(ok);
+}
+
+/*
+ * Half the threads remove even keys while the other half look up odd ones,
+ * which must be found throughout, as the shards shrink and other threads add.
+ */
+static void test_parallel_remove()
+{
+  constexpr int threads = 8, count = 40000;
+  ConcurrentMap<int, int> map;
+
+  for (int i = 0; i < count; i++) {
+    map.add(i, i);
+  }
+
+  std::atomic<int> removed = 0, missing = 0;
+  run_threads(threads, [&](int t) {
+    if (t % 2 == 0) {
+      for (int i = t; i < count; i += threads) {
+        removed += map.remove(i);
+        map.add(count + i, i);
+      }
+    } else {
+      for (int round = 0; round < 4; round++) {
+        for (int i = 1; i < count; i += 2) {
+          int value = -1;
+          missing += !map.lookup(i, &value) || value != i;
+        }
+      }
+    }
+  });
+
+  test_assert(removed == count / 2 && missing == 0);
+  test_assert(map.size() == count);
+  test_assert(!map.contains(0) && map.contains(1) && map.contains(count));
+}
+
+/* parallel_for over the shards sees every entry once. */
+static void test_shard_iteration()
+{
+  constexpr int count = 100000;
+  ConcurrentMap<int, int> map;
+
+  task::parallel_for(IndexRange(count), [&](IndexRange range) {
+    for (int i : range) {
+      map.add(i, 1);
+    }
+  });
+
+  std::atomic<int64_t> sum = 0;
+  task::parallel_for(IndexRange(map.shard_count), [&](IndexRange range) {
+    for (int i : range) {
+      int64_t shard_sum = 0;
+      for (const auto &pair : map.shard(i)) {
+        shard_sum += pair.value;
+      }
+      sum += shard_sum;
+    }
+  });
+
+  test_assert(sum == count);
+}
+
+int main()
+{
+  test_serial();
+  test_parallel_add();
+  test_parallel_upsert();
+  test_parallel_remove();
+  test_shard_iteration();
+
+  return test_end();
+}
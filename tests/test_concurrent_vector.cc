@@ -0,0 +1,166 @@
+#include "test_util.h"
+#include "litestl/util/concurrent_vector.h"
+#include "litestl/util/string.h"
+#include "litestl/util/task.h"
+
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+test_init;
+
+using namespace litestl;
+using namespace litestl::util;
+
+static void test_serial()
+{
+  ConcurrentVector<int> vec;
+
+  for (int i = 0; i < 1000; i++) {
+    test_assert(vec.push_back(i) == size_t(i));
+  }
+  int *first = &vec[0];
+
+  const size_t start = vec.grow_by(5000);
+  test_assert(start == 1000);
+  test_assert(vec.size() == 6000);
+  test_assert(vec[5999] == 0);
+  test_assert(&vec[0] == first);
+
+  bool ok = true;
+  for (int i = 0; i < 1000; i++) {
+    ok = ok && vec[i] == i;
+  }
+  test_assert(ok);
+
+  Vector<int> flat = vec.finalize();
+  test_assert(flat.size() == 6000);
+  test_assert(flat[999] == 999 && flat[1000] == 0);
+  test_assert(vec.size() == 0);
+}
+
+/* Producers on several threads, each value pushed exactly once. */
+static void test_parallel()
+{
+  constexpr int count = 200000;
+  ConcurrentVector<int> vec;
+
+  task::parallel_for(
+      IndexRange(count),
+      [&](IndexRange range) {
+        for (int i : range) {
+          if (i % 3 == 0) {
+            const size_t start = vec.grow_by(3);
+            for (int j = 0; j < 3; j++) {
+              vec[start + j] = -1;
+            }
+          }
+          vec.push_back(i);
+        }
+      },
+      1000);
+
+  Vector<int> flat = vec.finalize();
+  test_assert(flat.size() == count + (count + 2) / 3 * 3);
+
+  Vector<bool> seen;
+  seen.resize(count);
+  for (int i = 0; i < count; i++) {
+    seen[i] = false;
+  }
+
+  bool ok = true;
+  for (int value : flat) {
+    if (value >= 0) {
+      ok = ok && !seen[value];
+      seen[value] = true;
+    }
+  }
+  for (int i = 0; i < count; i++) {
+    ok = ok && seen[i];
+  }
+  test_assert(ok);
+}
+
+static void test_objects()
+{
+  ConcurrentVector<string> strings;
+  Vector<std::thread *> threads;
+
+  for (int t = 0; t < 4; t++) {
+    threads.append(alloc::New<std::thread>("std::thread", [&strings]() {
+      for (int i = 0; i < 500; i++) {
+        strings.emplace_back("a fairly long string, stored on the heap");
+      }
+    }));
+  }
+  for (std::thread *thread : threads) {
+    thread->join();
+    alloc::Delete(thread);
+  }
+
+  test_assert(strings.size() == 2000);
+  Vector<string> flat = strings.finalize();
+  test_assert(
+      strcmp(flat[1999].c_str(), "a fairly long string, stored on the heap") == 0);
+
+  strings.push_back("again");
+  test_assert(strings.size() == 1);
+}
+
+/* Thread safe policy counting live blocks. */
+struct CountingAllocator {
+  std::atomic<int> *live;
+
+  void *allocate(const char *tag, size_t size)
+  {
+    (*live)++;
+    return alloc::alloc(tag, size);
+  }
+
+  void deallocate(void *ptr)
+  {
+    (*live)--;
+    alloc::release(ptr);
+  }
+};
+
+/* Segments, including ones lost in a race, and the finalized result use the policy. */
+static void test_allocator()
+{
+  constexpr int threads = 4, count = 20000;
+  std::atomic<int> live = 0;
+
+  {
+    ConcurrentVector<int, CountingAllocator> vec(CountingAllocator{&live});
+    std::thread *workers[threads];
+
+    for (int t = 0; t < threads; t++) {
+      workers[t] = new std::thread([&vec]() {
+        for (int i = 0; i < count; i++) {
+          vec.push_back(i);
+        }
+      });
+    }
+    for (int t = 0; t < threads; t++) {
+      workers[t]->join();
+      delete workers[t];
+    }
+    test_assert(vec.size() == size_t(threads * count) && live > 0);
+
+    auto flat = vec.finalize();
+    test_assert(flat.size() == size_t(threads * count) && live == 1);
+  }
+
+  test_assert(live == 0);
+}
+
+int main()
+{
+  test_serial();
+  test_parallel();
+  test_objects();
+  test_allocator();
+
+  return test_end();
+}
@@ -0,0 +1,121 @@
+#include "litestl/math/matrix.h"
+#include "litestl/math/vector.h"
+#include "litestl/util/hash.h"
+#include "litestl/util/map.h"
+#include "litestl/util/set.h"
+#include "litestl/util/string.h"
+#include "litestl/util/vector.h"
+#include "test_util.h"
+
+#include <algorithm>
+#include <cstdio>
+
+test_init;
+
+using namespace litestl;
+using namespace litestl::util;
+
+/* Every string type hashes its characters, nothing else. */
+static void test_strings()
+{
+  const char *text = "some key";
+  string str(text);
+
+  test_assert(hash::hash(text) == hash::hash(stringref(text)));
+  test_assert(hash::hash(text) == hash::hash(str));
+  test_assert(hash::hash(text) == hash::hash_bytes(text, 8));
+
+  /* Explicit length refs into a larger buffer. */
+  const char *buffer = "some keys";
+  test_assert(hash::hash(stringref(buffer, 8)) == hash::hash(text));
+  test_assert(hash::hash(stringref(buffer, 9)) != hash::hash(text));
+  test_assert(stringref(buffer, 8) == stringref(text));
+
+  /* Every length, and every prefix of a buffer, hashes differently. */
+  char bytes[200];
+  for (int i = 0; i < 200; i++) {
+    bytes[i] = char(i * 7);
+  }
+
+  Vector<hash::HashInt> hashes;
+  for (int size = 0; size <= 200; size++) {
+    hashes.append(hash::hash_bytes(bytes, size));
+  }
+  std::sort(hashes.begin(), hashes.end());
+  test_assert(std::adjacent_find(hashes.begin(), hashes.end()) == hashes.end());
+
+  /* Flipping any one bit of a 64 byte key changes the hash. */
+  const hash::HashInt base = hash::hash_bytes(bytes, 64);
+  for (int bit = 0; bit < 64 * 8; bit++) {
+    bytes[bit / 8] ^= char(1 << (bit % 8));
+    test_assert(hash::hash_bytes(bytes, 64) != base);
+    bytes[bit / 8] ^= char(1 << (bit % 8));
+  }
+}
+
+/* Keys that only differ in high bits still fill the low bits of the hash. */
+static void test_integers()
+{
+  constexpr int buckets = 1024;
+  bool used[buckets] = {};
+
+  for (int i = 0; i < buckets; i++) {
+    used[hash::hash(int64_t(i) << 32) % buckets] = true;
+  }
+
+  int used_count = 0;
+  for (bool b : used) {
+    used_count += b;
+  }
+  /* Random placement fills 1 - 1/e of the buckets, about 647. */
+  test_assert(used_count > 580);
+
+  int values[2];
+  test_assert(hash::hash(&values[0]) != hash::hash(&values[1]));
+  test_assert(hash::hash(0.0f) == hash::hash(-0.0f));
+  test_assert(hash::hash(0.0) == hash::hash(-0.0));
+  test_assert(hash::hash(1.0f) != hash::hash(2.0f));
+
+  enum class Kind { A, B };
+  test_assert(hash::hash(Kind::A) != hash::hash(Kind::B));
+
+  const hash::HashInt a = hash::hash(1), b = hash::hash(2);
+  test_assert(hash::hash_combine(a, b) != hash::hash_combine(b, a));
+}
+
+static void test_math()
+{
+  using namespace litestl::math;
+
+  test_assert(hash::hash_of(float3(1.0f, 2.0f, 3.0f)) ==
+              hash::hash_of(float3(1.0f, 2.0f, 3.0f)));
+  test_assert(hash::hash_of(float3(1.0f, 2.0f, 3.0f)) !=
+              hash::hash_of(float3(3.0f, 2.0f, 1.0f)));
+  test_assert(hash::hash_of(float2(0.0f, 1.0f)) == hash::hash_of(float2(-0.0f, 1.0f)));
+
+  mat4 m1, m2;
+  test_assert(hash::hash_of(m1) == hash::hash_of(m2));
+  m2[1][2] = 5.0;
+  test_assert(hash::hash_of(m1) != hash::hash_of(m2) && !(m1 == m2));
+
+  /* Tables find the overloads next to the key types. */
+  Map<int3, int> map;
+  for (int i = 0; i < 1000; i++) {
+    map.add(int3(i, i * 2, -i), i);
+  }
+  test_assert(map.size() == 1000 && map.lookup(int3(10, 20, -10)) == 10);
+
+  Set<mat4> set;
+  set.add(m1);
+  set.add(m2);
+  test_assert(set.size() == 2 && set.contains(m2));
+}
+
+int main()
+{
+  test_strings();
+  test_integers();
+  test_math();
+
+  return test_end();
+}
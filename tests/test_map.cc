@@ -1,8 +1,12 @@
+#include "litestl/util/alloc_stats.h"
 #include "litestl/util/map.h"
 #include "litestl/util/rand.h"
+#include "litestl/util/string.h"
 #include "litestl/util/vector.h"
 #include "test_util.h"
 #include <cstdio>
+#include <cstring>
+#include <unordered_map>
 
 test_init;
 
@@ -39,6 +43,156 @@ int test_remove()
   return retval;
 }
 
+/* Random adds and removes over a small key range, so tombstones pile up. */
+static void test_random_ops()
+{
+  using namespace litestl::util;
+  Random rand = Random(uint32_t(7));
+  Map<int, int> map;
+  std::unordered_map<int, int> expect;
+
+  for (int i = 0; i < 200000; i++) {
+    const int key = rand.get_int() % 3000;
+    const int op = rand.get_int() % 4;
+
+    if (op == 0) {
+      int value = -1;
+      const bool removed = map.remove(key, &value);
+      test_assert(removed == (expect.count(key) == 1));
+      if (removed) {
+        test_assert(value == expect[key]);
+        expect.erase(key);
+      }
+    } else if (op == 1) {
+      test_assert(map.add_overwrite(key, i) == (expect.count(key) == 0));
+      expect[key] = i;
+    } else {
+      test_assert(map.add(key, i) == (expect.count(key) == 0));
+      expect.emplace(key, i);
+    }
+  }
+
+  test_assert(map.size() == expect.size());
+  for (auto &[key, value] : expect) {
+    test_assert(map.contains(key) && map.lookup(key) == value);
+  }
+
+  size_t count = 0;
+  for (const auto &pair : map) {
+    test_assert(expect.count(pair.key) && expect[pair.key] == pair.value);
+    count++;
+  }
+  test_assert(count == expect.size());
+}
+
+static litestl::util::string key_name(int i)
+{
+  char buf[32];
+  snprintf(buf, sizeof(buf), "key%d", i);
+  return litestl::util::string(buf);
+}
+
+/* Non-trivial keys, copies and moves of inline and heap tables. */
+static void test_copy_move()
+{
+  using namespace litestl::util;
+
+  for (int size : {5, 500}) {
+    Map<string, int, 8> map;
+    for (int i = 0; i < size; i++) {
+      map.add(key_name(i), i);
+    }
+    map.remove("key3");
+
+    Map<string, int, 8> copy = map;
+    Map<string, int, 8> moved = std::move(map);
+    test_assert(map.size() == 0 && !map.contains("key1"));
+
+    for (Map<string, int, 8> *m : {&copy, &moved}) {
+      test_assert(m->size() == size_t(size - 1) && !m->contains("key3"));
+      for (int i = 0; i < size; i++) {
+        test_assert(i == 3 || *m->lookup_ptr(key_name(i)) == i);
+      }
+    }
+
+    copy["new"] = 42;
+    test_assert(copy.lookup("new") == 42 && !moved.contains("new"));
+
+    moved.reserve(4000);
+    test_assert(moved.size() == size_t(size - 1) && moved.contains("key2"));
+  }
+}
+
+/** Allocations made for string contents so far. */
+static uint64_t string_allocations()
+{
+  uint64_t count = 0;
+  litestl::alloc::for_each_tag_stats(
+      [](const litestl::alloc::TagStats &stats, void *userdata) {
+        if (strcmp(stats.tag, "string") == 0) {
+          *static_cast<uint64_t *>(userdata) = stats.count;
+        }
+      },
+      static_cast<void *>(&count));
+  return count;
+}
+
+/* String keys searched with stringrefs and C strings, which are not converted. */
+static void test_transparent_keys()
+{
+  using namespace litestl::util;
+
+  /* Too long for a string's inline storage, so every conversion allocates. */
+  Vector<string> names;
+  char name[96];
+  for (int i = 0; i < 100; i++) {
+    snprintf(name, sizeof(name), "a key too long to be stored inside a string, %d", i);
+    names.append(string(name));
+  }
+
+  Map<string, int> map;
+  for (int i = 0; i < int(names.size()); i++) {
+    stringref ref = names[i];
+    test_assert(map.add(ref, i));
+  }
+  test_assert(!map.add(names[0].c_str(), 5) && map.size() == 100);
+
+  const uint64_t allocations = string_allocations();
+
+  for (int i = 0; i < int(names.size()); i++) {
+    stringref ref = names[i];
+    test_assert(map.contains(ref) && *map.lookup_ptr(ref) == i);
+    test_assert(map.contains(names[i].c_str()) && map[ref] == i);
+  }
+  test_assert(!map.contains("missing") && !map.lookup_ptr(stringref("missing")));
+  test_assert(!map.add(stringref(names[1].c_str()), 7) && map.lookup(names[1]) == 1);
+
+  /* An explicit length ref that is a prefix of another key. */
+  test_assert(*map.lookup_ptr(stringref(names[12].c_str(), names[1].size())) == 1);
+
+#ifndef NO_ALLOC_STATS
+  test_assert(string_allocations() == allocations);
+#endif
+
+  map["new key"] = 42;
+  test_assert(map.lookup("new key") == 42);
+  test_assert(map.remove(stringref("new key")) && !map.contains("new key"));
+
+  int value = 0;
+  test_assert(map.remove(names[5].c_str(), &value) && value == 5);
+  test_assert(!map.remove(names[5].c_str()) && map.size() == 99);
+
+  /* The other way around, stringref keys searched with strings. */
+  Map<stringref, int> refs;
+  for (int i = 0; i < int(names.size()); i++) {
+    refs.add(names[i].c_str(), i);
+  }
+  for (int i = 0; i < int(names.size()); i++) {
+    test_assert(refs.contains(names[i]) && *refs.lookup_ptr(names[i]) == i);
+  }
+  test_assert(!refs.contains(string("missing")));
+}
+
 int main()
 {
   using namespace litestl::util;
@@ -76,5 +230,9 @@ int main()
     test_assert(keys.size() == 0);
   }
 
+  test_random_ops();
+  test_copy_move();
+  test_transparent_keys();
+
   return test_end();
 }
@@ -0,0 +1,131 @@
+#include "test_util.h"
+#include "litestl/util/pool.h"
+#include "litestl/util/vector.h"
+
+#include <atomic>
+#include <thread>
+
+test_init;
+
+using namespace litestl;
+using namespace litestl::util;
+
+struct Node {
+  static inline std::atomic<int> alive = 0;
+
+  int key;
+  Node *next;
+
+  Node(int key, Node *next) : key(key), next(next)
+  {
+    alive++;
+  }
+  ~Node()
+  {
+    alive--;
+  }
+};
+
+static void test_pool()
+{
+  alloc::Pool<Node> pool("test nodes", 16);
+  Node *head = nullptr;
+
+  for (int i = 0; i < 100; i++) {
+    head = pool.New(i, head);
+  }
+
+  test_assert(Node::alive == 100);
+  test_assert(pool.stats().live == 100);
+  test_assert(pool.stats().slabs == 7);
+
+  int expect = 99;
+  for (Node *node = head; node; node = node->next) {
+    test_assert(node->key == expect--);
+  }
+
+  /* Freed slots are reused before new slabs are taken. */
+  while (head) {
+    Node *next = head->next;
+    pool.Delete(head);
+    head = next;
+  }
+  for (int i = 0; i < 100; i++) {
+    head = pool.New(i, head);
+  }
+  test_assert(pool.stats().slabs == 7);
+  test_assert(pool.stats().allocations == 200);
+
+  while (head) {
+    Node *next = head->next;
+    pool.Delete(head);
+    head = next;
+  }
+
+  test_assert(Node::alive == 0);
+  test_assert(pool.stats().live == 0);
+}
+
+struct alignas(64) Padded {
+  int value;
+};
+
+static void test_aligned()
+{
+  alloc::Pool<Padded> pool("test padded");
+
+  for (int i = 0; i < 100; i++) {
+    Padded *obj = pool.New(Padded{i});
+    test_assert(reinterpret_cast<uintptr_t>(obj) % 64 == 0);
+  }
+}
+
+/* Objects allocated on some threads and deleted on others. */
+static void test_threads()
+{
+  alloc::Pool<Node, true> pool("test shared nodes");
+  constexpr int per_thread = 10000;
+  Vector<Node *> nodes[4];
+  Vector<std::thread *> threads;
+
+  for (int t = 0; t < 4; t++) {
+    threads.append(alloc::New<std::thread>("std::thread", [&, t]() {
+      for (int i = 0; i < per_thread; i++) {
+        nodes[t].append(pool.New(i, nullptr));
+      }
+    }));
+  }
+  for (std::thread *thread : threads) {
+    thread->join();
+    alloc::Delete(thread);
+  }
+  threads.clear();
+
+  test_assert(pool.stats().live == 4 * per_thread);
+
+  for (int t = 0; t < 4; t++) {
+    threads.append(alloc::New<std::thread>("std::thread", [&, t]() {
+      for (Node *node : nodes[(t + 1) % 4]) {
+        pool.Delete(node);
+      }
+    }));
+  }
+  for (std::thread *thread : threads) {
+    thread->join();
+    alloc::Delete(thread);
+  }
+
+  const alloc::PoolStats stats = pool.stats();
+  test_assert(stats.live == 0);
+  test_assert(stats.allocations == 4 * per_thread);
+  test_assert(Node::alive == 0);
+}
+
+int main()
+{
+  test_pool();
+  test_aligned();
+  test_threads();
+
+  return test_end();
+}
@@ -0,0 +1,99 @@
+#include "test_util.h"
+#include "litestl/platform/memory.h"
+#include "litestl/util/reserved_vector.h"
+#include "litestl/util/string.h"
+
+#include <cstring>
+
+test_init;
+
+using namespace litestl;
+using namespace litestl::util;
+
+static void test_pages()
+{
+  const size_t page = platform::page_size();
+  char *mem = static_cast<char *>(platform::reserve_pages(page * 16));
+
+  test_assert(mem != nullptr);
+  test_assert(platform::commit_pages(mem, page * 4));
+  test_assert(mem[0] == 0 && mem[page * 4 - 1] == 0);
+  memset(mem, 0xAB, page * 4);
+
+  /* Decommitted pages come back zeroed. */
+  platform::decommit_pages(mem + page * 2, page * 2);
+  test_assert(platform::commit_pages(mem + page * 2, page * 2));
+  test_assert(mem[page * 2] == 0 && uint8_t(mem[page]) == 0xAB);
+
+  platform::release_pages(mem, page * 16);
+}
+
+static void test_growth()
+{
+  ReservedVector<int> vec(1 << 20);
+  test_assert(vec.max_size() >= 1 << 20);
+  test_assert(vec.capacity() == 0);
+
+  vec.append(0);
+  int *first = &vec[0];
+
+  for (int i = 1; i < 1 << 20; i++) {
+    vec.append(i);
+  }
+
+  /* Elements never move. */
+  test_assert(&vec[0] == first);
+  test_assert(vec.size() == 1 << 20);
+
+  bool ok = true;
+  for (int i = 0; i < 1 << 20; i++) {
+    ok = ok && vec[i] == i;
+  }
+  test_assert(ok);
+
+  test_assert(vec.pop_back() == (1 << 20) - 1);
+  vec.resize(10);
+  vec.contract();
+  test_assert(vec.capacity() * sizeof(int) == platform::page_size());
+  test_assert(vec[9] == 9);
+
+  vec.resize(20);
+  test_assert(vec[15] == 0);
+
+  int sum = 0;
+  for (int value : vec) {
+    sum += value;
+  }
+  test_assert(sum == 45);
+}
+
+static void test_objects()
+{
+  ReservedVector<string> strings(1000);
+
+  for (int i = 0; i < 1000; i++) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "element %d", i);
+    strings.grow_one(buf);
+  }
+  test_assert(strcmp(strings.last().c_str(), "element 999") == 0);
+
+  ReservedVector<string> moved = std::move(strings);
+  test_assert(strings.size() == 0);
+  test_assert(moved.size() == 1000);
+  test_assert(strcmp(moved[500].c_str(), "element 500") == 0);
+
+  moved.clear();
+  test_assert(moved.size() == 0);
+  moved.append("again");
+  test_assert(strcmp(moved[0].c_str(), "again") == 0);
+}
+
+int main()
+{
+  test_pages();
+  test_growth();
+  test_objects();
+
+  return test_end();
+}
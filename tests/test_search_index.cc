@@ -0,0 +1,97 @@
+#include "test_util.h"
+#include "litestl/util/rand.h"
+#include "litestl/util/search_index.h"
+#include "litestl/util/vector.h"
+
+#include <algorithm>
+#include <limits>
+
+test_init;
+
+using namespace litestl;
+using namespace litestl::util;
+
+template <typename T> static IndexInt reference(const Vector<T> &sorted, T key)
+{
+  return IndexInt(std::lower_bound(sorted.begin(), sorted.end(), key) - sorted.begin());
+}
+
+static void test_small()
+{
+  /* Every size up to a few levels, complete trees and not, with duplicates. */
+  bool ok = true;
+
+  for (int size = 0; size < 70; size++) {
+    Vector<int> sorted;
+    for (int i = 0; i < size; i++) {
+      sorted.append((i / 2) * 3);
+    }
+
+    SearchIndex<int> index(sorted);
+    ok = ok && index.size() == size;
+
+    for (int key = -2; key < size * 2 + 2; key++) {
+      ok = ok && index.lower_bound(key) == reference(sorted, key);
+    }
+  }
+
+  test_assert(ok);
+}
+
+static void test_random()
+{
+  Random rand;
+  Vector<int> sorted;
+
+  for (int i = 0; i < 100000; i++) {
+    sorted.append(int(rand.get_int()) - int(Random::max_value / 2));
+  }
+  sorted.append(std::numeric_limits<int>::max());
+  std::sort(sorted.begin(), sorted.end());
+
+  SearchIndex<int> index(sorted);
+
+  Vector<int> keys;
+  Vector<IndexInt> results;
+  for (int i = 0; i < 10000; i++) {
+    keys.append(int(rand.get_int()) - int(Random::max_value / 2));
+  }
+  keys.append(std::numeric_limits<int>::min());
+  keys.append(std::numeric_limits<int>::max());
+  results.resize(keys.size());
+
+  index.lower_bound(std::span<const int>(keys.data(), keys.size()),
+                    std::span<IndexInt>(results.data(), results.size()));
+
+  bool ok = true;
+  for (int i = 0; i < int(keys.size()); i++) {
+    const IndexInt expect = reference(sorted, keys[i]);
+    ok = ok && index.lower_bound(keys[i]) == expect && results[i] == expect;
+  }
+  test_assert(ok);
+}
+
+static void test_float()
+{
+  const float inf = std::numeric_limits<float>::infinity();
+  Vector<float> sorted = {-inf, -2.5f, -0.0f, 1.0f, 1.0f, 1e20f, inf};
+  SearchIndex<float> index(sorted);
+
+  test_assert(index.lower_bound(-inf) == 0);
+  test_assert(index.lower_bound(-1.0f) == 2);
+  test_assert(index.lower_bound(1.0f) == 3);
+  test_assert(index.lower_bound(2.0f) == 5);
+  test_assert(index.lower_bound(inf) == 6);
+
+  SearchIndex<float> empty;
+  test_assert(empty.lower_bound(1.0f) == 0);
+}
+
+int main()
+{
+  test_small();
+  test_random();
+  test_float();
+
+  return test_end();
+}
@@ -0,0 +1,108 @@
+#include "test_util.h"
+#include "litestl/util/segmented_vector.h"
+#include "litestl/util/string.h"
+#include "litestl/util/task.h"
+
+#include <atomic>
+#include <cstring>
+
+test_init;
+
+using namespace litestl;
+using namespace litestl::util;
+
+static void test_append()
+{
+  SegmentedVector<int, 64> vec;
+
+  vec.append(0);
+  int *first = &vec[0];
+
+  for (int i = 1; i < 1000; i++) {
+    vec.append(i);
+  }
+
+  /* Elements never move. */
+  test_assert(&vec[0] == first);
+  test_assert(vec.size() == 1000);
+  test_assert(vec.chunk_count() == 16);
+  test_assert(vec.chunk(15).size() == 1000 - 15 * 64);
+
+  bool ok = true;
+  for (int i = 0; i < 1000; i++) {
+    ok = ok && vec[i] == i;
+  }
+  test_assert(ok);
+
+  int expect = 0;
+  for (int value : vec) {
+    ok = ok && value == expect++;
+  }
+  test_assert(ok && expect == 1000);
+
+  test_assert(vec.pop_back() == 999);
+  vec.resize(100);
+  test_assert(vec.last() == 99);
+  vec.resize(130);
+  test_assert(vec[129] == 0);
+  test_assert(vec.chunk_count() == 3);
+}
+
+static void test_chunks()
+{
+  SegmentedVector<float, 256> vec;
+  vec.resize(10000);
+
+  for (int c : vec.chunk_range()) {
+    for (float &f : vec.chunk(c)) {
+      f = 1.0f;
+    }
+  }
+
+  std::atomic<int> total = 0;
+  task::parallel_for(
+      vec.chunk_range(),
+      [&](IndexRange range) {
+        int sum = 0;
+        for (int c : range) {
+          for (float f : vec.chunk(c)) {
+            sum += int(f);
+          }
+        }
+        total += sum;
+      },
+      3);
+
+  test_assert(total == 10000);
+}
+
+static void test_objects()
+{
+  SegmentedVector<string, 16> strings;
+
+  for (int i = 0; i < 100; i++) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "element %d", i);
+    strings.grow_one(buf);
+  }
+
+  SegmentedVector<string, 16> copy = strings;
+  SegmentedVector<string, 16> moved = std::move(strings);
+
+  test_assert(strings.size() == 0);
+  test_assert(strcmp(moved[42].c_str(), "element 42") == 0);
+  test_assert(strcmp(copy.last().c_str(), "element 99") == 0);
+
+  copy.clear();
+  copy.append("again");
+  test_assert(copy.size() == 1);
+}
+
+int main()
+{
+  test_append();
+  test_chunks();
+  test_objects();
+
+  return test_end();
+}
@@ -36,6 +36,58 @@ int test_remove()
   return retval;
 }
 
+/* Grows from the inline table to the heap and back through clear(). */
+static void test_size()
+{
+  using namespace litestl::util;
+  Set<int> set;
+
+  for (int i = 0; i < 10000; i++) {
+    test_assert(set.add(i * 16));
+    test_assert(!set.add(i * 16));
+  }
+  test_assert(set.size() == 10000);
+
+  for (int i = 0; i < 10000; i += 2) {
+    test_assert(set.remove(i * 16));
+  }
+  test_assert(set.size() == 5000 && set.contains(16) && !set.contains(0));
+
+  Set<int> copy = set;
+  set.clear();
+  test_assert(set.size() == 0 && !set.contains(16));
+  test_assert(copy.size() == 5000 && copy.contains(16));
+
+  int count = 0;
+  for (int key : copy) {
+    test_assert(key % 32 == 16);
+    count++;
+  }
+  test_assert(count == 5000);
+}
+
+/* String keys searched and added with other string types. */
+static void test_transparent_keys()
+{
+  using namespace litestl::util;
+  Set<string> set;
+
+  test_assert(set.add(stringref("alpha")) && set.add("beta"));
+  test_assert(!set.add(stringref("alpha")) && !set.add("beta") && set.size() == 2);
+
+  const char *buffer = "alphabet";
+  test_assert(set.contains(stringref(buffer, 5)) && !set.contains(stringref(buffer)));
+  test_assert(set[stringref(buffer, 5)] && set["beta"]);
+
+  test_assert(set.remove(stringref(buffer, 5)) && !set.contains("alpha"));
+  test_assert(!set.remove("alpha") && set.size() == 1);
+
+  Set<stringref> refs;
+  string beta("beta");
+  refs.add("beta");
+  test_assert(refs.contains(beta) && refs.remove(beta) && refs.size() == 0);
+}
+
 int main()
 {
   using namespace litestl::util;
@@ -69,7 +121,7 @@ int main()
 
     Set<string> strset;
 
-    for (int i = 0; i < array_size(strings); i++) {
+    for (int i = 0; i < int(array_size(strings)); i++) {
       strset.add(strings[i]);
     }
 
@@ -82,6 +134,9 @@ int main()
     if (int ret = test_remove()) {
       return ret;
     }
+
+    test_size();
+    test_transparent_keys();
   }
 
   return test_end();
@@ -0,0 +1,180 @@
+#include "test_util.h"
+#include "litestl/math/vector.h"
+#include "litestl/util/rand.h"
+#include "litestl/util/simd_find.h"
+#include "litestl/util/vector.h"
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+test_init;
+
+using namespace litestl;
+using namespace litestl::math;
+using namespace litestl::util;
+
+enum class Kind : uint16_t { A, B, C };
+
+/**
+ * Checks index_of, count, find_all and find_mask against a plain loop for
+ * every value in @p values, over all offsets and lengths up to @p values'
+ * size so heads, bodies and tails are all hit.
+ */
+template <typename T> static bool check(const Vector<T> &values, const T &probe)
+{
+  bool ok = true;
+
+  for (int start = 0; start < 5 && start <= int(values.size()); start++) {
+    for (int end = start; end <= int(values.size()); end += 7) {
+      std::span<const T> items(values.data() + start, size_t(end - start));
+
+      IndexInt first = -1;
+      size_t total = 0;
+      Vector<IndexInt> expect;
+      for (int i = 0; i < int(items.size()); i++) {
+        if (items[i] == probe) {
+          first = first == -1 ? i : first;
+          total++;
+          expect.append(i);
+        }
+      }
+
+      ok = ok && simd::find(items, probe) == first;
+      ok = ok && simd::count(items, probe) == total;
+
+      Vector<IndexInt> found;
+      simd::for_each_match(items, probe, [&](IndexInt i) { found.append(i); });
+      ok = ok && found.size() == expect.size();
+      for (int i = 0; ok && i < int(found.size()); i++) {
+        ok = found[i] == expect[i];
+      }
+
+      uint64_t mask[8];
+      memset(mask, 0xFF, sizeof(mask));
+      simd::find_mask(items, probe, std::span<uint64_t>(mask, 8));
+      for (int i = 0; ok && i < int(items.size()); i++) {
+        ok = bool((mask[i / 64] >> (i % 64)) & 1) == (items[i] == probe);
+      }
+    }
+  }
+
+  return ok;
+}
+
+template <typename T, typename Make> static bool check_type(Make make)
+{
+  Random rand;
+  Vector<T> values;
+
+  /* Few distinct values, so there are many matches and misses. */
+  for (int i = 0; i < 300; i++) {
+    values.append(make(int(rand.get_int() % 6)));
+  }
+
+  bool ok = true;
+  for (int v = 0; v < 7; v++) {
+    ok = ok && check(values, make(v));
+  }
+  return ok;
+}
+
+static void test_types()
+{
+  static int targets[8];
+
+  test_assert(check_type<uint8_t>([](int v) { return uint8_t(v * 50); }));
+  test_assert(check_type<int16_t>([](int v) { return int16_t(v * -1000); }));
+  test_assert(check_type<int>([](int v) { return v * 0x01010101; }));
+  test_assert(check_type<int64_t>([](int v) { return int64_t(v) << 40 | v; }));
+  test_assert(check_type<int *>([](int v) { return targets + v; }));
+  test_assert(check_type<Kind>([](int v) { return Kind(v % 3); }));
+  test_assert(check_type<float>([](int v) { return float(v) * 0.5f; }));
+  test_assert(check_type<double>([](int v) { return double(v) * 1e100; }));
+  test_assert(
+      check_type<float2>([](int v) { return float2(float(v % 2), float(v / 2)); }));
+  test_assert(
+      check_type<float4>([](int v) { return float4(1.0f, 2.0f, 3.0f, float(v)); }));
+  test_assert(check_type<int2>([](int v) { return int2(v % 2, v / 2); }));
+
+  /* Not 1, 2, 4 or 8 bytes, these take the scalar path. */
+  test_assert(!simd::is_vectorized<float3>() && !simd::is_vectorized<float4>());
+  test_assert(check_type<float3>([](int v) { return float3(float(v), 0.0f, 1.0f); }));
+
+#if defined(__SSE2__)
+  test_assert(simd::is_vectorized<int>() && simd::is_vectorized<float2>());
+#endif
+}
+
+static void test_float_semantics()
+{
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  Vector<float> values;
+
+  for (int i = 0; i < 40; i++) {
+    values.append(float(i));
+  }
+  values[3] = nan;
+  values[20] = -0.0f;
+  values[0] = 7.0f;
+
+  /* Same as operator==: NaN matches nothing, -0.0 matches 0.0. */
+  test_assert(values.index_of(nan) == -1);
+  test_assert(values.index_of(0.0f) == 20);
+  test_assert(values.count(7.0f) == 2);
+
+  Vector<IndexInt> sevens = values.find_all(7.0f);
+  test_assert(sevens.size() == 2 && sevens[0] == 0 && sevens[1] == 7);
+}
+
+static void test_vector()
+{
+  Vector<int> vec;
+  for (int i = 0; i < 1000; i++) {
+    vec.append(i % 100);
+  }
+
+  test_assert(vec.index_of(99) == 99);
+  test_assert(vec.index_of(1000) == -1);
+  test_assert(vec.contains(42) && !vec.contains(-1));
+  test_assert(vec.count(5) == 10);
+  test_assert(vec.find_all(5).size() == 10 && vec.find_all(5)[9] == 905);
+
+  test_assert(!vec.append_once(5));
+  test_assert(vec.append_once(100));
+  test_assert(vec.remove(100) && vec.size() == 1000);
+
+  Vector<float3> points;
+  points.append(float3(1.0f, 2.0f, 3.0f));
+  points.append(float3(4.0f, 5.0f, 6.0f));
+  test_assert(points.index_of(float3(4.0f, 5.0f, 6.0f)) == 1);
+}
+
+/* More matches than a counting lane holds before it is emptied. */
+static void test_count_many()
+{
+  Vector<uint8_t> bytes;
+  bytes.resize(100003);
+  for (IndexInt i = 0; i < IndexInt(bytes.size()); i++) {
+    bytes[i] = uint8_t(i % 3 == 0 ? 7 : 1);
+  }
+  test_assert(bytes.count(7) == 33335 && bytes.count(1) == 66668);
+
+  Vector<int16_t> shorts;
+  shorts.resize(1 << 21);
+  for (int16_t &s : shorts) {
+    s = -2;
+  }
+  shorts[0] = 5;
+  test_assert(shorts.count(-2) == (1 << 21) - 1);
+}
+
+int main()
+{
+  test_types();
+  test_float_semantics();
+  test_vector();
+  test_count_many();
+
+  return test_end();
+}
@@ -0,0 +1,120 @@
+#include "test_util.h"
+#include "litestl/math/vector.h"
+#include "litestl/util/alloc.h"
+#include "litestl/util/arena.h"
+#include "litestl/util/soa_vector.h"
+#include "litestl/util/string.h"
+
+#include <cstdint>
+#include <cstring>
+
+test_init;
+
+using namespace litestl;
+using namespace litestl::math;
+using namespace litestl::util;
+
+static void test_columns()
+{
+  SoAVector<float3, float3, int> points;
+
+  for (int i = 0; i < 1000; i++) {
+    points.append(float3(float(i)), float3(0.0f, 0.0f, 1.0f), i % 3);
+  }
+
+  test_assert(points.size() == 1000);
+  test_assert(points.capacity() >= 1000);
+
+  /* Columns are contiguous and cache line aligned. */
+  test_assert(uintptr_t(points.column<0>().data()) % 64 == 0);
+  test_assert(uintptr_t(points.column<1>().data()) % 64 == 0);
+  test_assert(uintptr_t(points.column<2>().data()) % 64 == 0);
+  test_assert(points.column<2>().size() == 1000);
+
+  for (float3 &co : points.column<0>()) {
+    co *= 2.0f;
+  }
+
+  auto [co, no, flag] = points[500];
+  test_assert(co[0] == 1000.0f && no[2] == 1.0f && flag == 500 % 3);
+
+  /* Rows are references into the columns. */
+  flag = 7;
+  test_assert(points.column<2>()[500] == 7);
+
+  auto [co2, no2, flag2] = points.grow_one();
+  test_assert(co2[0] == 0.0f && flag2 == 0);
+  test_assert(points.size() == 1001);
+
+  points.pop_back();
+  auto last = points.pop_back();
+  test_assert(std::get<0>(last)[0] == 1998.0f);
+
+  points.resize(10);
+  test_assert(points.size() == 10);
+  test_assert(std::get<2>(points[9]) == 0);
+
+  points.resize(20);
+  test_assert(std::get<2>(points[19]) == 0 && std::get<0>(points[19])[1] == 0.0f);
+
+  int sum = 0;
+  for (int i : points.index_range()) {
+    sum += std::get<2>(points[i]);
+  }
+  test_assert(sum == 0 + 1 + 2 + 0 + 1 + 2 + 0 + 1 + 2 + 0);
+}
+
+static void test_objects()
+{
+  SoAVector<int, string> names;
+
+  for (int i = 0; i < 100; i++) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "name %d", i);
+    names.append(i, string(buf));
+  }
+
+  SoAVector<int, string> copy = names;
+  SoAVector<int, string> moved = std::move(names);
+
+  test_assert(names.size() == 0);
+  test_assert(copy.size() == 100 && moved.size() == 100);
+  test_assert(strcmp(std::get<1>(copy[42]).c_str(), "name 42") == 0);
+  test_assert(strcmp(moved.column<1>()[99].c_str(), "name 99") == 0);
+
+  copy = moved;
+  moved.clear();
+  test_assert(moved.size() == 0 && copy.size() == 100);
+  test_assert(strcmp(std::get<1>(copy[0]).c_str(), "name 0") == 0);
+}
+
+/* Columns drawn from an arena, through the allocation policy. */
+static void test_arena_allocator()
+{
+  alloc::Arena arena(4096);
+  const int64_t heap_size = alloc::getMemorySize();
+
+  {
+    BasicSoAVector<alloc::ArenaAllocator, float3, int> points{
+        alloc::ArenaAllocator(arena)};
+    for (int i = 0; i < 1000; i++) {
+      points.append(float3(float(i)), i);
+    }
+
+    test_assert(uintptr_t(points.column<1>().data()) % 64 == 0);
+    test_assert(std::get<1>(points[999]) == 999);
+    test_assert(alloc::getMemorySize() == heap_size);
+    test_assert(arena.used() > 1000 * (sizeof(float3) + sizeof(int)));
+  }
+
+  arena.reset();
+}
+
+int main()
+{
+  test_columns();
+  test_objects();
+  test_arena_allocator();
+
+  return test_end();
+}
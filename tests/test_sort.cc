@@ -0,0 +1,191 @@
+#include "test_util.h"
+#include "litestl/util/parallel_sort.h"
+#include "litestl/util/radix_sort.h"
+#include "litestl/util/rand.h"
+#include "litestl/util/string.h"
+#include "litestl/util/vector.h"
+
+#include <cmath>
+#include <cstring>
+
+test_init;
+
+using namespace litestl;
+using namespace litestl::util;
+
+struct Record {
+  int key;
+  int order;
+};
+
+static bool compare_int(int a, int b)
+{
+  return a < b;
+}
+
+static void test_parallel_sort()
+{
+  /* Sizes around the serial cutoff and uneven run splits. */
+  const int sizes[] = {0, 1, 1000, 1 << 16, (1 << 18) + 7};
+
+  for (int size : sizes) {
+    for (int threads : {1, 2, 3, 8}) {
+      Vector<int> vec;
+      Vector<int> expect;
+      Random rand(uint32_t(size + threads));
+
+      for (int i = 0; i < size; i++) {
+        vec.append(int(rand.get_int()));
+        expect.append(vec.last());
+      }
+
+      vec.parallel_sort(
+          [](int a, int b) { return a < b ? -1 : (a > b ? 1 : 0); }, threads);
+      std::sort(expect.begin(), expect.end(), compare_int);
+
+      test_assert(vec.size() == expect.size());
+      test_assert(memcmp(vec.data(), expect.data(), sizeof(int) * size) == 0);
+    }
+  }
+}
+
+static void test_parallel_stable_sort()
+{
+  Vector<Record> vec;
+  Random rand;
+
+  /* Few distinct keys, so most elements have equal neighbours. */
+  for (int i = 0; i < (1 << 18) + 3; i++) {
+    vec.append({int(rand.get_int() % 256), i});
+  }
+
+  vec.parallel_stable_sort(
+      [](const Record &a, const Record &b) { return a.key - b.key; }, 8);
+
+  bool ok = true;
+  for (int i = 1; i < int(vec.size()); i++) {
+    const Record &a = vec[i - 1];
+    const Record &b = vec[i];
+    ok = ok && (a.key < b.key || (a.key == b.key && a.order < b.order));
+  }
+  test_assert(ok);
+}
+
+static void test_parallel_sort_objects()
+{
+  Vector<string> strings;
+
+  for (int i = 0; i < 1 << 17; i++) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%08d", (i * 7919) % (1 << 17));
+    strings.append(buf);
+  }
+
+  strings.parallel_sort(
+      [](const string &a, const string &b) { return strcmp(a.c_str(), b.c_str()); }, 4);
+
+  bool ok = true;
+  for (int i = 0; i < int(strings.size()); i++) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%08d", i);
+    ok = ok && strcmp(strings[i].c_str(), buf) == 0;
+  }
+  test_assert(ok);
+}
+
+static void test_radix_sort()
+{
+  for (int size : {0, 1, 50, 1000, 100000}) {
+    Vector<int> ints;
+    Vector<uint64_t> wide;
+    Vector<float> floats;
+    Random rand = Random(uint32_t(size));
+
+    for (int i = 0; i < size; i++) {
+      const int value = int(rand.get_int()) - int(Random::max_value / 2);
+      ints.append(value);
+      wide.append(uint64_t(rand.get_int()) << 40 | uint64_t(i));
+      floats.append(float(value) * 0.25f);
+    }
+    if (size > 2) {
+      floats[0] = -0.0f;
+      floats[1] = 0.0f;
+    }
+
+    Vector<int> expect_ints = ints;
+    Vector<uint64_t> expect_wide = wide;
+    Vector<float> expect_floats = floats;
+    std::sort(expect_ints.begin(), expect_ints.end());
+    std::sort(expect_wide.begin(), expect_wide.end());
+    std::stable_sort(expect_floats.begin(), expect_floats.end());
+
+    radix_sort(ints);
+    radix_sort(wide);
+    radix_sort(floats);
+
+    test_assert(memcmp(ints.data(), expect_ints.data(), sizeof(int) * size) == 0);
+    test_assert(memcmp(wide.data(), expect_wide.data(), sizeof(uint64_t) * size) == 0);
+    /* -0.0 == 0.0, so compare values rather than bits there. */
+    bool ok = true;
+    for (int i = 0; i < size; i++) {
+      ok = ok && floats[i] == expect_floats[i];
+    }
+    test_assert(ok);
+  }
+
+  Vector<float> signs = {1.5f, -0.0f, -2.0f, 0.0f, -1e30f, 3.0f};
+  radix_sort(signs);
+  test_assert(signs[0] == -1e30f && signs[1] == -2.0f && signs[5] == 3.0f);
+  test_assert(std::signbit(signs[2]) && !std::signbit(signs[3]));
+}
+
+static void test_radix_sort_records()
+{
+  Vector<Record> vec;
+  Vector<Record> scratch;
+  Random rand;
+
+  for (int round = 0; round < 2; round++) {
+    vec.clear();
+    for (int i = 0; i < 20000; i++) {
+      vec.append({int(rand.get_int() % 1000) - 500, i});
+    }
+
+    radix_sort(vec, [](const Record &r) { return int16_t(r.key); }, scratch);
+
+    bool ok = true;
+    for (int i = 1; i < int(vec.size()); i++) {
+      const Record &a = vec[i - 1];
+      const Record &b = vec[i];
+      ok = ok && (a.key < b.key || (a.key == b.key && a.order < b.order));
+    }
+    test_assert(ok);
+  }
+
+  Vector<uint32_t> keys;
+  Vector<int> values;
+  for (int i = 0; i < 5000; i++) {
+    keys.append(uint32_t(4999 - i) * 2654435761u);
+    values.append(4999 - i);
+  }
+
+  radix_sort_pairs(keys, values);
+
+  bool ok = true;
+  for (int i = 0; i < int(keys.size()); i++) {
+    ok = ok && keys[i] == uint32_t(values[i]) * 2654435761u;
+    ok = ok && (i == 0 || keys[i - 1] <= keys[i]);
+  }
+  test_assert(ok);
+}
+
+int main()
+{
+  test_parallel_sort();
+  test_parallel_stable_sort();
+  test_parallel_sort_objects();
+  test_radix_sort();
+  test_radix_sort_records();
+
+  return test_end();
+}
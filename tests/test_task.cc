@@ -6,14 +6,46 @@
 #include "litestl/util/string.h"
 #include "litestl/util/task.h"
 #include "litestl/util/vector.h"
+#include <atomic>
 #include <cstdio>
 
 test_init;
 
+using namespace litestl;
+using namespace litestl::util;
+
+/* Ranges past 2^31, without touching any memory. */
+static void test_large_range()
+{
+  const IndexInt start = IndexInt(3) << 30;
+  IndexInt expect = start;
+  bool ok = true;
+
+  for (IndexInt i : IndexRange(start, 4)) {
+    ok = ok && i == expect++;
+  }
+  test_assert(ok && expect == start + 4);
+
+  std::atomic<int64_t> covered = 0;
+  std::atomic<int64_t> max_end = 0;
+  task::parallel_for(
+      IndexRange(IndexInt(1) << 32),
+      [&](IndexRange range) {
+        covered += range.size;
+        int64_t end = range.start + range.size;
+        int64_t prev = max_end.load();
+        while (end > prev && !max_end.compare_exchange_weak(prev, end)) {
+        }
+      },
+      IndexInt(3) << 28);
+
+  test_assert(covered == int64_t(1) << 32);
+  test_assert(max_end == int64_t(1) << 32);
+}
+
 int main()
 {
-  using namespace litestl;
-  using namespace litestl::util;
+  test_large_range();
 
   {
     int size = 1 << 25;
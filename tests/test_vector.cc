@@ -1,13 +1,88 @@
 #include "test_util.h"
 #include "litestl/util/alloc.h"
+#include "litestl/util/string.h"
 #include "litestl/util/vector.h"
 #include <cstdio>
+#include <cstring>
 
 test_init;
 
+using namespace litestl::util;
+
+template <typename VectorT>
+static bool equals(const VectorT &vec, std::initializer_list<int> expect)
+{
+  if (vec.size() != expect.size()) {
+    return false;
+  }
+
+  size_t i = 0;
+  for (int value : expect) {
+    if (vec[i++] != value) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* extend, insert, erase and remove_if on a simple type. */
+static void test_bulk()
+{
+  Vector<int, 4> list;
+  const int items[] = {1, 2, 3, 4, 5};
+
+  list.extend(std::span<const int>(items));
+  test_assert(equals(list, {1, 2, 3, 4, 5}));
+
+  /* From our own elements, across a reallocation. */
+  list.extend(std::span<const int>(list.data(), list.size()));
+  test_assert(equals(list, {1, 2, 3, 4, 5, 1, 2, 3, 4, 5}));
+
+  list.erase(IndexRange(2, 5));
+  test_assert(equals(list, {1, 2, 3, 4, 5}));
+
+  list.insert(1, std::span<const int>(items, 2));
+  test_assert(equals(list, {1, 1, 2, 2, 3, 4, 5}));
+  list.insert(int(list.size()), std::span<const int>(list.data(), 3));
+  test_assert(equals(list, {1, 1, 2, 2, 3, 4, 5, 1, 1, 2}));
+
+  test_assert(list.remove_if([](int value) { return value < 3; }) == 7);
+  test_assert(equals(list, {3, 4, 5}));
+
+  Vector<int> other;
+  other.extend(list);
+  other.extend(list.begin(), list.end());
+  test_assert(equals(other, {3, 4, 5, 3, 4, 5}));
+
+  test_assert(other.pop_front() == 3);
+  test_assert(other.remove_at(1, true));
+  test_assert(equals(other, {4, 5, 3, 4}));
+}
+
+/* The same on a type with constructors and destructors. */
+static void test_bulk_objects()
+{
+  Vector<string, 2> list;
+  const string items[] = {"zero", "one", "two", "three"};
+
+  list.extend(std::span<const string>(items));
+  list.insert(1, std::span<const string>(items + 2, 2));
+  test_assert(list.size() == 6);
+  test_assert(strcmp(list[1].c_str(), "two") == 0);
+  test_assert(strcmp(list[3].c_str(), "one") == 0);
+
+  list.erase(IndexRange(0, 2));
+  test_assert(strcmp(list[0].c_str(), "three") == 0);
+
+  list.remove_if([](const string &str) { return str.c_str()[0] == 't'; });
+  test_assert(list.size() == 1);
+  test_assert(strcmp(list[0].c_str(), "one") == 0);
+}
+
 int main()
 {
-  using namespace litestl::util;
+  test_bulk();
+  test_bulk_objects();
 
   {
     Vector<int, 32> list;
@@ -28,6 +103,10 @@ int main()
       i++;
     }
 
+    Vector<int, 32>::iterator it = list.begin() + 10;
+    test_assert(it[5] == 15);
+    test_assert(list.end() - it == size - 10);
+
     list.remove(5);
     list.append_once(5);
     test_assert(list.size() == size);
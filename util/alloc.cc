@@ -1,8 +1,16 @@
+#include "alloc.h"
+#include "alloc_engine.h"
+#include "alloc_profile.h"
+#include "alloc_stats.h"
+#include "arena.h"
 #include "atomicLinkedList.h"
 // #include "compiler_util.h"
+#include <algorithm>
 #include <atomic>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <mutex>
 
 #ifdef WASM
@@ -15,74 +23,528 @@
 
 #define FREE MAKE_TAG('f', 'r', 'e', 'e')
 
-std::atomic<int> memorySize = {0};
-std::atomic<int> permanentMemorySize = {
-    0}; // size of things allocated when disableLeakTracking > 0
 std::atomic<int> allocatingPermanent = {0};
 
 enum { MEM_PERMANENT = 1 << 0 };
 
-struct MemHead {
+struct alignas(16) MemHead {
   int tag1;
   int tag2 : 24;
   int flag : 8;
 
   // MemHeads are their own nodes
   struct MemHead *next, *prev;
-  struct MemHead *data()
+  /* Link while queued on the owner's remote free stack. */
+  struct MemHead *remote_next;
+  static MemHead *&remoteNext(MemHead *mh)
   {
-    return this;
-  }
-  static MemHead *wrapData(MemHead *mh)
-  {
-    return mh;
+    return mh->remote_next;
   }
 
   size_t size;
   const char *tag;
   void *listref;
-#ifdef WASM
-  // pad to 8 bytes
-  char _pad[4];
-#endif
 };
-static_assert(sizeof(MemHead) % 8 == 0);
+static_assert(sizeof(MemHead) % 16 == 0);
+
+/**
+ * Each thread creates its own list of memory blocks, which only that thread
+ * links and unlinks.  Blocks released by other threads are queued on the
+ * list's remote stack and unlinked (and freed) by the owner on its next
+ * allocation.
+ *
+ * Byte counters are likewise per thread and only ever written by their own
+ * thread, so a thread that frees another thread's block simply goes
+ * negative; getMemorySize() sums all counters.
+ *
+ * On thread exit the list is marked orphaned, its remaining blocks and byte
+ * counts move to `orphan_list`, and the list is left for the next new thread
+ * to claim, the way alloc_stats.cc recycles ThreadStats.  So there are only
+ * ever as many lists as threads alive at once.  While orphaned, remote frees
+ * unlink directly under `orphan_mutex`.
+ */
+struct alignas(64) MemList : public litestl::util::AtomicLinkedList<MemHead> {
+  constexpr MemList(bool orphaned_ = false) : orphaned(orphaned_)
+  {
+  }
+
+  std::atomic<int64_t> memorySize = {0};
+  std::atomic<int64_t> permanentMemorySize = {0};
+  std::atomic<bool> orphaned;
+  /* Claimed by a live thread. */
+  std::atomic<bool> in_use = {false};
+  std::mutex orphan_mutex;
+  MemList *next_list = nullptr;
+};
 
-using MemHeadPtr = MemHead *;
-using MemList = litestl::util::AtomicLinkedList<MemHead, MemHead *>;
+/** All lists, for summing counters and reuse.  Push-only. */
+static std::atomic<MemList *> all_mem_lists = {nullptr};
 
 /**
- * Each thread creates its own list of memory blocks.
- * We allow these to leak when threads are destroyed
- * (remember the actual memory blocks are kept alive)
- * though this shouldn't happen if you use the
- * `litestil::task` api.
+ * Blocks of exited threads, and their byte counts.  Never owned, so always
+ * linked and unlinked under its `orphan_mutex`.  Threads allocating from
+ * thread destructors after their own list was handed back use it too.
  */
+static constinit MemList orphan_list(true);
+
 thread_local MemList *atomic_mem_list = nullptr;
 
+/** Hands the calling thread's list back on thread exit. */
+struct MemListOwner {
+  MemList *list = nullptr;
+
+  ~MemListOwner();
+};
+thread_local MemListOwner mem_list_owner;
+
+static void drainRemote(MemList *list);
+
+/** Claims a list no live thread uses, or registers a new one. */
+static MemList *claimMemList()
+{
+  for (MemList *list = all_mem_lists.load(std::memory_order_acquire); list;
+       list = list->next_list)
+  {
+    bool in_use = false;
+    if (!list->in_use.load(std::memory_order_relaxed) &&
+        list->in_use.compare_exchange_strong(in_use, true, std::memory_order_acquire))
+    {
+      /* Remote frees that raced with the previous owner's exit may still be queued. */
+      std::lock_guard guard(list->orphan_mutex);
+      drainRemote(list);
+      list->orphaned.store(false);
+      return list;
+    }
+  }
+
+  MemList *list = new MemList();
+  list->in_use.store(true, std::memory_order_relaxed);
+
+  MemList *head = all_mem_lists.load(std::memory_order_relaxed);
+  do {
+    list->next_list = head;
+  } while (!all_mem_lists.compare_exchange_weak(head, list));
+
+  return list;
+}
+
 static MemList *getMemList()
 {
   if (!atomic_mem_list) {
-    atomic_mem_list = new MemList();
+    MemList *list = claimMemList();
+
+    atomic_mem_list = list;
+    mem_list_owner.list = list;
   }
   return atomic_mem_list;
 }
+
+/**
+ * Adds @p delta to one of @p list's byte counters.  Only the owner writes a
+ * thread's counters; `orphan_list` is shared, so it gets an atomic add.
+ */
+static void addMemorySize(MemList *list, bool permanent, int64_t delta)
+{
+  std::atomic<int64_t> &counter = permanent ? list->permanentMemorySize
+                                            : list->memorySize;
+
+  if (list == &orphan_list) {
+    counter.fetch_add(delta, std::memory_order_relaxed);
+    return;
+  }
+  counter.store(counter.load(std::memory_order_relaxed) + delta,
+                std::memory_order_relaxed);
+}
+
+static void freeBlock(MemHead *mem)
+{
+#if defined(ALLOC_SAVE_STACK_TRACES) && defined(WASM)
+  free(static_cast<void *>(const_cast<char *>(mem->tag)));
+#endif
+
+  litestl::alloc::engine::release(static_cast<void *>(mem));
+}
+
+/** The list @p mem is linked into; it changes once, when its thread exits. */
+static MemList *blockList(MemHead *mem)
+{
+  void *list = std::atomic_ref(mem->listref).load(std::memory_order_relaxed);
+  return static_cast<MemList *>(list);
+}
+
+/**
+ * Unlinks and frees blocks queued on @p list by other threads.  A thread that
+ * read a block's list just before the block moved to `orphan_list` queues it
+ * on the old list, so those are unlinked from `orphan_list` instead.
+ */
+static void drainRemote(MemList *list)
+{
+  MemHead *mem = list->remote.exchange(nullptr, std::memory_order_seq_cst);
+
+  while (mem) {
+    MemHead *next = mem->remote_next;
+
+    if (blockList(mem) == list) {
+      list->remove(mem);
+    } else {
+      std::lock_guard guard(orphan_list.orphan_mutex);
+      orphan_list.remove(mem);
+    }
+    freeBlock(mem);
+
+    mem = next;
+  }
+}
+
+MemListOwner::~MemListOwner()
+{
+  if (!list) {
+    return;
+  }
+
+  /* Set orphaned before the last drain, so a concurrent remote free either lands in
+   * this drain or sees the flag and drains itself. */
+  list->orphaned.store(true);
+
+  {
+    std::lock_guard guard(list->orphan_mutex);
+    drainRemote(list);
+
+    std::lock_guard orphan_guard(orphan_list.orphan_mutex);
+    for (MemHead *mem = list->first; mem; mem = mem->next) {
+      std::atomic_ref(mem->listref).store(static_cast<void *>(&orphan_list),
+                                          std::memory_order_relaxed);
+    }
+
+    if (list->first) {
+      if (orphan_list.last) {
+        orphan_list.last->next = list->first;
+        list->first->prev = orphan_list.last;
+      } else {
+        orphan_list.first = list->first;
+      }
+      orphan_list.last = list->last;
+      list->first = list->last = nullptr;
+    }
+
+    addMemorySize(&orphan_list, false, list->memorySize.exchange(0));
+    addMemorySize(&orphan_list, true, list->permanentMemorySize.exchange(0));
+  }
+
+  /* Late allocations from other thread destructors go to the shared list. */
+  atomic_mem_list = &orphan_list;
+  list->in_use.store(false, std::memory_order_release);
+  list = nullptr;
+}
+
 namespace litestl::alloc {
+void set_large_block_config(const LargeBlockConfig &config)
+{
+  engine::set_large_config(config);
+}
+
+LargeBlockConfig get_large_block_config()
+{
+  return engine::get_large_config();
+}
+
 #ifndef NO_DEBUG_ALLOC
 
+int64_t getMemorySize()
+{
+  int64_t size = orphan_list.memorySize.load(std::memory_order_relaxed);
+
+  for (MemList *list = all_mem_lists.load(); list; list = list->next_list) {
+    size += list->memorySize.load(std::memory_order_relaxed);
+  }
+
+  return size;
+}
+
+int64_t getPermanentMemorySize()
+{
+  int64_t size = orphan_list.permanentMemorySize.load(std::memory_order_relaxed);
+
+  for (MemList *list = all_mem_lists.load(); list; list = list->next_list) {
+    size += list->permanentMemorySize.load(std::memory_order_relaxed);
+  }
+
+  return size;
+}
+
+namespace detail {
+int mem_list_count()
+{
+  int count = 0;
+
+  for (MemList *list = all_mem_lists.load(); list; list = list->next_list) {
+    count++;
+  }
+
+  return count;
+}
+} // namespace detail
+
+#ifdef COMPACT_DEBUG_ALLOC
+/**
+ * Compact block header.  Blocks aren't linked, leak reports find them by
+ * scanning the engine's spans for the canary.  The engine's free list
+ * overwrites the first 8 bytes of released blocks, so the canary comes after
+ * them and still reads FREE on a double free.
+ */
+struct alignas(16) CompactHead {
+  /* Requested size, UINT32_MAX if larger (the block size is used then). */
+  uint32_t size;
+  uint32_t unused;
+  int tag1;
+  /* Interned tag, see alloc_stats.h. */
+  uint16_t tag;
+  uint8_t flag;
+  uint8_t unused2;
+};
+static_assert(sizeof(CompactHead) == 16);
+
+/* Marks a block with padding before its header, `size` holds the header's offset. */
+#define ALIGNED_TAG MAKE_TAG('a', 'l', 'g', 'n')
+
+static size_t head_size(const CompactHead *mem)
+{
+  if (mem->size != UINT32_MAX) {
+    return mem->size;
+  }
+
+  /* Usable size counts from the block start, which is the header here. */
+  return engine::block_info(mem).size - sizeof(CompactHead);
+}
+
 void print_block(const void *vmem)
 {
-  std::lock_guard guard(getMemList()->mutex);
+  const CompactHead *mem = static_cast<const CompactHead *>(vmem);
+  printf("\"%s:%d\"  (%p)\n", detail::tag_name(mem->tag), int(head_size(mem)), mem + 1);
+}
+
+struct BlockScan {
+  bool print_permanent;
+  bool found;
+};
+
+static void scan_block(void *block, size_t block_size, void *userdata)
+{
+  BlockScan *scan = static_cast<BlockScan *>(userdata);
+  const CompactHead *mem = static_cast<const CompactHead *>(block);
+
+  if (mem->tag1 == ALIGNED_TAG && mem->size < block_size - sizeof(CompactHead)) {
+    mem = reinterpret_cast<const CompactHead *>(static_cast<char *>(block) + mem->size);
+  }
+  if (mem->tag1 != TAG1) {
+    return;
+  }
+
+  scan->found = true;
+  if (!(mem->flag & MEM_PERMANENT) != scan->print_permanent) {
+    print_block(mem);
+  }
+}
+
+bool print_blocks(bool printPermanent)
+{
+  BlockScan scan = {printPermanent, false};
+  engine::for_each_block(scan_block, &scan);
+  return scan.found;
+}
+
+/** Allocates a tracked block whose user pointer is aligned to @p align (at least 16). */
+static void *alloc_tracked(const char *tag, size_t size, size_t align)
+{
+  if (Arena *arena = detail::current_arena()) {
+    return arena->alloc(size, align);
+  }
+
+  size_t newsize = size + sizeof(CompactHead) + (align - alignof(CompactHead));
+  const uint16_t tag_id = detail::tag_id(tag);
+  const bool sampled = detail::profile_should_sample(size);
+  size_t block_size;
+  const uint16_t block_tag = sampled ? tag_id | detail::sampled_tag : tag_id;
+  char *block = static_cast<char *>(engine::alloc(newsize, block_tag, &block_size));
+
+  if (block == nullptr) {
+    fprintf(stderr, "allocation error of size %d\n", int(size));
+    return nullptr;
+  }
+
+  detail::stats_alloc(tag_id, size, block_size);
+
+  const uintptr_t user =
+      (uintptr_t(block) + sizeof(CompactHead) + align - 1) & ~(align - 1);
+  CompactHead *mem = reinterpret_cast<CompactHead *>(user) - 1;
+
+  if (mem != reinterpret_cast<CompactHead *>(block)) {
+    /* Padding is at least align - 16 >= 16 bytes, room for the marker. */
+    CompactHead *marker = reinterpret_cast<CompactHead *>(block);
+    marker->tag1 = ALIGNED_TAG;
+    marker->size = uint32_t(reinterpret_cast<char *>(mem) - block);
+  }
+
+  if (sampled) {
+    detail::profile_alloc(mem, size);
+  }
+
+  mem->tag1 = TAG1;
+  mem->tag = tag_id;
+  mem->size = uint32_t(std::min(size, size_t(UINT32_MAX)));
+  mem->flag = 0;
+
+  MemList *list = getMemList();
+  if (allocatingPermanent.load()) {
+    mem->flag |= MEM_PERMANENT;
+    addMemorySize(list, true, int64_t(size + sizeof(CompactHead)));
+  } else {
+    addMemorySize(list, false, int64_t(size + sizeof(CompactHead)));
+  }
+
+  return reinterpret_cast<void *>(mem + 1);
+}
+
+void *alloc(const char *tag, size_t size)
+{
+  return alloc_tracked(tag, size, alignof(CompactHead));
+}
+
+void *alloc_aligned(const char *tag, size_t size, size_t align)
+{
+  return alloc_tracked(tag, size, std::max(align, alignof(CompactHead)));
+}
+
+bool check_mem(void *ptr)
+{
+  if (!ptr) {
+    return false;
+  }
+
+  if (reinterpret_cast<size_t>(ptr) < 1024) {
+    fprintf(stderr, "litestl::alloc::check_mem: invalid pointer\n");
+    return false;
+  }
+
+  CompactHead *mem = static_cast<CompactHead *>(ptr) - 1;
+
+  if (mem->tag1 == FREE) {
+    fprintf(stderr, "litestl::alloc::check_mem: error: double free\n");
+    return false;
+  } else if (mem->tag1 != TAG1) {
+    fprintf(stderr, "litestl::alloc::check_mem: error: invalid memory block\n");
+    return false;
+  }
+
+  return true;
+}
+
+void *realloc(const char *tag, void *ptr, size_t old_size, size_t size)
+{
+  if (!ptr) {
+    return alloc(tag, size);
+  }
+
+  if (engine::is_arena(ptr)) {
+    if (Arena *arena = detail::current_arena()) {
+      return arena->realloc(ptr, old_size, size);
+    }
+  } else if (check_mem(ptr)) {
+    CompactHead *mem = static_cast<CompactHead *>(ptr) - 1;
+    const engine::BlockInfo info = engine::block_info(static_cast<void *>(mem));
+    const size_t prev_size = head_size(mem);
+    size_t block_size;
+
+    CompactHead *newmem = static_cast<CompactHead *>(
+        engine::resize(static_cast<void *>(mem),
+                       size + sizeof(CompactHead),
+                       &block_size));
+
+    if (newmem) {
+      const uint16_t tag_id = info.tag & ~detail::sampled_tag;
+      detail::stats_release(tag_id, info.size);
+      detail::stats_alloc(tag_id, size, block_size);
+      if (info.tag & detail::sampled_tag) {
+        detail::profile_resize(mem, newmem, size);
+      }
+
+      MemList *list = getMemList();
+      addMemorySize(
+          list, newmem->flag & MEM_PERMANENT, int64_t(size) - int64_t(prev_size));
+      newmem->size = uint32_t(std::min(size, size_t(UINT32_MAX)));
+      return static_cast<void *>(newmem + 1);
+    }
+  }
+
+  void *newptr = alloc(tag, size);
+  if (newptr) {
+    memcpy(newptr, ptr, std::min(old_size, size));
+    release(ptr);
+  }
+
+  return newptr;
+}
+
+void release(void *ptr)
+{
+  if (!ptr) {
+    fprintf(stderr, "Null pointer dereference\n");
+    return;
+  }
+
+  /* Arena memory is released in bulk by the arena. */
+  if (engine::is_arena(ptr)) {
+    return;
+  }
+
+  if (!check_mem(ptr)) {
+    return;
+  }
+
+  CompactHead *mem = static_cast<CompactHead *>(ptr) - 1;
+
+  engine::BlockInfo info = engine::block_info(static_cast<void *>(mem));
+  detail::stats_release(info.tag & ~detail::sampled_tag, info.size);
+  if (info.tag & detail::sampled_tag) {
+    detail::profile_release(mem);
+  }
+
+  MemList *list = getMemList();
+  addMemorySize(
+      list, mem->flag & MEM_PERMANENT, -int64_t(head_size(mem) + sizeof(CompactHead)));
 
+  mem->tag1 = FREE;
+  engine::release(static_cast<void *>(mem));
+}
+
+namespace detail {
+const char *getMemoryTag(void *vmem)
+{
+  if (engine::is_arena(vmem)) {
+    return "arena";
+  }
+  if (!check_mem(vmem)) {
+    return nullptr;
+  }
+  return tag_name(static_cast<CompactHead *>(vmem)[-1].tag);
+}
+} // namespace detail
+#else
+void print_block(const void *vmem)
+{
   const MemHead *mem = static_cast<const MemHead *>(vmem);
   printf("\"%s:%d\"  (%p)\n", mem->tag, int(mem->size), mem + 1);
 }
 
 bool print_blocks(bool printPermanent)
 {
-  std::lock_guard guard(getMemList()->mutex);
+  MemList *list = getMemList();
+
+  if (!list->orphaned) {
+    drainRemote(list);
+  }
 
-  MemHead *mem = getMemList()->first;
+  MemHead *mem = list->first;
   while (mem) {
     if (!(mem->flag & MEM_PERMANENT) != printPermanent) {
       printf("\"%s:%d\"  (%p)\n", mem->tag, int(mem->size), mem + 1);
@@ -90,29 +552,38 @@ bool print_blocks(bool printPermanent)
     mem = mem->next;
   }
 
-  return getMemList()->first != nullptr;
+  return list->first != nullptr;
 }
 
-int getMemorySize()
+/** Allocates a tracked block whose user pointer is aligned to @p align (at least 16). */
+static void *alloc_tracked(const char *tag, size_t size, size_t align)
 {
-  return memorySize.load();
-}
+  if (Arena *arena = detail::current_arena()) {
+    return arena->alloc(size, align);
+  }
 
-int getPermanentMemorySize()
-{
-  return permanentMemorySize.load();
-}
+  /* The engine aligns to 16, any excess alignment is padding before the MemHead. */
+  size_t newsize = size + sizeof(MemHead) + (align - alignof(MemHead));
+  const uint16_t tag_id = detail::tag_id(tag);
+  const bool sampled = detail::profile_should_sample(size);
+  size_t block_size;
+  const uint16_t block_tag = sampled ? tag_id | detail::sampled_tag : tag_id;
+  char *block = static_cast<char *>(engine::alloc(newsize, block_tag, &block_size));
 
-void *alloc(const char *tag, size_t size)
-{
-  size_t newsize = size + sizeof(MemHead);
-  MemHead *mem = reinterpret_cast<MemHead *>(malloc(newsize));
-
-  if (mem == nullptr) {
+  if (block == nullptr) {
     fprintf(stderr, "allocation error of size %d\n", int(size));
     return nullptr;
   }
 
+  detail::stats_alloc(tag_id, size, block_size);
+
+  const uintptr_t user = (uintptr_t(block) + sizeof(MemHead) + align - 1) & ~(align - 1);
+  MemHead *mem = reinterpret_cast<MemHead *>(user) - 1;
+
+  if (sampled) {
+    detail::profile_alloc(mem, size);
+  }
+
 #if defined(ALLOC_SAVE_STACK_TRACES) && defined(WASM)
   tag = litestl::util::wasm::getStackTrace(tag);
 #endif
@@ -121,22 +592,43 @@ void *alloc(const char *tag, size_t size)
   mem->tag2 = TAG2;
   mem->tag = tag;
   mem->size = size;
-  mem->listref = static_cast<void *>(getMemList());
   mem->flag = 0;
 
+  MemList *list = getMemList();
+  mem->listref = static_cast<void *>(list);
+
   int permanentMem = allocatingPermanent.load();
   if (permanentMem) {
     mem->flag |= MEM_PERMANENT;
-    std::atomic_fetch_add(&permanentMemorySize, mem->size + sizeof(MemHead));
+    addMemorySize(list, true, int64_t(mem->size + sizeof(MemHead)));
   } else {
-    std::atomic_fetch_add(&memorySize, mem->size + sizeof(MemHead));
+    addMemorySize(list, false, int64_t(mem->size + sizeof(MemHead)));
   }
 
-  getMemList()->push(std::move(mem));
+  if (list->orphaned) {
+    /* Allocating from a thread destructor after our list was orphaned. */
+    std::lock_guard guard(list->orphan_mutex);
+    list->push(mem);
+  } else {
+    if (list->hasRemote()) {
+      drainRemote(list);
+    }
+    list->push(mem);
+  }
 
   return reinterpret_cast<void *>(mem + 1);
 }
 
+void *alloc(const char *tag, size_t size)
+{
+  return alloc_tracked(tag, size, alignof(MemHead));
+}
+
+void *alloc_aligned(const char *tag, size_t size, size_t align)
+{
+  return alloc_tracked(tag, size, std::max(align, alignof(MemHead)));
+}
+
 bool check_mem(void *ptr)
 {
   if (!ptr) {
@@ -162,6 +654,57 @@ bool check_mem(void *ptr)
   return true;
 }
 
+void *realloc(const char *tag, void *ptr, size_t old_size, size_t size)
+{
+  if (!ptr) {
+    return alloc(tag, size);
+  }
+
+  if (engine::is_arena(ptr)) {
+    if (Arena *arena = detail::current_arena()) {
+      return arena->realloc(ptr, old_size, size);
+    }
+  } else if (check_mem(ptr)) {
+    MemHead *mem = static_cast<MemHead *>(ptr) - 1;
+    MemList *list = blockList(mem);
+
+    /* The block moves along with its links, so only our own list can be relinked. */
+    if (list == getMemList() && !list->orphaned) {
+      const engine::BlockInfo info = engine::block_info(static_cast<void *>(mem));
+      size_t block_size;
+
+      list->remove(mem);
+      MemHead *newmem = static_cast<MemHead *>(
+          engine::resize(static_cast<void *>(mem), size + sizeof(MemHead), &block_size));
+
+      if (newmem) {
+        const uint16_t tag_id = info.tag & ~detail::sampled_tag;
+        detail::stats_release(tag_id, info.size);
+        detail::stats_alloc(tag_id, size, block_size);
+        if (info.tag & detail::sampled_tag) {
+          detail::profile_resize(mem, newmem, size);
+        }
+
+        const int64_t delta = int64_t(size) - int64_t(newmem->size);
+        addMemorySize(list, newmem->flag & MEM_PERMANENT, delta);
+        newmem->size = size;
+        list->push(newmem);
+        return static_cast<void *>(newmem + 1);
+      }
+
+      list->push(mem);
+    }
+  }
+
+  void *newptr = alloc(tag, size);
+  if (newptr) {
+    memcpy(newptr, ptr, std::min(old_size, size));
+    release(ptr);
+  }
+
+  return newptr;
+}
+
 void release(void *ptr)
 {
   if (!ptr) {
@@ -169,6 +712,11 @@ void release(void *ptr)
     return;
   }
 
+  /* Arena memory is released in bulk by the arena. */
+  if (engine::is_arena(ptr)) {
+    return;
+  }
+
   if (!check_mem(ptr)) {
     return;
   }
@@ -176,42 +724,49 @@ void release(void *ptr)
   MemHead *mem = static_cast<MemHead *>(ptr);
   mem--;
 
-  bool permanent = mem->flag & MEM_PERMANENT;
+  engine::BlockInfo info = engine::block_info(static_cast<void *>(mem));
+  detail::stats_release(info.tag & ~detail::sampled_tag, info.size);
+  if (info.tag & detail::sampled_tag) {
+    detail::profile_release(mem);
+  }
 
-  MemList *list = static_cast<MemList *>(mem->listref);
+  bool permanent = mem->flag & MEM_PERMANENT;
 
-#if 0
-  std::lock_guard guard(list->mutex);
-  if (mem->next && !check_mem(static_cast<void *>(mem->next + 1))) {
-    fprintf(stderr, "corrupted heap\n");
-    return;
-  }
-  if (mem->prev && !check_mem(static_cast<void *>(mem->prev + 1))) {
-    fprintf(stderr, "corrupted heap\n");
-    return;
-  }
-#endif
+  MemList *list = blockList(mem);
+  MemList *own_list = getMemList();
 
   mem->tag1 = FREE;
 
-  /* Unlink from list. */
-  list->remove(mem);
-
   if (permanent) {
-    std::atomic_fetch_sub(&permanentMemorySize, mem->size + sizeof(MemHead));
+    addMemorySize(own_list, true, -int64_t(mem->size + sizeof(MemHead)));
   } else {
-    std::atomic_fetch_sub(&memorySize, mem->size + sizeof(MemHead));
+    addMemorySize(own_list, false, -int64_t(mem->size + sizeof(MemHead)));
   }
-#if defined(ALLOC_SAVE_STACK_TRACES) && defined(WASM)
-  free(static_cast<void *>(const_cast<char *>(mem->tag)));
-#endif
 
-  free(static_cast<void *>(mem));
+  if (list == own_list && !list->orphaned) {
+    list->remove(mem);
+    freeBlock(mem);
+    return;
+  }
+
+  /* Another thread's block: hand it to the owner. */
+  list->pushRemote(mem);
+
+  if (list->orphaned) {
+    std::lock_guard guard(list->orphan_mutex);
+    /* Unless a new thread claimed the list meanwhile, it drains it then. */
+    if (list->orphaned) {
+      drainRemote(list);
+    }
+  }
 }
 
 namespace detail {
 const char *getMemoryTag(void *vmem)
 {
+  if (engine::is_arena(vmem)) {
+    return "arena";
+  }
   if (!check_mem(vmem)) {
     return nullptr;
   }
@@ -230,4 +785,117 @@ void popPermanentAlloc()
 {
   allocatingPermanent.fetch_sub(1);
 }
-} // namespace litestl::alloc
\ No newline at end of file
+#else
+void *alloc(const char *tag, size_t size)
+{
+  if (Arena *arena = detail::current_arena()) {
+    return arena->alloc(size);
+  }
+
+  const uint16_t tag_id = detail::tag_id(tag);
+  const bool sampled = detail::profile_should_sample(size);
+  size_t block_size;
+  void *ptr =
+      engine::alloc(size, sampled ? tag_id | detail::sampled_tag : tag_id, &block_size);
+
+  if (ptr) {
+    detail::stats_alloc(tag_id, size, block_size);
+    if (sampled) {
+      detail::profile_alloc(ptr, size);
+    }
+  }
+
+  return ptr;
+}
+
+void *alloc_aligned(const char *tag, size_t size, size_t align)
+{
+  if (align <= engine::min_align) {
+    return alloc(tag, size);
+  }
+
+  if (Arena *arena = detail::current_arena()) {
+    return arena->alloc(size, align);
+  }
+
+  /* Over-allocate and align inside the block, engine::release accepts interior
+   * pointers. */
+  const uint16_t tag_id = detail::tag_id(tag);
+  const bool sampled = detail::profile_should_sample(size);
+  size_t block_size;
+  void *ptr = engine::alloc(size + align - engine::min_align,
+                            sampled ? tag_id | detail::sampled_tag : tag_id,
+                            &block_size);
+
+  if (!ptr) {
+    return nullptr;
+  }
+
+  detail::stats_alloc(tag_id, size, block_size);
+
+  /* Profiled by the pointer release() will be given. */
+  void *aligned = reinterpret_cast<void *>((uintptr_t(ptr) + align - 1) & ~(align - 1));
+  if (sampled) {
+    detail::profile_alloc(aligned, size);
+  }
+
+  return aligned;
+}
+
+void *realloc(const char *tag, void *ptr, size_t old_size, size_t size)
+{
+  if (!ptr) {
+    return alloc(tag, size);
+  }
+
+  if (engine::is_arena(ptr)) {
+    if (Arena *arena = detail::current_arena()) {
+      return arena->realloc(ptr, old_size, size);
+    }
+  } else {
+    const engine::BlockInfo info = engine::block_info(ptr);
+    size_t block_size;
+
+    if (void *newptr = engine::resize(ptr, size, &block_size)) {
+      const uint16_t tag_id = info.tag & ~detail::sampled_tag;
+      detail::stats_release(tag_id, info.size);
+      detail::stats_alloc(tag_id, size, block_size);
+      if (info.tag & detail::sampled_tag) {
+        detail::profile_resize(ptr, newptr, size);
+      }
+      return newptr;
+    }
+  }
+
+  void *newptr = alloc(tag, size);
+  if (newptr) {
+    memcpy(newptr, ptr, std::min(old_size, size));
+    release(ptr);
+  }
+
+  return newptr;
+}
+
+void release(void *ptr)
+{
+  if (!ptr) {
+    return;
+  }
+
+  /* Sampled blocks must be dropped from the profile before the block can be reused. */
+  if (detail::heap_profile_used.load(std::memory_order_relaxed)) {
+    if (engine::block_info(ptr).tag & detail::sampled_tag) {
+      detail::profile_release(ptr);
+    }
+  }
+
+  engine::BlockInfo info = {0, 0};
+  engine::release(ptr, &info);
+
+  /* Arena memory has no size. */
+  if (info.size) {
+    detail::stats_release(info.tag & ~detail::sampled_tag, info.size);
+  }
+}
+#endif
+} // namespace litestl::alloc
@@ -2,6 +2,7 @@
 
 #include <utility>
 #include <cstddef>
+#include <cstdint>
 
 /*
  * Leak debugger allocator.
@@ -13,22 +14,80 @@
  * All allocated objects (well, memory blocks) are stored in a linked list,
  * which is used to identify leaks.  This is done by calling alloc::print_blocks,
  * typically on application exit after everything has been deallocated.
+ *
+ * Memory itself comes from a thread-caching size-class allocator (see
+ * alloc_engine.h).  Defining NO_DEBUG_ALLOC (or configuring with
+ * LITESTL_DEBUG_ALLOC=OFF) drops the leak tracking layer and calls the
+ * allocator directly.
+ *
+ * Tracked blocks carry a 64 byte header.  Defining COMPACT_DEBUG_ALLOC
+ * (LITESTL_COMPACT_DEBUG_ALLOC=ON) shrinks it to 16 bytes holding the size,
+ * the interned tag id and a double free canary; blocks are then not linked,
+ * and print_blocks scans the allocator's spans for live blocks of all
+ * threads instead of listing the calling thread's.
+ *
+ * Inside an alloc::ArenaScope (see arena.h) alloc::alloc draws from an arena
+ * instead, and alloc::release of arena memory does nothing.
+ *
+ * In both modes allocations are counted per tag, see alloc_stats.h.
  */
 namespace litestl::alloc {
 
+/**
+ * Allocates @p size bytes aligned to @p align, a power of two.  Blocks are
+ * released with alloc::release like any other.
+ */
+void *alloc_aligned(const char *tag, size_t size, size_t align);
+
+/**
+ * Tuning of large blocks, which bypass the size-class caches and are mapped
+ * directly from the OS.  They are unmapped as soon as they're released.
+ */
+struct LargeBlockConfig {
+  /** Blocks above this many bytes are mapped directly.  At most 256kb. */
+  size_t threshold = 256 * 1024;
+  /**
+   * Blocks of at least this many bytes are aligned for and advised to use
+   * transparent huge pages (Linux), fewer TLB misses for big tables.  0
+   * disables.
+   */
+  size_t huge_page_threshold = size_t(2) << 20;
+  /** Fault new blocks in up front (MAP_POPULATE) instead of on first touch. */
+  bool populate = false;
+};
+
+/** Sets the large block configuration, for allocations made after the call. */
+void set_large_block_config(const LargeBlockConfig &config);
+/** Returns the current large block configuration. */
+LargeBlockConfig get_large_block_config();
+
+/**
+ * Resizes the block at @p ptr, allocated or last resized with @p old_size
+ * bytes, to @p size bytes and returns it, keeping the first
+ * min(old_size, size) bytes.  Blocks are resized in place when their size
+ * class allows and large blocks are remapped rather than copied (on Linux),
+ * otherwise contents are copied bytewise, so only use it for trivially
+ * relocatable data.  A null @p ptr allocates.  Returns nullptr on failure,
+ * leaving @p ptr valid.  Not for blocks from alloc_aligned.
+ */
+void *realloc(const char *tag, void *ptr, size_t old_size, size_t size);
+
 #ifndef NO_DEBUG_ALLOC
 /** Allocates a block of memory with a named tag. Tag is usually a string literal. */
 void *alloc(const char *tag, size_t size);
 /** Release a block of memory allocated with alloc::alloc. */
 void release(void *mem);
-/** Prints all the blocks allocated by this thread. */
+/**
+ * Prints the blocks allocated by this thread (by all threads with
+ * COMPACT_DEBUG_ALLOC).
+ */
 bool print_blocks(bool printPermanent);
 /** Print a block */
 void print_block(const void *mem);
 /** Returns the total memory allocated by all threads. */
-int getMemorySize();
+int64_t getMemorySize();
 /** Returns the total permanent memory allocated by all threads. */
-int getPermanentMemorySize();
+int64_t getPermanentMemorySize();
 /** Begins a permanent allocation scope. Allocations made while active are excluded from leak reports. */
 void pushPermanentAlloc();
 /** Ends a permanent allocation scope. */
@@ -37,6 +96,8 @@ void popPermanentAlloc();
 namespace detail {
 /** Retrieves the debug tag string associated with an allocation. */
 const char *getMemoryTag(void *vmem);
+/** Number of per-thread block lists; exited threads' lists are reused. */
+int mem_list_count();
 }
 /** Retrieves the debug tag string associated with an allocation. */
 template<typename T> static const char *getMemoryTag(T *mem) {
@@ -44,36 +105,48 @@ template<typename T> static const char *getMemoryTag(T *mem) {
 }
 
 #else
+/** Allocates a block of memory. The tag is ignored without the debug layer. */
+void *alloc(const char *tag, size_t size);
+/** Release a block of memory allocated with alloc::alloc. */
+void release(void *mem);
+
 static void pushPermanentAlloc() {}
 static void popPermanentAlloc() {}
-static int getMemorySize() {
+static int64_t getMemorySize() {
   return -1;
 }
-static int getPermanentMemorySize() {
+static int64_t getPermanentMemorySize() {
   return -1;
 }
-static void *alloc(const char *tag, size_t size)
-{
-  return malloc(size);
-}
-static void release(void *mem) {
-  free(mem);
-}
 template<typename T> static const char *getMemoryTag(T *mem) {
   return nullptr;
 }
 
-static bool print_blocks() {
+static bool print_blocks(bool printPermanent) {
+  return false;
 }
 
 static void print_block(const void *mem) {
 }
 #endif
 
+/** Default alignment of alloc::alloc. */
+static constexpr size_t default_align = 16;
+
+/** Allocates @p size bytes suitably aligned for @p T. */
+template <typename T> inline void *alloc_for(const char *tag, size_t size)
+{
+  if constexpr (alignof(T) > default_align) {
+    return alloc_aligned(tag, size, alignof(T));
+  } else {
+    return alloc(tag, size);
+  }
+}
+
 /** Allocates and constructs a single object using placement new. */
 template <typename T, typename... Args> inline T *New(const char *tag, Args... args)
 {
-  void *mem = alloc(tag, sizeof(T));
+  void *mem = alloc_for<T>(tag, sizeof(T));
 
   return new (mem) T(std::forward<Args>(args)...);
 }
@@ -86,11 +159,11 @@ inline T *NewArray(const char *tag, size_t size, Args... args)
     return nullptr;
   }
 
-  void *mem = alloc(tag, sizeof(T) * size);
+  void *mem = alloc_for<T>(tag, sizeof(T) * size);
   T *elem = static_cast<T *>(mem);
 
   for (int i = 0; i < size; i++) {
-    new (elem) T(std::forward<Args>(args)...);
+    new (elem + i) T(std::forward<Args>(args)...);
   }
 
   return static_cast<T *>(elem);
@@ -0,0 +1,756 @@
+#include "alloc_engine.h"
+#include "alloc.h"
+#include "platform/memory.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <new>
+#include <thread>
+
+namespace litestl::alloc::engine {
+namespace {
+
+/* Spans are mapped at 64kb alignment, which is also the page map granularity. */
+constexpr int span_shift = 16;
+constexpr size_t span_align = size_t(1) << span_shift;
+constexpr size_t span_header_size = 64;
+constexpr uint32_t span_magic = 0x6e617073;
+
+/*
+ * Size classes: 16 byte steps up to 128 bytes, then four classes per power of
+ * two (160, 192, 224, 256, 320, ...) up to max_small_size.
+ */
+constexpr int class_count = 52;
+
+constexpr size_t class_to_size(int c)
+{
+  if (c < 8) {
+    return size_t(c + 1) << 4;
+  }
+
+  const int k = c - 8;
+  const int lg = 7 + k / 4;
+  return size_t(5 + k % 4) << (lg - 2);
+}
+static_assert(class_to_size(class_count - 1) == max_small_size);
+
+inline int size_to_class(size_t size)
+{
+  if (size <= 128) {
+    return size ? int((size + 15) >> 4) - 1 : 0;
+  }
+
+  const size_t s = size - 1;
+  const int lg = int(std::bit_width(s)) - 1;
+  return 8 + (lg - 7) * 4 + int((s >> (lg - 2)) & 3);
+}
+
+/** Bytes mapped per span; large classes get enough room for a few objects. */
+constexpr size_t class_span_size(int c)
+{
+  const size_t size = class_to_size(c);
+  const size_t objects = size <= 4096 ? 16 : 4;
+  const size_t bytes = span_header_size + (size + sizeof(uint16_t)) * objects;
+  return std::max(span_align, (bytes + span_align - 1) & ~(span_align - 1));
+}
+
+constexpr int slot_recip_shift = 40;
+
+/**
+ * Layout of a small span: header, one 16-bit tag per object, then the objects.
+ * Slots are found by multiplying with a fixed point reciprocal of the block
+ * size, which is exact while offset * block_size < 2^40.
+ */
+struct ClassLayout {
+  uint32_t objects;
+  /* Offset of the first object from the span start. */
+  uint32_t first;
+  uint64_t slot_recip;
+  /* Span is a single page, so a block's span is found by masking. */
+  bool single_page;
+};
+
+constexpr auto class_layouts = []() {
+  std::array<ClassLayout, class_count> layouts = {};
+
+  for (int c = 0; c < class_count; c++) {
+    const size_t size = class_to_size(c);
+    const size_t objects = (class_span_size(c) - span_header_size - 16) /
+                           (size + sizeof(uint16_t));
+
+    layouts[c].objects = uint32_t(objects);
+    layouts[c].first =
+        uint32_t(span_header_size + ((objects * sizeof(uint16_t) + 15) & ~size_t(15)));
+    layouts[c].slot_recip = ((uint64_t(1) << slot_recip_shift) / size) + 1;
+    layouts[c].single_page = class_span_size(c) == span_align;
+  }
+
+  return layouts;
+}();
+
+static_assert([]() {
+  for (int c = 0; c < class_count; c++) {
+    const size_t size = class_to_size(c);
+    if (class_layouts[c].first + class_layouts[c].objects * size > class_span_size(c) ||
+        class_span_size(c) * size >= (uint64_t(1) << slot_recip_shift))
+    {
+      return false;
+    }
+  }
+  return true;
+}());
+
+/** Number of objects moved between a thread cache and the central list at once. */
+constexpr uint32_t class_batch(int c)
+{
+  return uint32_t(std::clamp<size_t>((64 * 1024) / class_to_size(c), 1, 64));
+}
+
+/**
+ * Minimal spin lock.  Unlike std::mutex it is constant-initialized and
+ * trivially destructible, so it stays usable from thread and static
+ * destructors that release memory late.
+ */
+struct SpinLock {
+  std::atomic_flag flag;
+
+  void lock()
+  {
+    while (flag.test_and_set(std::memory_order_acquire)) {
+      while (flag.test(std::memory_order_relaxed)) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  void unlock()
+  {
+    flag.clear(std::memory_order_release);
+  }
+};
+
+enum class SpanKind : uint8_t { Small, Large, Arena };
+
+/** Header at the start of every span and large block. */
+struct Span {
+  uint32_t magic;
+  SpanKind kind;
+  uint8_t size_class;
+  /* Tag of a large block. */
+  uint16_t tag;
+  /* Large block advised to use huge pages. */
+  bool huge;
+  size_t map_size;
+  size_t block_size;
+  char *first;
+  /* Small spans: one tag per object, see ClassLayout. */
+  uint16_t *tags;
+};
+static_assert(sizeof(Span) <= span_header_size);
+
+/* Page map: two-level radix tree from (address >> span_shift) to owning span. */
+#if UINTPTR_MAX > 0xffffffffu
+constexpr int address_bits = 48;
+#else
+constexpr int address_bits = 32;
+#endif
+constexpr int page_bits = address_bits - span_shift;
+constexpr int leaf_bits = page_bits / 2;
+constexpr int root_bits = page_bits - leaf_bits;
+constexpr uintptr_t leaf_mask = (uintptr_t(1) << leaf_bits) - 1;
+
+struct PageMapLeaf {
+  std::atomic<Span *> spans[size_t(1) << leaf_bits];
+};
+
+std::atomic<PageMapLeaf *> pagemap[size_t(1) << root_bits];
+SpinLock pagemap_lock;
+
+/** Index of the object at @p ptr within small span @p span. */
+inline size_t slot_index(const Span *span, const void *ptr)
+{
+  const uint64_t offset = uint64_t(static_cast<const char *>(ptr) - span->first);
+  return size_t((offset * class_layouts[span->size_class].slot_recip) >>
+                slot_recip_shift);
+}
+
+struct FreeObject {
+  FreeObject *next;
+};
+
+struct CentralList {
+  SpinLock lock;
+  FreeObject *head;
+  /* Uncarved remainder of the newest span. */
+  char *bump;
+  char *bump_end;
+};
+
+CentralList central[class_count];
+
+std::atomic<size_t> mapped_bytes;
+std::atomic<size_t> span_count;
+std::atomic<size_t> large_count;
+std::atomic<size_t> large_bytes;
+std::atomic<size_t> huge_count;
+std::atomic<size_t> huge_bytes;
+
+/* LargeBlockConfig, read on every large allocation. */
+std::atomic<size_t> large_threshold = max_small_size;
+std::atomic<size_t> huge_page_threshold = size_t(2) << 20;
+std::atomic<bool> large_populate = false;
+
+inline Span *lookup_span(const void *ptr)
+{
+  const uintptr_t page = uintptr_t(ptr) >> span_shift;
+  if (page >> page_bits) {
+    return nullptr;
+  }
+
+  PageMapLeaf *leaf = pagemap[page >> leaf_bits].load(std::memory_order_acquire);
+  if (!leaf) {
+    return nullptr;
+  }
+
+  return leaf->spans[page & leaf_mask].load(std::memory_order_acquire);
+}
+
+bool pagemap_set(Span *span, Span *value)
+{
+  const uintptr_t first = uintptr_t(span) >> span_shift;
+  const uintptr_t last = (uintptr_t(span) + span->map_size - 1) >> span_shift;
+
+  if (last >> page_bits) {
+    return false;
+  }
+
+  for (uintptr_t page = first; page <= last; page++) {
+    std::atomic<PageMapLeaf *> &root = pagemap[page >> leaf_bits];
+    PageMapLeaf *leaf = root.load(std::memory_order_acquire);
+
+    if (!leaf) {
+      std::lock_guard guard(pagemap_lock);
+
+      leaf = root.load(std::memory_order_relaxed);
+      if (!leaf) {
+        /* Fresh mappings are zeroed, i.e. all entries are null. */
+        leaf = static_cast<PageMapLeaf *>(
+            platform::map_pages(sizeof(PageMapLeaf), platform::page_size()));
+        if (!leaf) {
+          return false;
+        }
+        root.store(leaf, std::memory_order_release);
+      }
+    }
+
+    leaf->spans[page & leaf_mask].store(value, std::memory_order_release);
+  }
+
+  return true;
+}
+
+Span *map_span(size_t map_size,
+               SpanKind kind,
+               int size_class,
+               size_t block_size,
+               size_t align = span_align,
+               unsigned hints = platform::map_default)
+{
+  void *mem = platform::map_pages(map_size, align, hints);
+  if (!mem) {
+    return nullptr;
+  }
+
+  Span *span = new (mem) Span();
+  span->magic = span_magic;
+  span->kind = kind;
+  span->size_class = uint8_t(size_class);
+  span->map_size = map_size;
+  span->block_size = block_size;
+  span->first = static_cast<char *>(mem) + span_header_size;
+
+  if (!pagemap_set(span, span)) {
+    platform::unmap_pages(mem, map_size);
+    return nullptr;
+  }
+
+  mapped_bytes.fetch_add(map_size, std::memory_order_relaxed);
+  return span;
+}
+
+void unmap_span(Span *span)
+{
+  const size_t map_size = span->map_size;
+
+  pagemap_set(span, nullptr);
+  span->magic = 0;
+
+  mapped_bytes.fetch_sub(map_size, std::memory_order_relaxed);
+  platform::unmap_pages(static_cast<void *>(span), map_size);
+}
+
+/**
+ * Moves up to @p count objects of class @p c into a linked list at @p r_head,
+ * carving a new span if the central list runs dry.  Returns the number of
+ * objects fetched.
+ */
+uint32_t central_fetch(int c, uint32_t count, FreeObject **r_head)
+{
+  CentralList &list = central[c];
+  const size_t size = class_to_size(c);
+  FreeObject *head = nullptr;
+  uint32_t n = 0;
+
+  std::lock_guard guard(list.lock);
+
+  while (n < count && list.head) {
+    FreeObject *obj = list.head;
+    list.head = obj->next;
+    obj->next = head;
+    head = obj;
+    n++;
+  }
+
+  while (n < count) {
+    if (!list.bump || size_t(list.bump_end - list.bump) < size) {
+      Span *span = map_span(class_span_size(c), SpanKind::Small, c, size);
+      if (!span) {
+        break;
+      }
+
+      const ClassLayout &layout = class_layouts[c];
+
+      span->tags = reinterpret_cast<uint16_t *>(span->first);
+      span->first = reinterpret_cast<char *>(span) + layout.first;
+
+      span_count.fetch_add(1, std::memory_order_relaxed);
+      list.bump = span->first;
+      list.bump_end = span->first + layout.objects * size;
+    }
+
+    FreeObject *obj = reinterpret_cast<FreeObject *>(list.bump);
+    list.bump += size;
+    obj->next = head;
+    head = obj;
+    n++;
+  }
+
+  *r_head = head;
+  return n;
+}
+
+void central_return(int c, FreeObject *head, FreeObject *tail)
+{
+  CentralList &list = central[c];
+
+  std::lock_guard guard(list.lock);
+  tail->next = list.head;
+  list.head = head;
+}
+
+struct ClassCache {
+  FreeObject *head;
+  uint32_t count;
+};
+
+/** Per-thread free lists.  Flushed back to the central lists on thread exit. */
+struct ThreadCache {
+  ClassCache classes[class_count];
+
+  void flush(int c, uint32_t count)
+  {
+    ClassCache &cache = classes[c];
+    FreeObject *head = cache.head, *tail = head;
+
+    for (uint32_t i = 1; i < count; i++) {
+      tail = tail->next;
+    }
+
+    cache.head = tail->next;
+    cache.count -= count;
+    central_return(c, head, tail);
+  }
+
+  ~ThreadCache();
+};
+
+/* Set once the thread cache is destroyed, later calls go straight to the central
+ * lists. */
+thread_local bool thread_cache_dead = false;
+thread_local ThreadCache thread_cache;
+
+ThreadCache::~ThreadCache()
+{
+  thread_cache_dead = true;
+
+  for (int c = 0; c < class_count; c++) {
+    if (classes[c].count) {
+      flush(c, classes[c].count);
+    }
+  }
+}
+
+/** Tag slot of small object @p ptr of class @p c. */
+inline uint16_t *small_tag(const void *ptr, int c)
+{
+  const ClassLayout &layout = class_layouts[c];
+
+  if (!layout.single_page) {
+    Span *span = lookup_span(ptr);
+    return span->tags + slot_index(span, ptr);
+  }
+
+  /* Avoid touching the span header. */
+  const uintptr_t base = uintptr_t(ptr) & ~(span_align - 1);
+  const uint64_t offset = uintptr_t(ptr) - base - layout.first;
+  uint16_t *tags = reinterpret_cast<uint16_t *>(base + span_header_size);
+
+  return tags + ((offset * layout.slot_recip) >> slot_recip_shift);
+}
+
+BlockInfo span_block_info(const Span *span, const void *ptr)
+{
+  if (span->kind == SpanKind::Large) {
+    return {span->map_size - span_header_size, span->tag};
+  }
+  if (span->kind == SpanKind::Arena) {
+    return {0, 0};
+  }
+
+  return {span->block_size, span->tags[slot_index(span, ptr)]};
+}
+
+/** Whether a large block of @p size bytes should use huge pages. */
+bool use_huge_pages(size_t size)
+{
+  const size_t threshold = huge_page_threshold.load(std::memory_order_relaxed);
+  return threshold && size >= threshold && platform::huge_page_size();
+}
+
+void *alloc_large(size_t size, uint16_t tag, size_t *r_size)
+{
+  if (size > SIZE_MAX / 2) {
+    return nullptr;
+  }
+
+  const bool huge = use_huge_pages(size);
+  unsigned hints = huge ? platform::map_huge_pages : platform::map_default;
+  if (large_populate.load(std::memory_order_relaxed)) {
+    hints |= platform::map_populate;
+  }
+
+  /* Huge pages need huge page aligned ranges; the tail past the last full huge page
+   * falls back to normal pages. */
+  const size_t align =
+      huge ? std::max(span_align, platform::huge_page_size()) : span_align;
+  const size_t map_size = (span_header_size + size + span_align - 1) & ~(span_align - 1);
+  Span *span = map_span(map_size, SpanKind::Large, 0, size, align, hints);
+  if (!span) {
+    return nullptr;
+  }
+
+  span->tag = tag;
+  span->huge = huge;
+  if (r_size) {
+    *r_size = map_size - span_header_size;
+  }
+
+  large_count.fetch_add(1, std::memory_order_relaxed);
+  large_bytes.fetch_add(map_size, std::memory_order_relaxed);
+  if (huge) {
+    huge_count.fetch_add(1, std::memory_order_relaxed);
+    huge_bytes.fetch_add(map_size, std::memory_order_relaxed);
+  }
+  return span->first;
+}
+
+/* Large blocks are unmapped at once, so their memory goes straight back to the OS. */
+void release_large(Span *span)
+{
+  large_count.fetch_sub(1, std::memory_order_relaxed);
+  large_bytes.fetch_sub(span->map_size, std::memory_order_relaxed);
+  if (span->huge) {
+    huge_count.fetch_sub(1, std::memory_order_relaxed);
+    huge_bytes.fetch_sub(span->map_size, std::memory_order_relaxed);
+  }
+  unmap_span(span);
+}
+
+void *resize_large(Span *span, size_t size, size_t *r_size)
+{
+  const size_t old_map_size = span->map_size;
+  const size_t map_size = (span_header_size + size + span_align - 1) & ~(span_align - 1);
+
+  if (map_size != old_map_size) {
+    /* The caller owns the block, so nobody else looks the span up meanwhile.  Clear the
+     * old pages first, a moved-out range may be reused by another thread at once. */
+    pagemap_set(span, nullptr);
+
+    const bool huge = span->huge;
+    void *mem = platform::remap_pages(
+        static_cast<void *>(span),
+        old_map_size,
+        map_size,
+        huge ? std::max(span_align, platform::huge_page_size()) : span_align,
+        huge ? platform::map_huge_pages : platform::map_default);
+    if (!mem) {
+      pagemap_set(span, span);
+      return nullptr;
+    }
+
+    span = static_cast<Span *>(mem);
+    span->map_size = map_size;
+    span->first = static_cast<char *>(mem) + span_header_size;
+
+    /* Only fails when out of memory for page map leaves.  The block has moved already,
+     * so hand it out anyway; releasing it will then report an unknown pointer. */
+    if (!pagemap_set(span, span)) {
+      fprintf(stderr, "litestl::alloc::engine: page map full, leaking %p\n", mem);
+    }
+
+    const size_t delta = map_size - old_map_size;
+    mapped_bytes.fetch_add(delta, std::memory_order_relaxed);
+    large_bytes.fetch_add(delta, std::memory_order_relaxed);
+    if (huge) {
+      huge_bytes.fetch_add(delta, std::memory_order_relaxed);
+    }
+  }
+
+  span->block_size = size;
+  if (r_size) {
+    *r_size = map_size - span_header_size;
+  }
+
+  return span->first;
+}
+} // namespace
+
+void *alloc(size_t size, uint16_t tag, size_t *r_size)
+{
+  if (size > large_threshold.load(std::memory_order_relaxed)) {
+    return alloc_large(size, tag, r_size);
+  }
+
+  const int c = size_to_class(size);
+  FreeObject *obj;
+
+  if (thread_cache_dead) {
+    if (!central_fetch(c, 1, &obj)) {
+      return nullptr;
+    }
+  } else {
+    ClassCache &cache = thread_cache.classes[c];
+
+    if (!cache.head) {
+      cache.count = central_fetch(c, class_batch(c), &cache.head);
+      if (!cache.count) {
+        return nullptr;
+      }
+    }
+
+    obj = cache.head;
+    cache.head = obj->next;
+    cache.count--;
+  }
+
+  *small_tag(obj, c) = tag;
+
+  if (r_size) {
+    *r_size = class_to_size(c);
+  }
+
+  return static_cast<void *>(obj);
+}
+
+void release(void *ptr, BlockInfo *r_info)
+{
+  Span *span = lookup_span(ptr);
+
+  if (!span || span->magic != span_magic) {
+    fprintf(stderr, "litestl::alloc::engine: release of unknown pointer %p\n", ptr);
+    return;
+  }
+
+  if (r_info) {
+    *r_info = span_block_info(span, ptr);
+  }
+
+  if (span->kind == SpanKind::Large) {
+    release_large(span);
+    return;
+  }
+  if (span->kind == SpanKind::Arena) {
+    /* Arena memory is freed in bulk. */
+    return;
+  }
+
+  const int c = span->size_class;
+  /* Aligned allocations hand out pointers inside their block. */
+  FreeObject *obj = reinterpret_cast<FreeObject *>(
+      span->first + slot_index(span, ptr) * span->block_size);
+
+  if (thread_cache_dead) {
+    central_return(c, obj, obj);
+    return;
+  }
+
+  ClassCache &cache = thread_cache.classes[c];
+  obj->next = cache.head;
+  cache.head = obj;
+  cache.count++;
+
+  const uint32_t batch = class_batch(c);
+  if (cache.count > batch * 2) {
+    thread_cache.flush(c, batch);
+  }
+}
+
+void *resize(void *ptr, size_t size, size_t *r_size)
+{
+  Span *span = lookup_span(ptr);
+
+  if (!span || span->magic != span_magic || span->kind == SpanKind::Arena) {
+    return nullptr;
+  }
+
+  if (span->kind == SpanKind::Large) {
+    /* Shrinking to a small size is better served by a size class. */
+    return size > large_threshold.load(std::memory_order_relaxed) ?
+               resize_large(span, size, r_size) :
+               nullptr;
+  }
+
+  /* Keep small blocks unless they'd be less than half used. */
+  if (size > span->block_size || size < span->block_size / 2) {
+    return nullptr;
+  }
+
+  if (r_size) {
+    *r_size = span->block_size;
+  }
+  return ptr;
+}
+
+size_t usable_size(const void *ptr)
+{
+  Span *span = lookup_span(ptr);
+
+  if (!span) {
+    return 0;
+  }
+
+  return span->kind == SpanKind::Small ? span->block_size
+                                       : span->map_size - span_header_size;
+}
+
+BlockInfo block_info(const void *ptr)
+{
+  Span *span = lookup_span(ptr);
+  return span ? span_block_info(span, ptr) : BlockInfo{0, 0};
+}
+
+bool owns(const void *ptr)
+{
+  return lookup_span(ptr) != nullptr;
+}
+
+void for_each_block(void (*cb)(void *block, size_t size, void *userdata), void *userdata)
+{
+  for (size_t root = 0; root < (size_t(1) << root_bits); root++) {
+    PageMapLeaf *leaf = pagemap[root].load(std::memory_order_acquire);
+    if (!leaf) {
+      continue;
+    }
+
+    for (size_t i = 0; i <= leaf_mask; i++) {
+      Span *span = leaf->spans[i].load(std::memory_order_acquire);
+
+      /* Spans cover several pages, visit each from its first. */
+      if (!span || (uintptr_t(span) >> span_shift) != ((root << leaf_bits) | i)) {
+        continue;
+      }
+
+      if (span->kind == SpanKind::Small) {
+        const uint32_t objects = class_layouts[span->size_class].objects;
+        for (uint32_t j = 0; j < objects; j++) {
+          cb(span->first + size_t(j) * span->block_size, span->block_size, userdata);
+        }
+      } else if (span->kind == SpanKind::Large) {
+        cb(span->first, span->map_size - span_header_size, userdata);
+      }
+    }
+  }
+}
+
+void *alloc_arena_chunk(size_t size, size_t *r_size)
+{
+  if (size > SIZE_MAX / 2) {
+    return nullptr;
+  }
+
+  const size_t map_size = (span_header_size + size + span_align - 1) & ~(span_align - 1);
+  Span *span = map_span(map_size, SpanKind::Arena, 0, size);
+  if (!span) {
+    return nullptr;
+  }
+
+  *r_size = map_size - span_header_size;
+  return span->first;
+}
+
+void release_arena_chunk(void *chunk)
+{
+  Span *span = lookup_span(chunk);
+
+  if (!span || span->kind != SpanKind::Arena) {
+    fprintf(stderr, "litestl::alloc::engine: invalid arena chunk %p\n", chunk);
+    return;
+  }
+
+  unmap_span(span);
+}
+
+bool is_arena(const void *ptr)
+{
+  Span *span = lookup_span(ptr);
+  return span && span->kind == SpanKind::Arena;
+}
+
+void set_large_config(const LargeBlockConfig &config)
+{
+  large_threshold.store(std::min(config.threshold, max_small_size),
+                        std::memory_order_relaxed);
+  huge_page_threshold.store(config.huge_page_threshold, std::memory_order_relaxed);
+  large_populate.store(config.populate, std::memory_order_relaxed);
+}
+
+LargeBlockConfig get_large_config()
+{
+  LargeBlockConfig config;
+
+  config.threshold = large_threshold.load(std::memory_order_relaxed);
+  config.huge_page_threshold = huge_page_threshold.load(std::memory_order_relaxed);
+  config.populate = large_populate.load(std::memory_order_relaxed);
+
+  return config;
+}
+
+Stats get_stats()
+{
+  Stats stats;
+
+  stats.mapped_bytes = mapped_bytes.load(std::memory_order_relaxed);
+  stats.span_count = span_count.load(std::memory_order_relaxed);
+  stats.large_count = large_count.load(std::memory_order_relaxed);
+  stats.large_bytes = large_bytes.load(std::memory_order_relaxed);
+  stats.huge_count = huge_count.load(std::memory_order_relaxed);
+  stats.huge_bytes = huge_bytes.load(std::memory_order_relaxed);
+
+  return stats;
+}
+} // namespace litestl::alloc::engine
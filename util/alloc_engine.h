@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Size-class pool allocator that backs alloc::alloc.
+ *
+ * Small blocks (up to engine::max_small_size) are served from per-thread
+ * free lists, one per size class.  Threads refill and flush their caches in
+ * batches from a central free list per size class, which in turn carves
+ * objects out of 64kb-aligned spans mapped from the OS.  Larger blocks are
+ * mapped (and unmapped) directly, and grown with mremap where available.
+ *
+ * Every span is registered in a page map, so the owning span (and thus the
+ * size class) of any block can be found without a per-block header.  Spans
+ * also keep a 16-bit tag per block, used by alloc.cc for per-tag statistics.
+ *
+ * This is an internal interface, use alloc::alloc and alloc::release.
+ */
+namespace litestl::alloc {
+struct LargeBlockConfig;
+}
+
+namespace litestl::alloc::engine {
+/** Largest block size served from the size-class caches (see LargeBlockConfig). */
+static constexpr size_t max_small_size = 256 * 1024;
+/** Alignment of every block returned by engine::alloc. */
+static constexpr size_t min_align = 16;
+
+struct BlockInfo {
+  /** Usable size of the block. */
+  size_t size;
+  /** Tag passed to engine::alloc. */
+  uint16_t tag;
+};
+
+/**
+ * Allocates @p size bytes, min_align aligned, recording @p tag for the block.
+ * If @p r_size is set it receives the usable size.  Returns nullptr on failure.
+ */
+void *alloc(size_t size, uint16_t tag = 0, size_t *r_size = nullptr);
+/**
+ * Releases a block returned by engine::alloc.  @p ptr may point anywhere
+ * inside the block.  May be called from any thread.  If @p r_info is set it
+ * receives the block's size and tag.
+ */
+void release(void *ptr, BlockInfo *r_info = nullptr);
+/**
+ * Resizes the block at @p ptr to @p size bytes without copying it through
+ * memory.  Small blocks stay put if @p size still suits their size class,
+ * large blocks are remapped (see platform::remap_pages).  Returns the
+ * possibly moved block, or nullptr if it can't be resized this way, in which
+ * case @p ptr is unchanged.  The block keeps its tag; @p r_size receives the
+ * new usable size.  Not for aligned interior pointers.
+ */
+void *resize(void *ptr, size_t size, size_t *r_size = nullptr);
+/** Returns the usable size of a block returned by engine::alloc. */
+size_t usable_size(const void *ptr);
+/** Returns size and tag of the block containing @p ptr. */
+BlockInfo block_info(const void *ptr);
+/** Returns true if @p ptr lies inside memory owned by the engine. */
+bool owns(const void *ptr);
+/**
+ * Calls @p cb with every object slot of the small spans and every large
+ * block, allocated or not: free slots hold stale data, slots never handed out
+ * are zero.  Meant for leak reports; large blocks must not be released
+ * meanwhile.
+ */
+void for_each_block(void (*cb)(void *block, size_t size, void *userdata), void *userdata);
+
+/**
+ * Maps a chunk for alloc::Arena with at least @p size usable bytes, writing
+ * the actual usable size to @p r_size.  release() on any pointer inside an
+ * arena chunk is a no-op; the chunk is freed with release_arena_chunk.
+ */
+void *alloc_arena_chunk(size_t size, size_t *r_size);
+/** Frees a chunk returned by alloc_arena_chunk. */
+void release_arena_chunk(void *chunk);
+/** Returns true if @p ptr lies inside an arena chunk. */
+bool is_arena(const void *ptr);
+
+struct Stats {
+  /** Bytes currently mapped from the OS (spans plus large blocks). */
+  size_t mapped_bytes;
+  /** Number of live small-object spans. */
+  size_t span_count;
+  /** Number of live large blocks, and their mapped size. */
+  size_t large_count;
+  size_t large_bytes;
+  /** Large blocks backed by transparent huge pages, and their mapped size. */
+  size_t huge_count;
+  size_t huge_bytes;
+};
+
+/** Backs alloc::set_large_block_config. */
+void set_large_config(const LargeBlockConfig &config);
+LargeBlockConfig get_large_config();
+
+/** Returns a snapshot of the engine's OS-level usage. */
+Stats get_stats();
+} // namespace litestl::alloc::engine
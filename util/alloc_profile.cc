@@ -0,0 +1,400 @@
+#include "alloc_profile.h"
+#include "platform/memory.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+#if defined(__linux__) && !defined(WASM)
+#include <cxxabi.h>
+#include <execinfo.h>
+#define HAVE_BACKTRACE
+#endif
+
+namespace litestl::alloc {
+namespace detail {
+std::atomic<bool> heap_profile_active = {false};
+std::atomic<bool> heap_profile_used = {false};
+} // namespace detail
+
+namespace {
+constexpr int max_depth = 32;
+/* Table sizes are fixed; samples past them are dropped. */
+constexpr uint32_t site_capacity = 4096;
+constexpr uint32_t sample_capacity = 1 << 16;
+constexpr uint32_t no_site = ~0u;
+
+/** Aggregated samples of one call stack. */
+struct Site {
+  /* 0 marks a free entry. */
+  uint64_t hash;
+  int depth;
+  void *frames[max_depth];
+  int64_t live_bytes;
+  int64_t total_bytes;
+};
+
+/** A sampled block that is still allocated. */
+struct Sample {
+  /* nullptr marks a free entry. */
+  const void *block;
+  uint32_t site;
+  int64_t weight;
+};
+
+std::mutex profile_mutex;
+Site *sites = nullptr;
+Sample *samples = nullptr;
+uint32_t site_count = 0;
+uint32_t sample_count = 0;
+std::atomic<size_t> sample_interval = {512 * 1024};
+
+thread_local int64_t bytes_until_sample = 0;
+thread_local uint64_t rng_state = 0;
+
+/** Draws the distance to the next sample, exponentially distributed. */
+int64_t next_interval()
+{
+  if (!rng_state) {
+    rng_state = (uint64_t(uintptr_t(&rng_state)) * 0x9e3779b97f4a7c15ull) | 1;
+  }
+
+  /* xorshift64* */
+  rng_state ^= rng_state >> 12;
+  rng_state ^= rng_state << 25;
+  rng_state ^= rng_state >> 27;
+  const uint64_t bits = (rng_state * 0x2545f4914f6cdd1dull) >> 11;
+  const double u = (double(bits) + 1.0) / double(uint64_t(1) << 53);
+
+  const double interval = double(sample_interval.load(std::memory_order_relaxed));
+  return int64_t(-std::log(u) * interval) + 1;
+}
+
+/**
+ * Bytes a sample of @p size stands for.  Blocks much smaller than the
+ * interval are sampled with probability about size / interval.
+ */
+int64_t sample_weight(size_t size)
+{
+  const double interval = double(sample_interval.load(std::memory_order_relaxed));
+  const double p = 1.0 - std::exp(-double(size) / interval);
+
+  return p > 0.0 ? int64_t(double(size) / p) : int64_t(size);
+}
+
+uint32_t sample_slot(const void *block)
+{
+  return uint32_t((uint64_t(uintptr_t(block)) * 0x9e3779b97f4a7c15ull) >> 48) &
+         (sample_capacity - 1);
+}
+
+Sample *find_sample(const void *block)
+{
+  for (uint32_t i = sample_slot(block);; i = (i + 1) & (sample_capacity - 1)) {
+    if (samples[i].block == block) {
+      return &samples[i];
+    }
+    if (!samples[i].block) {
+      return nullptr;
+    }
+  }
+}
+
+void insert_sample(const void *block, uint32_t site, int64_t weight)
+{
+  /* Keep probe chains short. */
+  if (sample_count >= sample_capacity / 4 * 3) {
+    return;
+  }
+
+  uint32_t i = sample_slot(block);
+  while (samples[i].block) {
+    i = (i + 1) & (sample_capacity - 1);
+  }
+
+  samples[i] = {block, site, weight};
+  sites[site].live_bytes += weight;
+  sample_count++;
+}
+
+/** Removes @p sample, shifting later entries of its probe chain back. */
+void erase_sample(Sample *sample)
+{
+  sites[sample->site].live_bytes -= sample->weight;
+  sample_count--;
+
+  uint32_t hole = uint32_t(sample - samples);
+  uint32_t i = hole;
+
+  for (;;) {
+    i = (i + 1) & (sample_capacity - 1);
+    if (!samples[i].block) {
+      break;
+    }
+
+    /* Entries whose home slot lies cyclically in (hole, i] stay. */
+    const uint32_t home = sample_slot(samples[i].block);
+    if (((i - home) & (sample_capacity - 1)) >= ((i - hole) & (sample_capacity - 1))) {
+      samples[hole] = samples[i];
+      hole = i;
+    }
+  }
+
+  samples[hole] = {nullptr, 0, 0};
+}
+
+uint32_t find_site(void *const *frames, int depth)
+{
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (int i = 0; i < depth; i++) {
+    hash = (hash ^ uint64_t(uintptr_t(frames[i]))) * 0x100000001b3ull;
+  }
+  hash |= 1;
+
+  for (uint32_t i = uint32_t(hash >> 20) & (site_capacity - 1);;
+       i = (i + 1) & (site_capacity - 1))
+  {
+    Site &site = sites[i];
+
+    if (!site.hash) {
+      if (site_count >= site_capacity / 4 * 3) {
+        return no_site;
+      }
+
+      site.hash = hash;
+      site.depth = depth;
+      memcpy(site.frames, frames, sizeof(void *) * size_t(depth));
+      site_count++;
+      return i;
+    }
+
+    if (site.hash == hash && site.depth == depth &&
+        memcmp(site.frames, frames, sizeof(void *) * size_t(depth)) == 0)
+    {
+      return i;
+    }
+  }
+}
+
+#ifdef HAVE_BACKTRACE
+/**
+ * Writes the function name of a backtrace_symbols entry to @p buf, or
+ * module+offset if it has none, in which case it returns false.  glibc
+ * formats entries as "module(function+0xoffset) [0xaddress]".
+ */
+bool frame_name(const char *symbol, char *buf, size_t bufsize)
+{
+  const char *open = strchr(symbol, '(');
+  const char *close = open ? strchr(open, ')') : nullptr;
+
+  if (!open || !close) {
+    snprintf(buf, bufsize, "%s", symbol);
+    return false;
+  }
+
+  const char *plus = static_cast<const char *>(memchr(open, '+', size_t(close - open)));
+  const char *name_end = plus ? plus : close;
+
+  if (name_end > open + 1) {
+    char mangled[512];
+    snprintf(mangled, sizeof(mangled), "%.*s", int(name_end - open - 1), open + 1);
+
+    int status;
+    char *demangled = abi::__cxa_demangle(mangled, nullptr, nullptr, &status);
+    snprintf(buf, bufsize, "%s", status == 0 ? demangled : mangled);
+    free(demangled);
+    return true;
+  }
+
+  /* No symbol: module basename and offset, for addr2line. */
+  const char *module = symbol;
+  for (const char *c = symbol; c < open; c++) {
+    if (*c == '/') {
+      module = c + 1;
+    }
+  }
+
+  snprintf(buf, bufsize, "%.*s%.*s", int(open - module), module, int(close - name_end),
+           name_end);
+  return false;
+}
+
+/** Frames inside the allocator itself are left out of profiles. */
+bool is_allocator_frame(const char *name)
+{
+  return strncmp(name, "litestl::alloc::", 16) == 0;
+}
+#endif
+} // namespace
+
+bool start_heap_profile(size_t sample_bytes)
+{
+#ifdef HAVE_BACKTRACE
+  std::lock_guard guard(profile_mutex);
+
+  /* Fresh zeroed tables, dropping the previous profile. */
+  if (sites) {
+    platform::unmap_pages(static_cast<void *>(sites), sizeof(Site) * site_capacity);
+    platform::unmap_pages(static_cast<void *>(samples), sizeof(Sample) * sample_capacity);
+  }
+
+  sites = static_cast<Site *>(platform::map_pages(sizeof(Site) * site_capacity, 64));
+  samples =
+      static_cast<Sample *>(platform::map_pages(sizeof(Sample) * sample_capacity, 64));
+  site_count = sample_count = 0;
+
+  if (!sites || !samples) {
+    return false;
+  }
+
+  /* Load backtrace's unwinder now, it allocates on first use. */
+  void *frame;
+  backtrace(&frame, 1);
+
+  sample_interval.store(sample_bytes ? sample_bytes : 1, std::memory_order_relaxed);
+  detail::heap_profile_used.store(true);
+  detail::heap_profile_active.store(true);
+  return true;
+#else
+  (void)sample_bytes;
+  return false;
+#endif
+}
+
+void stop_heap_profile()
+{
+  detail::heap_profile_active.store(false);
+}
+
+void write_heap_profile(FILE *file, bool include_released)
+{
+#ifdef HAVE_BACKTRACE
+  std::lock_guard guard(profile_mutex);
+
+  if (!sites) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < site_capacity; i++) {
+    const Site &site = sites[i];
+    const int64_t bytes = include_released ? site.total_bytes : site.live_bytes;
+
+    if (!site.hash || bytes <= 0) {
+      continue;
+    }
+
+    char **symbols = backtrace_symbols(site.frames, site.depth);
+    if (!symbols) {
+      continue;
+    }
+
+    char names[max_depth][1024];
+    int first = 0;
+
+    /* Drop the innermost allocator frames, along with unnamed (static) functions
+     * between them. */
+    bool inner = true;
+    for (int j = 0; j < site.depth; j++) {
+      const bool named = frame_name(symbols[j], names[j], sizeof(names[j]));
+
+      if (inner && j < site.depth - 1 && is_allocator_frame(names[j])) {
+        first = j + 1;
+      } else if (named) {
+        inner = false;
+      }
+    }
+
+    for (int j = site.depth - 1; j >= first; j--) {
+      fputs(names[j], file);
+      fputc(j > first ? ';' : ' ', file);
+    }
+    fprintf(file, "%lld\n", static_cast<long long>(bytes));
+
+    free(symbols);
+  }
+
+  fflush(file);
+#else
+  (void)file;
+  (void)include_released;
+#endif
+}
+
+namespace detail {
+bool profile_countdown(size_t size)
+{
+  bytes_until_sample -= int64_t(size);
+  if (bytes_until_sample > 0) {
+    return false;
+  }
+
+  bytes_until_sample = next_interval();
+  return true;
+}
+
+void profile_alloc(const void *block, size_t size)
+{
+#ifdef HAVE_BACKTRACE
+  void *frames[max_depth + 1];
+  /* Skip this function's own frame. */
+  const int depth = backtrace(frames, max_depth + 1) - 1;
+  const int64_t weight = sample_weight(size);
+
+  std::lock_guard guard(profile_mutex);
+
+  if (!sites || depth <= 0) {
+    return;
+  }
+
+  const uint32_t site = find_site(frames + 1, depth);
+  if (site == no_site) {
+    return;
+  }
+
+  sites[site].total_bytes += weight;
+  insert_sample(block, site, weight);
+#else
+  (void)block;
+  (void)size;
+#endif
+}
+
+void profile_release(const void *block)
+{
+  std::lock_guard guard(profile_mutex);
+
+  if (!samples) {
+    return;
+  }
+
+  if (Sample *sample = find_sample(block)) {
+    erase_sample(sample);
+  }
+}
+
+void profile_resize(const void *old_block, const void *block, size_t size)
+{
+  std::lock_guard guard(profile_mutex);
+
+  if (!samples) {
+    return;
+  }
+
+  Sample *sample = find_sample(old_block);
+  if (!sample) {
+    return;
+  }
+
+  const uint32_t site = sample->site;
+  const int64_t old_weight = sample->weight;
+  const int64_t weight = sample_weight(size);
+
+  erase_sample(sample);
+  if (weight > old_weight) {
+    sites[site].total_bytes += weight - old_weight;
+  }
+  insert_sample(block, site, weight);
+}
+} // namespace detail
+} // namespace litestl::alloc
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+/*
+ * Sampling heap profiler (Linux).
+ *
+ * While running, about one allocation per sample_bytes allocated is sampled:
+ * its call stack is captured and the block is followed until it's released.
+ * Samples are aggregated by call stack and weighted so that each stack's
+ * value estimates the bytes it actually allocated.
+ *
+ *   alloc::start_heap_profile();
+ *   ...
+ *   alloc::write_heap_profile(file);  // folded stacks, for flamegraph.pl
+ *
+ * Overhead outside samples is a flag test per allocation, and a tag bit test
+ * per release.  Link with -rdynamic to get function names; otherwise frames
+ * are written as module+offset, suitable for addr2line.
+ */
+namespace litestl::alloc {
+/**
+ * Starts sampling about every @p sample_bytes allocated, dropping earlier
+ * samples.  Returns false if the platform can't capture stacks.
+ */
+bool start_heap_profile(size_t sample_bytes = 512 * 1024);
+/** Stops taking samples.  Collected samples are kept for write_heap_profile. */
+void stop_heap_profile();
+
+/**
+ * Writes the profile to @p file as folded stacks, one line per call stack:
+ * frames outermost first separated by ';', then a space and the estimated
+ * bytes.  Counts bytes still allocated, or with @p include_released
+ * everything allocated since start_heap_profile.
+ */
+void write_heap_profile(FILE *file, bool include_released = false);
+
+namespace detail {
+/** Engine tag bit marking sampled blocks. */
+static constexpr uint16_t sampled_tag = 0x8000;
+
+extern std::atomic<bool> heap_profile_active;
+/** Set once profiling has started; sampled blocks may exist from then on. */
+extern std::atomic<bool> heap_profile_used;
+
+bool profile_countdown(size_t size);
+
+/** Returns true if an allocation of @p size bytes should be sampled. */
+inline bool profile_should_sample(size_t size)
+{
+  return heap_profile_active.load(std::memory_order_relaxed) && profile_countdown(size);
+}
+
+/** Records a sampled block at @p block, of @p size requested bytes. */
+void profile_alloc(const void *block, size_t size);
+/** Forgets the sampled block at @p block. */
+void profile_release(const void *block);
+/** Follows a sampled block that was resized (and possibly moved). */
+void profile_resize(const void *old_block, const void *block, size_t size);
+} // namespace detail
+} // namespace litestl::alloc
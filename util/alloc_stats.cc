@@ -0,0 +1,455 @@
+#include "alloc_stats.h"
+#include "alloc_engine.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+namespace litestl::alloc {
+namespace {
+/* Tag id 0 collects untagged allocations, and tags past max_tags. */
+constexpr int max_tags = 1024;
+constexpr int tags_per_page = 64;
+/* Per-thread byte deltas are folded into the global totals past this size. */
+constexpr int64_t flush_bytes = 64 * 1024;
+
+/** Global totals of a tag. */
+struct TagTotals {
+  std::atomic<int64_t> bytes;
+  std::atomic<int64_t> peak;
+  /* Allocations of threads whose own counters are already gone. */
+  std::atomic<uint64_t> histogram[tag_histogram_size];
+};
+
+/**
+ * Per-thread counters of a tag, only written by their thread.  The
+ * allocation count is the sum of the histogram.
+ */
+struct TagCounters {
+  /* Bytes not yet folded into TagTotals::bytes. */
+  std::atomic<int64_t> pending;
+  std::atomic<uint64_t> histogram[tag_histogram_size];
+};
+
+/**
+ * Counters of one thread, allocated a page of tags at a time.  Never freed;
+ * on thread exit pending bytes are flushed and the block is handed to the
+ * next new thread.
+ */
+struct ThreadStats {
+  std::atomic<TagCounters *> pages[max_tags / tags_per_page];
+  std::atomic<bool> in_use;
+  ThreadStats *next;
+};
+
+std::mutex tag_mutex;
+std::atomic<int> tag_count = {1};
+const char *tag_names[max_tags] = {"(untagged)"};
+TagTotals tag_totals[max_tags];
+
+/** All ThreadStats ever created.  Push-only. */
+std::atomic<ThreadStats *> all_thread_stats = {nullptr};
+
+thread_local ThreadStats *thread_stats = nullptr;
+/* Set once the thread's stats are released, later calls go to the totals. */
+thread_local bool thread_stats_dead = false;
+
+struct ThreadStatsOwner {
+  ThreadStats *stats = nullptr;
+
+  ~ThreadStatsOwner();
+};
+thread_local ThreadStatsOwner thread_stats_owner;
+
+#ifdef ALLOC_TAG_IDS
+uint32_t tag_hashes[max_tags];
+
+/* Pointer to id cache.  Tags are nearly always literals, so this almost never misses. */
+struct TagCacheEntry {
+  const char *tag;
+  uint16_t id;
+};
+constexpr int tag_cache_size = 256;
+thread_local TagCacheEntry tag_cache[tag_cache_size];
+#endif
+
+/** Adds @p delta to a counter only written by the calling thread. */
+template <typename T> inline void add_owned(std::atomic<T> &counter, T delta)
+{
+  counter.store(counter.load(std::memory_order_relaxed) + delta,
+                std::memory_order_relaxed);
+}
+
+inline int histogram_bucket(size_t size)
+{
+  if (size <= 16) {
+    return 0;
+  }
+
+  return std::min(int(std::bit_width(size - 1)) - 4, tag_histogram_size - 1);
+}
+
+#ifdef ALLOC_TAG_IDS
+uint32_t hash_tag(const char *tag)
+{
+  uint32_t hash = 2166136261u;
+
+  for (; *tag; tag++) {
+    hash = (hash ^ uint8_t(*tag)) * 16777619u;
+  }
+
+  return hash;
+}
+
+[[gnu::noinline]] uint16_t intern_tag(const char *tag)
+{
+  const uint32_t hash = hash_tag(tag);
+
+  std::lock_guard guard(tag_mutex);
+  const int count = tag_count.load(std::memory_order_relaxed);
+
+  for (int i = 1; i < count; i++) {
+    if (tag_hashes[i] == hash && strcmp(tag_names[i], tag) == 0) {
+      return uint16_t(i);
+    }
+  }
+
+  if (count == max_tags) {
+    return 0;
+  }
+
+  /* Copy, the tag may not be a literal. */
+  const size_t len = strlen(tag);
+  char *name = static_cast<char *>(engine::alloc(len + 1));
+  if (!name) {
+    return 0;
+  }
+  memcpy(name, tag, len + 1);
+
+  tag_names[count] = name;
+  tag_hashes[count] = hash;
+  tag_count.store(count + 1, std::memory_order_release);
+
+  return uint16_t(count);
+}
+#endif
+
+[[gnu::noinline]] void add_total(uint16_t tag, int64_t delta)
+{
+  TagTotals &totals = tag_totals[tag];
+  const int64_t bytes = totals.bytes.fetch_add(delta, std::memory_order_relaxed) + delta;
+
+  if (delta <= 0) {
+    return;
+  }
+
+  int64_t peak = totals.peak.load(std::memory_order_relaxed);
+  while (bytes > peak &&
+         !totals.peak.compare_exchange_weak(peak, bytes, std::memory_order_relaxed))
+  {
+  }
+}
+
+ThreadStats *claim_thread_stats()
+{
+  for (ThreadStats *stats = all_thread_stats.load(); stats; stats = stats->next) {
+    bool in_use = false;
+    if (!stats->in_use.load(std::memory_order_relaxed) &&
+        stats->in_use.compare_exchange_strong(in_use, true))
+    {
+      return stats;
+    }
+  }
+
+  void *mem = engine::alloc(sizeof(ThreadStats));
+  if (!mem) {
+    return nullptr;
+  }
+
+  ThreadStats *stats = new (mem) ThreadStats();
+  stats->in_use.store(true, std::memory_order_relaxed);
+
+  ThreadStats *head = all_thread_stats.load(std::memory_order_relaxed);
+  do {
+    stats->next = head;
+  } while (!all_thread_stats.compare_exchange_weak(head, stats));
+
+  return stats;
+}
+
+/** Returns the calling thread's counters for @p tag, creating them if needed. */
+[[gnu::noinline]] TagCounters *get_counters_slow(uint16_t tag)
+{
+  if (!thread_stats && !thread_stats_dead) {
+    thread_stats = claim_thread_stats();
+    thread_stats_owner.stats = thread_stats;
+  }
+  if (!thread_stats) {
+    return nullptr;
+  }
+
+  std::atomic<TagCounters *> &slot = thread_stats->pages[tag / tags_per_page];
+  TagCounters *page = slot.load(std::memory_order_relaxed);
+
+  if (!page) {
+    page = static_cast<TagCounters *>(engine::alloc(sizeof(TagCounters) * tags_per_page));
+    if (!page) {
+      return nullptr;
+    }
+
+    for (int i = 0; i < tags_per_page; i++) {
+      new (static_cast<void *>(page + i)) TagCounters();
+    }
+    slot.store(page, std::memory_order_release);
+  }
+
+  return page + tag % tags_per_page;
+}
+
+inline TagCounters *get_counters(uint16_t tag)
+{
+  if (thread_stats) {
+    if (TagCounters *page =
+            thread_stats->pages[tag / tags_per_page].load(std::memory_order_relaxed))
+    {
+      return page + tag % tags_per_page;
+    }
+  }
+
+  return get_counters_slow(tag);
+}
+
+inline void add_bytes(TagCounters *counters, uint16_t tag, int64_t delta)
+{
+  const int64_t pending = counters->pending.load(std::memory_order_relaxed) + delta;
+
+  if (pending >= flush_bytes || pending <= -flush_bytes) {
+    add_total(tag, pending);
+    counters->pending.store(0, std::memory_order_relaxed);
+  } else {
+    counters->pending.store(pending, std::memory_order_relaxed);
+  }
+}
+
+ThreadStatsOwner::~ThreadStatsOwner()
+{
+  thread_stats_dead = true;
+  thread_stats = nullptr;
+
+  if (!stats) {
+    return;
+  }
+
+  for (int page_i = 0; page_i < max_tags / tags_per_page; page_i++) {
+    TagCounters *page = stats->pages[page_i].load(std::memory_order_relaxed);
+    if (!page) {
+      continue;
+    }
+
+    for (int i = 0; i < tags_per_page; i++) {
+      const int64_t pending = page[i].pending.exchange(0, std::memory_order_relaxed);
+      if (pending) {
+        add_total(uint16_t(page_i * tags_per_page + i), pending);
+      }
+    }
+  }
+
+  stats->in_use.store(false, std::memory_order_release);
+}
+
+void write_json_string(FILE *file, const char *str)
+{
+  fputc('"', file);
+
+  for (; *str; str++) {
+    const unsigned char c = static_cast<unsigned char>(*str);
+
+    if (c == '"' || c == '\\') {
+      fprintf(file, "\\%c", c);
+    } else if (c < 0x20) {
+      fprintf(file, "\\u%04x", c);
+    } else {
+      fputc(c, file);
+    }
+  }
+
+  fputc('"', file);
+}
+} // namespace
+
+namespace detail {
+#ifdef ALLOC_TAG_IDS
+uint16_t tag_id(const char *tag)
+{
+  if (!tag) {
+    return 0;
+  }
+
+  TagCacheEntry &entry =
+      tag_cache[((uintptr_t(tag) >> 4) ^ (uintptr_t(tag) >> 12)) % tag_cache_size];
+
+  if (entry.tag == tag) [[likely]] {
+    return entry.id;
+  }
+
+  entry.id = intern_tag(tag);
+  entry.tag = tag;
+  return entry.id;
+}
+#endif
+
+const char *tag_name(uint16_t id)
+{
+  return id < tag_count.load(std::memory_order_acquire) ? tag_names[id] : tag_names[0];
+}
+
+#ifndef NO_ALLOC_STATS
+
+void stats_alloc(uint16_t tag, size_t size, size_t block_size)
+{
+  TagCounters *counters = get_counters(tag);
+
+  if (!counters) {
+    TagTotals &totals = tag_totals[tag];
+    totals.histogram[histogram_bucket(size)].fetch_add(1, std::memory_order_relaxed);
+    add_total(tag, int64_t(block_size));
+    return;
+  }
+
+  add_owned<uint64_t>(counters->histogram[histogram_bucket(size)], 1);
+  add_bytes(counters, tag, int64_t(block_size));
+}
+
+void stats_release(uint16_t tag, size_t block_size)
+{
+  TagCounters *counters = get_counters(tag);
+
+  if (!counters) {
+    add_total(tag, -int64_t(block_size));
+    return;
+  }
+
+  add_bytes(counters, tag, -int64_t(block_size));
+}
+#endif
+} // namespace detail
+
+void for_each_tag_stats(void (*cb)(const TagStats &stats, void *userdata), void *userdata)
+{
+  const int count = tag_count.load(std::memory_order_acquire);
+
+  for (int tag = 0; tag < count; tag++) {
+    TagTotals &totals = tag_totals[tag];
+    TagStats stats;
+
+    stats.tag = tag_names[tag];
+    stats.bytes = totals.bytes.load(std::memory_order_relaxed);
+    stats.peak_bytes = totals.peak.load(std::memory_order_relaxed);
+    stats.count = 0;
+    for (int i = 0; i < tag_histogram_size; i++) {
+      stats.histogram[i] = totals.histogram[i].load(std::memory_order_relaxed);
+      stats.count += stats.histogram[i];
+    }
+
+    for (ThreadStats *thread = all_thread_stats.load(); thread; thread = thread->next) {
+      TagCounters *page =
+          thread->pages[tag / tags_per_page].load(std::memory_order_acquire);
+      if (!page) {
+        continue;
+      }
+
+      TagCounters &counters = page[tag % tags_per_page];
+      stats.bytes += counters.pending.load(std::memory_order_relaxed);
+      for (int i = 0; i < tag_histogram_size; i++) {
+        const uint64_t count = counters.histogram[i].load(std::memory_order_relaxed);
+        stats.histogram[i] += count;
+        stats.count += count;
+      }
+    }
+
+    if (stats.count == 0) {
+      continue;
+    }
+
+    stats.peak_bytes = std::max(stats.peak_bytes, stats.bytes);
+    cb(stats, userdata);
+  }
+}
+
+void report(FILE *file)
+{
+  struct Collected {
+    TagStats *tags;
+    int count;
+  };
+
+  const size_t tags_size = sizeof(TagStats) * max_tags;
+  Collected collected = {static_cast<TagStats *>(engine::alloc(tags_size)), 0};
+  if (!collected.tags) {
+    return;
+  }
+
+  for_each_tag_stats(
+      [](const TagStats &stats, void *userdata) {
+        Collected *collected = static_cast<Collected *>(userdata);
+        collected->tags[collected->count++] = stats;
+      },
+      static_cast<void *>(&collected));
+
+  std::sort(collected.tags,
+            collected.tags + collected.count,
+            [](const TagStats &a, const TagStats &b) { return a.bytes > b.bytes; });
+
+  int64_t total = 0;
+  for (int i = 0; i < collected.count; i++) {
+    total += collected.tags[i].bytes;
+  }
+
+  fprintf(file, "{\n");
+  fprintf(file, "  \"bytes\": %lld,\n", static_cast<long long>(total));
+  const engine::Stats engine_stats = engine::get_stats();
+  fprintf(file,
+          "  \"mapped_bytes\": %llu,\n",
+          static_cast<unsigned long long>(engine_stats.mapped_bytes));
+  fprintf(file,
+          "  \"large_blocks\": {\"count\": %llu, \"bytes\": %llu, "
+          "\"huge_page_count\": %llu, \"huge_page_bytes\": %llu},\n",
+          static_cast<unsigned long long>(engine_stats.large_count),
+          static_cast<unsigned long long>(engine_stats.large_bytes),
+          static_cast<unsigned long long>(engine_stats.huge_count),
+          static_cast<unsigned long long>(engine_stats.huge_bytes));
+  fprintf(file, "  \"histogram_bounds\": [");
+  for (int i = 0; i < tag_histogram_size - 1; i++) {
+    fprintf(file, "%d, ", 16 << i);
+  }
+  fprintf(file, "null],\n");
+  fprintf(file, "  \"tags\": [");
+
+  for (int i = 0; i < collected.count; i++) {
+    const TagStats &stats = collected.tags[i];
+
+    fprintf(file, i ? ",\n    {\"tag\": " : "\n    {\"tag\": ");
+    write_json_string(file, stats.tag);
+    fprintf(file,
+            ", \"bytes\": %lld, \"peak_bytes\": %lld, \"count\": %llu, \"histogram\": [",
+            static_cast<long long>(stats.bytes),
+            static_cast<long long>(stats.peak_bytes),
+            static_cast<unsigned long long>(stats.count));
+
+    for (int j = 0; j < tag_histogram_size; j++) {
+      fprintf(file,
+              j ? ", %llu" : "%llu",
+              static_cast<unsigned long long>(stats.histogram[j]));
+    }
+    fprintf(file, "]}");
+  }
+
+  fprintf(file, collected.count ? "\n  ]\n}\n" : "]\n}\n");
+  fflush(file);
+
+  engine::release(static_cast<void *>(collected.tags));
+}
+} // namespace litestl::alloc
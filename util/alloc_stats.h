@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+/*
+ * Per-tag allocation statistics.
+ *
+ * Every alloc::alloc is accounted under its tag ("Vector data", "Map table",
+ * ...), in debug and NO_DEBUG_ALLOC builds alike.  Tags are compared by
+ * content, so equal literals from different translation units share an entry.
+ * Each thread caches the entry of a tag pointer, so a tag's text must not
+ * change while it is in use (literals are the norm).
+ *
+ * Counters are kept per thread and summed on demand.  Byte counts are
+ * folded into global totals in batches, so peak_bytes may miss up to 64kb
+ * per thread of the true peak.
+ *
+ *   alloc::report(stderr);  // JSON, one entry per tag
+ *
+ * The report also carries the engine's totals: bytes mapped from the OS and
+ * the directly mapped large blocks, with those on huge pages counted
+ * separately.
+ *
+ * Memory allocated inside an alloc::ArenaScope is not accounted.  Defining
+ * NO_ALLOC_STATS (LITESTL_ALLOC_STATS=OFF) compiles the counters out, the
+ * report is then empty.
+ */
+namespace litestl::alloc {
+/** Number of size buckets in TagStats::histogram. */
+static constexpr int tag_histogram_size = 16;
+
+struct TagStats {
+  const char *tag;
+  /** Bytes currently held, including size class rounding and debug headers. */
+  int64_t bytes;
+  /** Highest value of bytes seen. */
+  int64_t peak_bytes;
+  /** Number of allocations made. */
+  uint64_t count;
+  /**
+   * Allocations by requested size.  Bucket 0 counts sizes up to 16 bytes,
+   * bucket i sizes in (8 << i, 16 << i], the last bucket everything larger.
+   */
+  uint64_t histogram[tag_histogram_size];
+};
+
+/** Calls @p cb for every tag allocated with so far. */
+void for_each_tag_stats(void (*cb)(const TagStats &stats, void *userdata),
+                        void *userdata);
+/** Writes per-tag statistics as JSON to @p file. */
+void report(FILE *file);
+
+/* Compact debug headers store interned tag ids, so they keep interning when
+ * the counters are compiled out. */
+#if !defined(NO_ALLOC_STATS) || (defined(COMPACT_DEBUG_ALLOC) && !defined(NO_DEBUG_ALLOC))
+#define ALLOC_TAG_IDS
+#endif
+
+namespace detail {
+#ifdef ALLOC_TAG_IDS
+/** Returns the interned id of @p tag, stored with each block by the engine. */
+uint16_t tag_id(const char *tag);
+#else
+static inline uint16_t tag_id(const char * /*tag*/)
+{
+  return 0;
+}
+#endif
+/** Returns the tag interned as @p id. */
+const char *tag_name(uint16_t id);
+
+#ifndef NO_ALLOC_STATS
+/** Accounts an allocation of @p size bytes taking @p block_size bytes. */
+void stats_alloc(uint16_t tag, size_t size, size_t block_size);
+/** Accounts the release of a @p block_size byte block. */
+void stats_release(uint16_t tag, size_t block_size);
+#else
+static inline void stats_alloc(uint16_t /*tag*/, size_t /*size*/, size_t /*block_size*/)
+{
+}
+static inline void stats_release(uint16_t /*tag*/, size_t /*block_size*/) {}
+#endif
+} // namespace detail
+} // namespace litestl::alloc
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "alloc.h"
+#include "arena.h"
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <cstring>
+
+namespace litestl::alloc {
+/**
+ * Allocator policy used by litestl containers (the last template parameter of
+ * Vector, Map, Set, BoolVector, Array and String).
+ *
+ * `allocate` receives the container's debug tag, e.g. "Vector data".  Policies
+ * may be stateless, in which case containers store them at zero size, or
+ * stateful; containers copy their policy along with their contents.
+ */
+template <typename A>
+concept AllocatorPolicy = requires(A a, const char *tag, size_t size, void *ptr) {
+  { a.allocate(tag, size) } -> std::same_as<void *>;
+  { a.deallocate(ptr) };
+};
+
+/** Policy that can also honor alignments above alloc::default_align. */
+template <typename A>
+concept AlignedAllocatorPolicy =
+    AllocatorPolicy<A> && requires(A a, const char *tag, size_t size, size_t align) {
+      { a.allocate_aligned(tag, size, align) } -> std::same_as<void *>;
+    };
+
+/**
+ * Policy that can resize blocks, possibly in place.  @p old_size is the size
+ * the block was allocated (or last resized) with.
+ */
+template <typename A>
+concept ReallocatingAllocatorPolicy =
+    AllocatorPolicy<A> && requires(A a, const char *tag, void *ptr, size_t size) {
+      { a.reallocate(tag, ptr, size, size) } -> std::same_as<void *>;
+    };
+
+/**
+ * Allocates room for @p count elements of @p T from @p allocator.  Over-aligned
+ * element types need a policy with allocate_aligned.
+ */
+template <typename T, AllocatorPolicy A>
+inline T *allocate_array(A &allocator, const char *tag, size_t count)
+{
+  if constexpr (alignof(T) > default_align) {
+    static_assert(AlignedAllocatorPolicy<A>,
+                  "over-aligned element type needs allocate_aligned in the policy");
+    return static_cast<T *>(
+        allocator.allocate_aligned(tag, sizeof(T) * count, alignof(T)));
+  } else {
+    return static_cast<T *>(allocator.allocate(tag, sizeof(T) * count));
+  }
+}
+
+/**
+ * Resizes @p data, allocated for @p old_count elements, to @p count elements,
+ * keeping the first min(old_count, count).  Elements are moved bytewise, so
+ * @p T must be trivially relocatable (see is_simple).  Uses the policy's
+ * reallocate when it has one.
+ */
+template <typename T, AllocatorPolicy A>
+inline T *reallocate_array(A &allocator, const char *tag, T *data, size_t old_count,
+                           size_t count)
+{
+  if constexpr (ReallocatingAllocatorPolicy<A> && alignof(T) <= default_align) {
+    return static_cast<T *>(allocator.reallocate(
+        tag, static_cast<void *>(data), sizeof(T) * old_count, sizeof(T) * count));
+  } else {
+    T *newdata = allocate_array<T>(allocator, tag, count);
+
+    if (data) {
+      memcpy(static_cast<void *>(newdata), static_cast<void *>(data),
+             sizeof(T) * std::min(old_count, count));
+      allocator.deallocate(static_cast<void *>(data));
+    }
+
+    return newdata;
+  }
+}
+
+/** Default policy, tagged alloc::alloc and alloc::release. */
+struct TaggedAllocator {
+  void *allocate(const char *tag, size_t size)
+  {
+    return alloc::alloc(tag, size);
+  }
+
+  void *allocate_aligned(const char *tag, size_t size, size_t align)
+  {
+    return alloc::alloc_aligned(tag, size, align);
+  }
+
+  void *reallocate(const char *tag, void *ptr, size_t old_size, size_t size)
+  {
+    return alloc::realloc(tag, ptr, old_size, size);
+  }
+
+  void deallocate(void *ptr)
+  {
+    alloc::release(ptr);
+  }
+};
+
+/** Allocates from an Arena.  deallocate does nothing, the arena frees in bulk. */
+struct ArenaAllocator {
+  ArenaAllocator(Arena &arena) : arena_(&arena)
+  {
+  }
+
+  void *allocate(const char * /*tag*/, size_t size)
+  {
+    return arena_->alloc(size);
+  }
+
+  void *allocate_aligned(const char * /*tag*/, size_t size, size_t align)
+  {
+    return arena_->alloc(size, align);
+  }
+
+  void *reallocate(const char * /*tag*/, void *ptr, size_t old_size, size_t size)
+  {
+    return arena_->realloc(ptr, old_size, size);
+  }
+
+  void deallocate(void * /*ptr*/)
+  {
+  }
+
+private:
+  Arena *arena_;
+};
+} // namespace litestl::alloc
@@ -0,0 +1,149 @@
+#include "arena.h"
+#include "alloc_engine.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace litestl::alloc {
+struct alignas(16) Arena::Chunk {
+  Chunk *next;
+  char *end;
+
+  char *start()
+  {
+    return reinterpret_cast<char *>(this + 1);
+  }
+};
+
+Arena::~Arena()
+{
+  Chunk *chunk = first_;
+
+  while (chunk) {
+    Chunk *next = chunk->next;
+    engine::release_arena_chunk(static_cast<void *>(chunk));
+    chunk = next;
+  }
+}
+
+bool Arena::enter_chunk(Chunk *chunk, size_t size, size_t align)
+{
+  char *start = reinterpret_cast<char *>((uintptr_t(chunk->start()) + align - 1) &
+                                         ~uintptr_t(align - 1));
+  if (start + size > chunk->end) {
+    return false;
+  }
+
+  current_ = chunk;
+  pos_ = chunk->start();
+  end_ = chunk->end;
+  return true;
+}
+
+void *Arena::alloc_slow(size_t size, size_t align)
+{
+  /* Reuse the chunk after the current one, kept from before a reset or rewind. */
+  Chunk *next = current_ ? current_->next : first_;
+
+  if (!next || !enter_chunk(next, size, align)) {
+    size_t usable;
+    void *mem = engine::alloc_arena_chunk(
+        std::max(block_size_, sizeof(Chunk) + size + align), &usable);
+    if (!mem) {
+      return nullptr;
+    }
+
+    Chunk *chunk = static_cast<Chunk *>(mem);
+    chunk->end = static_cast<char *>(mem) + usable;
+    chunk->next = next;
+
+    if (current_) {
+      current_->next = chunk;
+    } else {
+      first_ = chunk;
+    }
+
+    reserved_ += usable;
+    enter_chunk(chunk, size, align);
+  }
+
+  return alloc(size, align);
+}
+
+void *Arena::realloc(void *ptr, size_t old_size, size_t size, size_t align)
+{
+  char *cptr = static_cast<char *>(ptr);
+
+  if (cptr && cptr + old_size == pos_ && cptr + size <= end_) {
+    pos_ = cptr + size;
+    return ptr;
+  }
+
+  void *mem = alloc(size, align);
+  if (mem && ptr) {
+    memcpy(mem, ptr, std::min(old_size, size));
+  }
+
+  return mem;
+}
+
+void Arena::rewind(const Mark &mark)
+{
+  current_ = mark.chunk;
+  pos_ = mark.pos;
+  end_ = current_ ? current_->end : nullptr;
+}
+
+void Arena::trim()
+{
+  Chunk **link = current_ ? &current_->next : &first_;
+  Chunk *chunk = *link;
+  *link = nullptr;
+
+  while (chunk) {
+    Chunk *next = chunk->next;
+    reserved_ -= size_t(chunk->end - reinterpret_cast<char *>(chunk));
+    engine::release_arena_chunk(static_cast<void *>(chunk));
+    chunk = next;
+  }
+}
+
+size_t Arena::used() const
+{
+  if (!current_) {
+    return 0;
+  }
+
+  size_t used = 0;
+  for (Chunk *chunk = first_; chunk != current_; chunk = chunk->next) {
+    used += size_t(chunk->end - chunk->start());
+  }
+
+  return used + size_t(pos_ - current_->start());
+}
+
+static thread_local Arena *current_arena_tls = nullptr;
+
+ArenaScope::ArenaScope(Arena &arena, bool rewind_on_exit)
+    : arena_(arena), prev_(current_arena_tls), mark_(arena.mark()),
+      rewind_(rewind_on_exit)
+{
+  current_arena_tls = &arena;
+}
+
+ArenaScope::~ArenaScope()
+{
+  current_arena_tls = prev_;
+
+  if (rewind_) {
+    arena_.rewind(mark_);
+  }
+}
+
+namespace detail {
+Arena *current_arena()
+{
+  return current_arena_tls;
+}
+} // namespace detail
+} // namespace litestl::alloc
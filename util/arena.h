@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+namespace litestl::alloc {
+/**
+ * Monotonic (bump pointer) allocator for short-lived working sets.
+ *
+ * Memory is carved out of chunks of @p block_size bytes and is only given
+ * back in bulk, by reset() or by rewinding to a mark.  Chunks are kept for
+ * reuse until trim() or destruction.
+ *
+ * Containers allocate from an arena through ArenaScope, which routes
+ * alloc::alloc on the current thread to it:
+ *
+ *   alloc::Arena arena;
+ *   {
+ *     alloc::ArenaScope scope(arena);
+ *     util::Vector<float> temp;   // storage comes from arena
+ *     ...
+ *   }
+ *   arena.reset();                // O(1), drops everything at once
+ *
+ * alloc::release on arena memory is a no-op, so containers may still be
+ * destructed normally; destructors of non-trivial elements still run.
+ * Containers must not outlive a reset or rewind covering their storage.
+ *
+ * Not thread safe.
+ */
+class Arena {
+  struct Chunk;
+
+public:
+  static constexpr size_t default_block_size = 256 * 1024;
+
+  /** Position in the arena, see mark() and rewind(). */
+  struct Mark {
+    Chunk *chunk;
+    char *pos;
+  };
+
+  explicit Arena(size_t block_size = default_block_size) : block_size_(block_size)
+  {
+  }
+
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  ~Arena();
+
+  /** Allocates @p size bytes aligned to @p align (a power of two). */
+  void *alloc(size_t size, size_t align = 16)
+  {
+    char *ptr = reinterpret_cast<char *>((uintptr_t(pos_) + align - 1) &
+                                         ~uintptr_t(align - 1));
+
+    if (pos_ && ptr + size <= end_) {
+      pos_ = ptr + size;
+      return static_cast<void *>(ptr);
+    }
+
+    return alloc_slow(size, align);
+  }
+
+  /**
+   * Resizes @p ptr, allocated from this arena with @p old_size bytes, to
+   * @p size bytes.  The most recent allocation grows in place, anything else
+   * is copied to a new allocation.
+   */
+  void *realloc(void *ptr, size_t old_size, size_t size, size_t align = 16);
+
+  /** Allocates and constructs a @p T.  Its destructor is never run by the arena. */
+  template <typename T, typename... Args> T *New(Args &&...args)
+  {
+    return new (alloc(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+  }
+
+  /** Returns the current position, for a later rewind(). */
+  Mark mark() const
+  {
+    return {current_, pos_};
+  }
+
+  /** Releases everything allocated since @p mark was taken.  Marks nest. */
+  void rewind(const Mark &mark);
+
+  /** Releases everything allocated, keeping the chunks for reuse. */
+  void reset()
+  {
+    rewind({nullptr, nullptr});
+  }
+
+  /** Returns unused chunks past the current position to the allocator. */
+  void trim();
+
+  /** Bytes handed out since the last reset, including alignment padding. */
+  size_t used() const;
+  /** Bytes held in chunks. */
+  size_t reserved() const
+  {
+    return reserved_;
+  }
+
+private:
+  void *alloc_slow(size_t size, size_t align);
+  bool enter_chunk(Chunk *chunk, size_t size, size_t align);
+
+  size_t block_size_;
+  size_t reserved_ = 0;
+  Chunk *first_ = nullptr;
+  Chunk *current_ = nullptr;
+  char *pos_ = nullptr;
+  char *end_ = nullptr;
+};
+
+/**
+ * Routes alloc::alloc on this thread to @p arena while in scope.  Scopes nest;
+ * the previous arena (or the normal heap) is restored on exit.  If
+ * @p rewind_on_exit is set the arena is rewound to where it was when the
+ * scope was entered.
+ */
+struct ArenaScope {
+  ArenaScope(Arena &arena, bool rewind_on_exit = false);
+  ~ArenaScope();
+
+  ArenaScope(const ArenaScope &) = delete;
+  ArenaScope &operator=(const ArenaScope &) = delete;
+
+private:
+  Arena &arena_;
+  Arena *prev_;
+  Arena::Mark mark_;
+  bool rewind_;
+};
+
+namespace detail {
+/** Arena installed by the innermost ArenaScope on this thread, if any. */
+Arena *current_arena();
+} // namespace detail
+} // namespace litestl::alloc
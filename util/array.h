@@ -1,13 +1,16 @@
 #pragma once 
 #include "alloc.h"
+#include "allocator.h"
 #include "compiler_util.h"
 #include "vector.h"
 
 namespace litestl::util {
-template <typename T> struct Array {
+template <typename T, alloc::AllocatorPolicy Allocator = alloc::TaggedAllocator>
+struct Array {
   using value_type = T;
+  using allocator_type = Allocator;
   struct iterator {
-    inline iterator(Array &array, int i) : array_(array), i_(i)
+    inline iterator(Array &array, IndexInt i) : array_(array), i_(i)
     {
     }
 
@@ -43,17 +46,19 @@ template <typename T> struct Array {
 
   private:
     Array &array_;
-    int i_;
+    IndexInt i_;
   };
 
   ~Array()
   {
     if (data_) {
       if constexpr (!is_simple<T>()) {
-        alloc::DeleteArray<T>(data_, size_);
-      } else {
-        alloc::release(static_cast<void *>(data_));
+        for (size_t i = 0; i < size_; i++) {
+          data_[i].~T();
+        }
       }
+
+      allocator_.deallocate(static_cast<void *>(data_));
     }
   }
 
@@ -61,25 +66,37 @@ template <typename T> struct Array {
   {
   }
 
-  Array(size_t size) : size_(0), data_(nullptr)
+  explicit Array(const Allocator &allocator)
+      : data_(nullptr), size_(0), allocator_(allocator)
+  {
+  }
+
+  Array(size_t size) : data_(nullptr), size_(0)
   {
     resize(size);
   }
 
+  Array(size_t size, const Allocator &allocator)
+      : data_(nullptr), size_(0), allocator_(allocator)
+  {
+    resize(size);
+  }
+
+  /** Takes ownership of @p data, which must have been allocated by @p Allocator. */
   Array(T *data, size_t size) : data_(data), size_(size)
   {
   }
 
-  Array(const Array &b) : size_(b.size_)
+  Array(const Array &b) : size_(b.size_), allocator_(b.allocator_)
   {
-    data_ = static_cast<T *>(alloc::alloc("Array", size_ * sizeof(T)));
+    data_ = alloc::allocate_array<T>(allocator_, "Array", size_);
 
-    for (int i = 0; i < size_; i++) {
-      data_[i] = b.data_[i];
+    for (size_t i = 0; i < size_; i++) {
+      new (static_cast<void *>(&data_[i])) T(b.data_[i]);
     }
   }
 
-  Array(Array &&b) : size_(b.size_)
+  Array(Array &&b) : size_(b.size_), allocator_(b.allocator_)
   {
     data_ = std::move(b.data_);
 
@@ -87,6 +104,11 @@ template <typename T> struct Array {
     b.size_ = 0;
   }
 
+  const Allocator &get_allocator() const
+  {
+    return allocator_;
+  }
+
   inline iterator begin()
   {
     return iterator(*this, 0);
@@ -99,48 +121,61 @@ template <typename T> struct Array {
 
   template <bool construct_destruct = true> void resize(size_t newsize)
   {
-    size_t oldsize = size_;
+    if constexpr (is_simple<T>()) {
+      const size_t oldsize = size_;
 
-    T *newdata = static_cast<T *>(alloc::alloc(__func__, sizeof(T) * newsize));
+      data_ = alloc::reallocate_array<T>(allocator_, __func__, data_, oldsize, newsize);
+      size_ = newsize;
 
-    int count = std::min(size_, newsize);
+      if (construct_destruct) {
+        for (size_t i = oldsize; i < newsize; i++) {
+          data_[i] = T(0);
+        }
+      }
+      return;
+    }
+
+    T *newdata = alloc::allocate_array<T>(allocator_, __func__, newsize);
 
-    for (int i = 0; i < count; i++) {
-      newdata[i] = std::move(data_[i]);
+    size_t count = std::min(size_, newsize);
+
+    for (size_t i = 0; i < count; i++) {
+      new (static_cast<void *>(&newdata[i])) T(std::move(data_[i]));
     }
 
     if (construct_destruct) {
       if (!is_simple<T>()) {
         /* New size bigger? */
-        for (int i = size_; i < newsize; i++) {
+        for (size_t i = size_; i < newsize; i++) {
           new (static_cast<void *>(&newdata[i])) T();
         }
-
-        /* New size smaller? */
-        for (int i = newsize; i < size_; i++) {
-          data_[i].~T();
-        }
       } else {
-        if (size_ < newsize) {
-          for (int i = size_; i < newsize; i++) {
-            newdata[size_] = T(0);
-          }
+        for (size_t i = size_; i < newsize; i++) {
+          newdata[i] = T(0);
         }
       }
     }
 
-    alloc::release(static_cast<void *>(data_));
+    if constexpr (!is_simple<T>()) {
+      for (size_t i = 0; i < size_; i++) {
+        data_[i].~T();
+      }
+    }
+
+    if (data_) {
+      allocator_.deallocate(static_cast<void *>(data_));
+    }
 
     data_ = newdata;
     size_ = newsize;
   }
 
-  inline T &operator[](int idx)
+  inline T &operator[](IndexInt idx)
   {
     return data_[idx];
   }
 
-  inline const T &operator[](int idx) const
+  inline const T &operator[](IndexInt idx) const
   {
     return data_[idx];
   }
@@ -153,5 +188,6 @@ template <typename T> struct Array {
 private:
   T *data_;
   size_t size_;
+  no_unique_addr Allocator allocator_;
 };
 } // namespace litestl::util
@@ -1,43 +1,42 @@
 /**
- * TODO: make this truly atomic.  For now it does use a mutex.
- *       Lock-free doubly-linked lists are complicated.
+ * Intrusive doubly-linked list owned by a single thread.
+ *
+ * The owner links and unlinks nodes without any locking.  Other threads
+ * never touch the links directly; instead they push nodes onto a lock-free
+ * "remote" stack, and the owner unlinks them later in drainRemote().
  */
 
 #pragma once
 #include "compiler_util.h"
 #include <atomic>
-#include <mutex>
+#include <concepts>
 #include <type_traits>
 
 namespace litestl::util {
-namespace detail {
-template <typename T> struct Link {
-  T *next, *prev;
-};
-} // namespace detail
 
-template <typename NodeData, typename Node>
-concept LinkedListNode = requires(Node *node, NodeData data) {
-  { std::remove_reference_t<decltype(node->next)>() } -> std::same_as<Node *>;
-  { std::remove_reference_t<decltype(node->prev)>() } -> std::same_as<Node *>;
-  { node->data() } -> std::same_as<NodeData>;
-  { Node::wrapData(data) } -> std::same_as<Node *>;
+/**
+ * Nodes carry their own `next`/`prev` links plus a separate link used
+ * while queued on the remote stack, exposed through `Node::remoteNext`.
+ */
+template <typename Node>
+concept LinkedListNode = requires(Node *node) {
+  { node->next } -> std::convertible_to<Node *>;
+  { node->prev } -> std::convertible_to<Node *>;
+  { Node::remoteNext(node) } -> std::same_as<Node *&>;
 };
 
-template <typename T, LinkedListNode<T> NodeData=T*> struct AtomicLinkedList {
+template <LinkedListNode T> struct AtomicLinkedList {
   T *first = {nullptr};
   T *last = {nullptr};
-  std::recursive_mutex mutex;
+  std::atomic<T *> remote = {nullptr};
 
-  AtomicLinkedList()
+  constexpr AtomicLinkedList()
   {
   }
 
-  T *push(NodeData &&data)
+  /** Appends @p node.  Owner thread only. */
+  T *push(T *node)
   {
-    std::lock_guard guard(mutex);
-    T *node = T::wrapData(data);
-
     if (!first) {
       first = last = node;
       node->next = node->prev = nullptr;
@@ -50,9 +49,9 @@ template <typename T, LinkedListNode<T> NodeData=T*> struct AtomicLinkedList {
     return node;
   }
 
+  /** Unlinks @p node.  Owner thread only. */
   void remove(T *node)
   {
-    std::lock_guard guard(mutex);
     if (node->prev) {
       node->prev->next = node->next;
     }
@@ -66,5 +65,37 @@ template <typename T, LinkedListNode<T> NodeData=T*> struct AtomicLinkedList {
       last = node->prev;
     }
   }
+
+  /** Queues @p node for removal by the owner.  Safe from any thread, lock-free. */
+  void pushRemote(T *node)
+  {
+    T *head = remote.load(std::memory_order_relaxed);
+
+    do {
+      T::remoteNext(node) = head;
+    } while (!remote.compare_exchange_weak(
+        head, node, std::memory_order_seq_cst, std::memory_order_relaxed));
+  }
+
+  bool hasRemote() const
+  {
+    return remote.load(std::memory_order_relaxed) != nullptr;
+  }
+
+  /**
+   * Unlinks every node queued with pushRemote and hands it to @p cb.
+   * Owner thread only.
+   */
+  template <typename Callback> void drainRemote(Callback cb)
+  {
+    T *node = remote.exchange(nullptr, std::memory_order_seq_cst);
+
+    while (node) {
+      T *next = T::remoteNext(node);
+      remove(node);
+      cb(node);
+      node = next;
+    }
+  }
 };
 } // namespace litestl::util
@@ -1,13 +1,15 @@
 #pragma once
 
 #include "alloc.h"
+#include "allocator.h"
 #include "compiler_util.h"
 #include <cmath>
 #include <cstdint>
 #include <algorithm>
 
 namespace litestl::util {
-template <int static_size = 32> class BoolVector {
+template <int static_size = 32, alloc::AllocatorPolicy Allocator = alloc::TaggedAllocator>
+class BoolVector {
   using BlockInt = uint32_t;
   static constexpr int block_size = 32;
   static constexpr int block_shift = 4;
@@ -15,18 +17,19 @@ template <int static_size = 32> class BoolVector {
   static constexpr int block_bytes = 4;
 
 public:
+  using allocator_type = Allocator;
+
   BoolVector()
   {
-    vector_ = static_storage_;
-    size_ = static_size;
-    vector_size_ = std::max(static_size >> block_shift, 1);
+    init_static();
+  }
 
-    for (int i = 0; i < vector_size_; i++) {
-      vector_[i] = 0;
-    }
+  explicit BoolVector(const Allocator &allocator) : allocator_(allocator)
+  {
+    init_static();
   }
 
-  BoolVector(const BoolVector &b)
+  BoolVector(const BoolVector &b) : allocator_(b.allocator_)
   {
     vector_ = static_storage_;
     size_ = static_size;
@@ -40,7 +43,7 @@ public:
     }
   }
 
-  BoolVector(BoolVector &&b)
+  BoolVector(BoolVector &&b) : allocator_(b.allocator_)
   {
     vector_size_ = b.vector_size_;
     size_ = b.size_;
@@ -75,7 +78,7 @@ public:
   ~BoolVector()
   {
     if (vector_ && vector_ != static_storage_) {
-      alloc::release(static_cast<void *>(vector_));
+      allocator_.deallocate(static_cast<void *>(vector_));
     }
   }
 
@@ -134,29 +137,44 @@ private:
   BlockInt static_storage_[static_size >> block_shift];
   int size_ = 0, vector_size_ = 0;
   int used_ = 0;
+  no_unique_addr Allocator allocator_;
+
+  void init_static()
+  {
+    vector_ = static_storage_;
+    size_ = static_size;
+    vector_size_ = std::max(static_size >> block_shift, 1);
+
+    for (int i = 0; i < vector_size_; i++) {
+      vector_[i] = 0;
+    }
+  }
 
   void realloc(int new_vec_size)
   {
     new_vec_size = std::max(new_vec_size, 1);
     BlockInt *old = vector_;
+    int i = 0;
 
-    vector_ = static_cast<BlockInt *>(
-        alloc::alloc("BitVector data", sizeof(BlockInt) * new_vec_size));
+    if (old && old != static_storage_) {
+      vector_ = alloc::reallocate_array<BlockInt>(allocator_, "BitVector data", old,
+                                                  vector_size_, new_vec_size);
+      i = std::min(vector_size_, new_vec_size);
+    } else {
+      vector_ =
+          alloc::allocate_array<BlockInt>(allocator_, "BitVector data", new_vec_size);
 
-    int i = 0;
-    for (i = 0; i < vector_size_; i++) {
-      vector_[i] = old[i];
+      for (; i < std::min(vector_size_, new_vec_size); i++) {
+        vector_[i] = old[i];
+      }
     }
+
     for (; i < new_vec_size; i++) {
       vector_[i] = 0;
     }
 
     vector_size_ = new_vec_size;
     size_ = new_vec_size << block_shift;
-
-    if (old != static_storage_) {
-      alloc::release(static_cast<void *>(old));
-    }
   }
 };
 } // namespace litestl::util
@@ -13,11 +13,12 @@ using uint = unsigned int;
 #include "type_tags.h"
 
 /**
- * Computes an 8-byte-aligned size.  Used by litestl containers.
+ * Computes container alignment: at least 8 bytes, more for over-aligned
+ * element types.  Used by litestl containers.
  */
 template <typename T> static consteval size_t ContainerAlign()
 {
-  return sizeof(T) < 8 ? sizeof(void *) : 8;
+  return alignof(T) > 8 ? alignof(T) : 8;
 }
 
 #define DEFAULT_MOVE_ASSIGNMENT(Type)                                                    \
@@ -78,6 +79,26 @@ static inline const void *pointer_offset(const void *ptr, int n)
 #define force_inline [[clang::always_inline]]
 #endif
 
+/** Lets empty members (e.g. stateless allocator policies) take up no space. */
+#if defined(_MSC_VER) && !defined(__clang__)
+#define no_unique_addr [[msvc::no_unique_address]]
+#else
+#define no_unique_addr [[no_unique_address]]
+#endif
+
+/** Hints that the cache line at @p addr will be read soon.  Never faults. */
+#if defined(_MSC_VER) && !defined(__clang__)
+#if defined(_M_X64) || defined(_M_IX86)
+#include <xmmintrin.h>
+#define prefetch_read(addr)                                                              \
+  _mm_prefetch(reinterpret_cast<const char *>(addr), _MM_HINT_T0)
+#else
+#define prefetch_read(addr) ((void)(addr))
+#endif
+#else
+#define prefetch_read(addr) __builtin_prefetch((addr), 0, 3)
+#endif
+
 // TODO: remove this, this is duplicative with MAKE_FLAGS_CLASS. 
 // It's less intrusive but also less effective, there
 // are some operator cases it doesn't support.
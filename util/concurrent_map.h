@@ -0,0 +1,421 @@
+#pragma once
+
+#include "alloc.h"
+#include "allocator.h"
+#include "compiler_util.h"
+#include "hash_table.h"
+#include "map.h"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <shared_mutex>
+#include <thread>
+#include <utility>
+
+namespace litestl::util {
+namespace detail::concurrent_map {
+/**
+ * Reader-writer spin lock in one word: a writer bit and a reader count.
+ * Shard locks are held for one table probe, too briefly to be worth
+ * std::shared_mutex's bookkeeping.  A writer sets its bit first, which turns
+ * new readers away, and then waits for the readers inside to leave.  Waiters
+ * yield, so the threads holding the lock get to run when cores are
+ * oversubscribed.
+ */
+class SharedSpinLock {
+  static constexpr uint32_t writer = 1u << 31;
+
+public:
+  void lock()
+  {
+    while (state_.fetch_or(writer, std::memory_order_acquire) & writer) {
+      wait_for_writer();
+    }
+    while (state_.load(std::memory_order_acquire) != writer) {
+      std::this_thread::yield();
+    }
+  }
+
+  void unlock()
+  {
+    /* Keeps the count of readers that are about to back off again. */
+    state_.fetch_and(~writer, std::memory_order_release);
+  }
+
+  void lock_shared()
+  {
+    /* One atomic add when there is no writer, undone when there is. */
+    while (state_.fetch_add(1, std::memory_order_acquire) & writer) {
+      state_.fetch_sub(1, std::memory_order_relaxed);
+      wait_for_writer();
+    }
+  }
+
+  void unlock_shared()
+  {
+    state_.fetch_sub(1, std::memory_order_release);
+  }
+
+private:
+  void wait_for_writer() const
+  {
+    while (state_.load(std::memory_order_relaxed) & writer) {
+      std::this_thread::yield();
+    }
+  }
+
+  std::atomic<uint32_t> state_ = {0};
+};
+} // namespace detail::concurrent_map
+
+/**
+ * Hash map that many threads can use at once.
+ *
+ * Keys are split over 2^@p shard_bits shards by the top bits of their hash.
+ * Each shard is an ordinary open-addressing table (see detail::HashTable)
+ * behind its own reader-writer spin lock, so lookups of different keys rarely
+ * wait on each other and lookups of the same shard only share it.  A shard
+ * that fills up grows under its own lock while the others stay usable.
+ *
+ *   ConcurrentMap<int, int> counts;
+ *   task::parallel_for(IndexRange(items.size()), [&](IndexRange range) {
+ *     for (int i : range) {
+ *       counts.add_callback(
+ *           items[i].id, []() { return 1; }, [](int &count) { count++; });
+ *     }
+ *   });
+ *
+ * Nothing hands out references to values, which another thread could
+ * remove or move while they are in use: lookup() copies the value out, and
+ * lookup_callback(), modify() and add_callback() run a callback on it under
+ * the shard's lock.  Callbacks must not use the map themselves.
+ *
+ * shard() locks one shard for iteration, so a parallel_for over
+ * IndexRange(shard_count) visits everything:
+ *
+ *   for (const auto &pair : counts.shard(i)) {
+ *     use(pair.key, pair.value);
+ *   }
+ *
+ * Iterating while other threads modify the map sees each shard as it was at
+ * some point, but not all shards at the same point.
+ */
+template <typename Key,
+          typename Value,
+          int shard_bits = 6,
+          alloc::AllocatorPolicy Allocator = alloc::TaggedAllocator>
+class ConcurrentMap {
+  static_assert(shard_bits >= 1 && shard_bits <= 16, "2 to 65536 shards");
+
+  using Pair = detail::map::Pair<Key, Value>;
+  using Table = detail::HashTable<Key, Pair, detail::hash_table::group_width, Allocator>;
+
+  /* On its own cache line, so that threads on neighbouring shards don't share. */
+  struct alignas(64) Shard {
+    explicit Shard(const Allocator &allocator) : table(allocator)
+    {
+    }
+
+    mutable detail::concurrent_map::SharedSpinLock mutex;
+    Table table;
+  };
+
+public:
+  using key_type = Key;
+  using value_type = Value;
+  using allocator_type = Allocator;
+
+  static constexpr int shard_count = 1 << shard_bits;
+
+  /** One shard, locked for reading while this object lives. */
+  class LockedShard {
+  public:
+    struct iterator {
+      iterator(const Table *table, IndexInt i) : table_(table), i_(table->next_full(i))
+      {
+      }
+
+      bool operator==(const iterator &b) const
+      {
+        return b.i_ == i_;
+      }
+      bool operator!=(const iterator &b) const
+      {
+        return !operator==(b);
+      }
+
+      const Pair &operator*() const
+      {
+        return table_->slot(i_);
+      }
+
+      iterator &operator++()
+      {
+        i_ = table_->next_full(i_ + 1);
+        return *this;
+      }
+
+    private:
+      const Table *table_;
+      IndexInt i_;
+    };
+
+    explicit LockedShard(const Shard &shard) : shard_(&shard), lock_(shard.mutex)
+    {
+    }
+
+    iterator begin() const
+    {
+      return iterator(&shard_->table, 0);
+    }
+
+    iterator end() const
+    {
+      return iterator(&shard_->table, IndexInt(shard_->table.capacity()));
+    }
+
+    size_t size() const
+    {
+      return shard_->table.size();
+    }
+
+  private:
+    const Shard *shard_;
+    std::shared_lock<detail::concurrent_map::SharedSpinLock> lock_;
+  };
+
+  ConcurrentMap() : ConcurrentMap(Allocator())
+  {
+  }
+
+  explicit ConcurrentMap(const Allocator &allocator) : allocator_(allocator)
+  {
+    shards_ = alloc::allocate_array<Shard>(
+        allocator_, "ConcurrentMap shards", shard_count);
+    for (int i = 0; i < shard_count; i++) {
+      new (static_cast<void *>(&shards_[i])) Shard(allocator_);
+    }
+  }
+
+  ConcurrentMap(const ConcurrentMap &) = delete;
+  ConcurrentMap &operator=(const ConcurrentMap &) = delete;
+
+  ~ConcurrentMap()
+  {
+    for (int i = 0; i < shard_count; i++) {
+      shards_[i].~Shard();
+    }
+    allocator_.deallocate(static_cast<void *>(shards_));
+  }
+
+  const Allocator &get_allocator() const
+  {
+    return allocator_;
+  }
+
+  /**
+   * Inserts @p key and @p value if @p key is not already present. Returns true
+   * if inserted, false if the key already existed (value is not overwritten).
+   */
+  bool add(const Key &key, const Value &value)
+  {
+    return add_intern<false>(key, value);
+  }
+
+  /**
+   * Inserts or overwrites. Returns true if @p key was new, false if an
+   * existing value was overwritten.
+   */
+  bool add_overwrite(const Key &key, const Value &value)
+  {
+    return add_intern<true>(key, value);
+  }
+
+  /**
+   * Inserts @p key with the value returned by @p set_value if it is absent,
+   * otherwise calls @p modify with a reference to the existing value; either
+   * way atomically with respect to other threads.  Returns true if inserted.
+   */
+  template <typename ValueSetFunc, typename ValueModifyFunc>
+  bool add_callback(const Key &key, ValueSetFunc set_value, ValueModifyFunc modify)
+  {
+    const hash::HashInt h = Table::hash_key(key);
+    Shard &shard = shard_of(h);
+    std::unique_lock lock(shard.mutex);
+
+    auto [i, found] = shard.table.find_or_prepare_insert(key, h);
+    if (found) {
+      modify(shard.table.slot(i).value);
+      return false;
+    }
+
+    construct(shard.table.slot(i), key, set_value());
+    return true;
+  }
+
+  /** Returns true if @p key is present in the map. */
+  bool contains(const Key &key) const
+  {
+    const hash::HashInt h = Table::hash_key(key);
+    const Shard &shard = shard_of(h);
+    std::shared_lock lock(shard.mutex);
+
+    return shard.table.find(key, h) != -1;
+  }
+
+  /**
+   * Copies the value for @p key into @p r_value, if @p key is present.
+   * Returns true if it was.
+   */
+  bool lookup(const Key &key, Value *r_value) const
+  {
+    return lookup_callback(key, [&](const Value &value) { *r_value = value; });
+  }
+
+  /**
+   * Calls @p fn with the value for @p key, if present, while other threads can
+   * only read the shard.  Returns true if @p key was found.
+   */
+  template <typename Fn> bool lookup_callback(const Key &key, Fn fn) const
+  {
+    const hash::HashInt h = Table::hash_key(key);
+    const Shard &shard = shard_of(h);
+    std::shared_lock lock(shard.mutex);
+
+    const IndexInt i = shard.table.find(key, h);
+    if (i == -1) {
+      return false;
+    }
+
+    fn(shard.table.slot(i).value);
+    return true;
+  }
+
+  /**
+   * Calls @p fn with a mutable reference to the value for @p key, if present,
+   * with the shard locked.  Returns true if @p key was found.
+   */
+  template <typename Fn> bool modify(const Key &key, Fn fn)
+  {
+    const hash::HashInt h = Table::hash_key(key);
+    Shard &shard = shard_of(h);
+    std::unique_lock lock(shard.mutex);
+
+    const IndexInt i = shard.table.find(key, h);
+    if (i == -1) {
+      return false;
+    }
+
+    fn(shard.table.slot(i).value);
+    return true;
+  }
+
+  /**
+   * Removes @p key from the map. If @p out_value is non-null, the removed
+   * value is moved into it. Returns true if the key was found and removed.
+   */
+  bool remove(const Key &key, Value *out_value = nullptr)
+  {
+    const hash::HashInt h = Table::hash_key(key);
+    Shard &shard = shard_of(h);
+    std::unique_lock lock(shard.mutex);
+
+    const IndexInt i = shard.table.find(key, h);
+    if (i == -1) {
+      return false;
+    }
+
+    if (out_value) {
+      *out_value = std::move(shard.table.slot(i).value);
+    }
+
+    shard.table.erase(i);
+    return true;
+  }
+
+  /**
+   * Returns the number of entries.  Shards are counted one after another, so
+   * with concurrent changes this is only a snapshot of each shard.
+   */
+  size_t size() const
+  {
+    size_t size = 0;
+    for (int i = 0; i < shard_count; i++) {
+      std::shared_lock lock(shards_[i].mutex);
+      size += shards_[i].table.size();
+    }
+    return size;
+  }
+
+  /**
+   * Pre-allocates room for @p size entries, assuming the keys spread evenly
+   * over the shards.
+   */
+  void reserve(size_t size)
+  {
+    /* A little slack for the shards that get more than their share. */
+    const size_t per_shard = size / shard_count + size / shard_count / 8 + 1;
+
+    for (int i = 0; i < shard_count; i++) {
+      std::unique_lock lock(shards_[i].mutex);
+      shards_[i].table.reserve(per_shard);
+    }
+  }
+
+  /** Removes all entries, one shard at a time. */
+  void clear()
+  {
+    for (int i = 0; i < shard_count; i++) {
+      std::unique_lock lock(shards_[i].mutex);
+      shards_[i].table.clear();
+    }
+  }
+
+  /** Locks shard @p i for reading and returns a range over its entries. */
+  LockedShard shard(int i) const
+  {
+    return LockedShard(shards_[i]);
+  }
+
+private:
+  Shard &shard_of(hash::HashInt h)
+  {
+    return shards_[h >> (64 - shard_bits)];
+  }
+
+  const Shard &shard_of(hash::HashInt h) const
+  {
+    return shards_[h >> (64 - shard_bits)];
+  }
+
+  template <bool overwrite> bool add_intern(const Key &key, const Value &value)
+  {
+    const hash::HashInt h = Table::hash_key(key);
+    Shard &shard = shard_of(h);
+    std::unique_lock lock(shard.mutex);
+
+    auto [i, found] = shard.table.find_or_prepare_insert(key, h);
+    if (found) {
+      if constexpr (overwrite) {
+        shard.table.slot(i).value = value;
+      }
+      return false;
+    }
+
+    construct(shard.table.slot(i), key, value);
+    return true;
+  }
+
+  template <typename ValueArg>
+  static void construct(Pair &pair, const Key &key, ValueArg &&value)
+  {
+    new (static_cast<void *>(&pair.key)) Key(key);
+    new (static_cast<void *>(&pair.value)) Value(std::forward<ValueArg>(value));
+  }
+
+  Shard *shards_;
+  no_unique_addr Allocator allocator_;
+};
+} // namespace litestl::util
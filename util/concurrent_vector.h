@@ -0,0 +1,240 @@
+#pragma once
+
+#include "alloc.h"
+#include "allocator.h"
+#include "compiler_util.h"
+#include "vector.h"
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <utility>
+
+namespace litestl::util {
+/**
+ * Append-only array that many threads can grow at once.
+ *
+ * grow_by and push_back claim indices with a single atomic add and never
+ * move existing elements, so a parallel_for can write its results straight
+ * into one shared vector:
+ *
+ *   ConcurrentVector<Hit> hits;
+ *   task::parallel_for(IndexRange(rays.size()), [&](IndexRange range) {
+ *     for (int i : range) {
+ *       if (intersect(rays[i])) {
+ *         hits.push_back(Hit(i));
+ *       }
+ *     }
+ *   });
+ *   Vector<Hit> result = hits.finalize();
+ *
+ * Storage is a table of segments, each twice the size of the one before, so
+ * there are O(log n) of them and indexing stays O(1).  Segments are allocated
+ * lock-free by whichever thread first needs them.
+ *
+ * An element may be read by other threads once its writer has published the
+ * index (through an atomic, a join, ...).  size() counts claimed slots,
+ * including ones still being constructed.  clear and finalize must not run
+ * concurrently with anything else.
+ *
+ * Segments come from @p Allocator on whichever thread adds them, so the
+ * policy must be thread safe (alloc::ArenaAllocator is not).
+ */
+template <typename T, alloc::AllocatorPolicy Allocator = alloc::TaggedAllocator>
+class ConcurrentVector {
+  static constexpr int first_shift = 6;
+  static constexpr size_t first_size = size_t(1) << first_shift;
+  static constexpr int max_segments = int(sizeof(size_t) * 8) - first_shift;
+
+public:
+  using value_type = T;
+  using allocator_type = Allocator;
+
+  ConcurrentVector() : ConcurrentVector(Allocator())
+  {
+  }
+
+  explicit ConcurrentVector(const Allocator &allocator) : allocator_(allocator)
+  {
+    for (std::atomic<T *> &segment : segments_) {
+      segment.store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  ConcurrentVector(const ConcurrentVector &) = delete;
+  ConcurrentVector &operator=(const ConcurrentVector &) = delete;
+
+  ~ConcurrentVector()
+  {
+    clear();
+  }
+
+  /**
+   * Appends @p count value-initialized elements and returns the index of the
+   * first.  They are contiguous in index space, not necessarily in memory.
+   */
+  size_t grow_by(size_t count)
+  {
+    const size_t start = size_.fetch_add(count, std::memory_order_relaxed);
+
+    if (count) {
+      ensure_segments(start, start + count);
+      for (size_t i = start; i < start + count; i++) {
+        new (static_cast<void *>(slot(i))) T();
+      }
+    }
+
+    return start;
+  }
+
+  /** Appends an element constructed from @p args and returns its index. */
+  template <typename... Args> size_t emplace_back(Args &&...args)
+  {
+    const size_t index = size_.fetch_add(1, std::memory_order_relaxed);
+
+    ensure_segments(index, index + 1);
+    new (static_cast<void *>(slot(index))) T(std::forward<Args>(args)...);
+    return index;
+  }
+
+  size_t push_back(const T &value)
+  {
+    return emplace_back(value);
+  }
+
+  size_t push_back(T &&value)
+  {
+    return emplace_back(std::move(value));
+  }
+
+  T &operator[](size_t idx)
+  {
+    return *slot(idx);
+  }
+
+  const T &operator[](size_t idx) const
+  {
+    return *slot(idx);
+  }
+
+  size_t size() const
+  {
+    return size_.load(std::memory_order_acquire);
+  }
+
+  const Allocator &get_allocator() const
+  {
+    return allocator_;
+  }
+
+  /**
+   * Moves all elements into a contiguous Vector, with one allocation and a
+   * bulk copy per segment for simple types, and leaves this vector empty.
+   * The result allocates with the same policy.
+   */
+  Vector<T, VectorDefaultStaticSize, Allocator> finalize()
+  {
+    const size_t count = size();
+    Vector<T, VectorDefaultStaticSize, Allocator> result(allocator_);
+
+    result.template resize<false>(count);
+    T *dst = result.data();
+
+    for (int k = 0; k < max_segments && segment_start(k) < count; k++) {
+      T *segment = segments_[k].load(std::memory_order_relaxed);
+      const size_t length = std::min(segment_size(k), count - segment_start(k));
+
+      if constexpr (is_simple<T>()) {
+        memcpy(static_cast<void *>(dst),
+               static_cast<void *>(segment),
+               sizeof(T) * length);
+      } else {
+        for (size_t i = 0; i < length; i++) {
+          new (static_cast<void *>(dst + i)) T(std::move(segment[i]));
+        }
+      }
+      dst += length;
+    }
+
+    clear();
+    return result;
+  }
+
+  /** Destroys all elements and frees the segments. */
+  void clear()
+  {
+    const size_t count = size_.load(std::memory_order_relaxed);
+
+    for (int k = 0; k < max_segments; k++) {
+      T *segment = segments_[k].load(std::memory_order_relaxed);
+      if (!segment) {
+        continue;
+      }
+
+      if constexpr (!is_simple<T>()) {
+        const size_t start = segment_start(k);
+        for (size_t i = 0; start + i < count && i < segment_size(k); i++) {
+          segment[i].~T();
+        }
+      }
+
+      allocator_.deallocate(static_cast<void *>(segment));
+      segments_[k].store(nullptr, std::memory_order_relaxed);
+    }
+
+    size_.store(0, std::memory_order_relaxed);
+  }
+
+private:
+  /* Segment k holds first_size << k elements, starting at first_size * (2^k - 1). */
+  static int segment_of(size_t idx)
+  {
+    return int(std::bit_width((idx >> first_shift) + 1)) - 1;
+  }
+
+  static size_t segment_start(int k)
+  {
+    return ((size_t(1) << k) - 1) << first_shift;
+  }
+
+  static size_t segment_size(int k)
+  {
+    return first_size << k;
+  }
+
+  flatten_inline T *slot(size_t idx) const
+  {
+    const int k = segment_of(idx);
+    return segments_[k].load(std::memory_order_acquire) + (idx - segment_start(k));
+  }
+
+  /** Allocates the segments covering [start, end) that don't exist yet. */
+  void ensure_segments(size_t start, size_t end)
+  {
+    for (int k = segment_of(start), last = segment_of(end - 1); k <= last; k++) {
+      if (!segments_[k].load(std::memory_order_acquire)) [[unlikely]] {
+        add_segment(k);
+      }
+    }
+  }
+
+  [[gnu::noinline]] void add_segment(int k)
+  {
+    T *segment = alloc::allocate_array<T>(
+        allocator_, "ConcurrentVector segment", segment_size(k));
+    T *expected = nullptr;
+
+    /* Another thread may have won the race, then ours goes back. */
+    if (!segments_[k].compare_exchange_strong(
+            expected, segment, std::memory_order_acq_rel)) {
+      allocator_.deallocate(static_cast<void *>(segment));
+    }
+  }
+
+  std::atomic<size_t> size_ = {0};
+  std::atomic<T *> segments_[max_segments];
+  no_unique_addr Allocator allocator_;
+};
+} // namespace litestl::util
@@ -3,49 +3,237 @@
 #include "compiler_util.h"
 #include "string.h"
 
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+/*
+ * Hash functions for hash tables.
+ *
+ *   hash::hash(42);                       // integers, enums, floats, pointers
+ *   hash::hash(stringref("name"));        // strings, by content
+ *   hash::hash_bytes(data, size);         // raw memory
+ *   hash::hash_combine(hash::hash(a), hash::hash(b));
+ *
+ * Strings and memory use a wyhash-style function: 16 bytes per 64x64->128 bit
+ * multiply, so short keys cost a few multiplies and long ones run at several
+ * GB/s.  Integers and pointers go through one such multiply, which spreads
+ * every input bit over the whole result, so masking off low bits is safe.
+ * All string types hash their characters without the terminator, so
+ * `const char *`, stringref and string give the same hash for the same text.
+ *
+ * Overloads for other types go next to the type, in its namespace, and are
+ * found by hash_of() (which hash tables call) through argument-dependent
+ * lookup; math/vector.h and math/matrix.h have some.  is_transparent says
+ * which other types can search a table without becoming its key type first.
+ * NOT cryptographically secure, and not stable across versions: don't store
+ * hashes.
+ */
 namespace litestl::hash {
 using HashInt = uint64_t;
 
-template <typename T> inline HashInt hash(T *ptr)
-{
-  HashInt h = reinterpret_cast<HashInt>(ptr);
+namespace detail {
+static constexpr uint64_t secret[4] = {0x2d358dccaa6c78a5ull,
+                                       0x8bb84b93962eacc9ull,
+                                       0x4b33a62ed433d4a3ull,
+                                       0x4d5a2da51de1aa47ull};
 
-  /* Pointers only use the bottom 48 bits. */
-  if constexpr (sizeof(void *) == 8) {
-#if 0 // Paranoia check: add final 16 bits to front
-    return (h << 16) | (h >> 48);
+/** Full 128 bit product of @p a and @p b, low half in @p a and high half in @p b. */
+inline void multiply(uint64_t &a, uint64_t &b)
+{
+#if defined(__SIZEOF_INT128__)
+  const __uint128_t r = __uint128_t(a) * b;
+  a = uint64_t(r);
+  b = uint64_t(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+  a = _umul128(a, b, &b);
 #else
-    return h << 16;
+  const uint64_t ha = a >> 32, hb = b >> 32, la = uint32_t(a), lb = uint32_t(b);
+  const uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+  const uint64_t t = rl + (rm0 << 32);
+  uint64_t c = t < rl;
+  const uint64_t lo = t + (rm1 << 32);
+  c += lo < t;
+  a = lo;
+  b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
 #endif
+}
+
+/** Folds the 128 bit product of @p a and @p b to 64 bits. */
+inline uint64_t mum(uint64_t a, uint64_t b)
+{
+  multiply(a, b);
+  return a ^ b;
+}
+
+inline uint64_t read64(const uint8_t *p)
+{
+  uint64_t v;
+  memcpy(&v, p, 8);
+  return v;
+}
+
+inline uint64_t read32(const uint8_t *p)
+{
+  uint32_t v;
+  memcpy(&v, p, 4);
+  return v;
+}
+
+/** One to three bytes, each read once or more. */
+inline uint64_t read_small(const uint8_t *p, size_t size)
+{
+  return (uint64_t(p[0]) << 16) | (uint64_t(p[size >> 1]) << 8) | p[size - 1];
+}
+} // namespace detail
+
+/** Hashes @p size bytes at @p data. */
+inline HashInt hash_bytes(const void *data, size_t size, HashInt seed = 0)
+{
+  using namespace detail;
+
+  const uint8_t *p = static_cast<const uint8_t *>(data);
+  seed ^= mum(seed ^ secret[0], secret[1]);
+  uint64_t a, b;
+
+  if (size <= 16) [[likely]] {
+    if (size >= 4) {
+      /* Two overlapping pairs of 4 byte reads cover 4 to 16 bytes. */
+      const size_t mid = (size >> 3) << 2;
+      a = (read32(p) << 32) | read32(p + mid);
+      b = (read32(p + size - 4) << 32) | read32(p + size - 4 - mid);
+    } else if (size > 0) {
+      a = read_small(p, size);
+      b = 0;
+    } else {
+      a = b = 0;
+    }
   } else {
-    return h;
+    size_t i = size;
+
+    if (i > 48) [[unlikely]] {
+      /* Three independent lanes keep the multipliers busy. */
+      uint64_t seed1 = seed, seed2 = seed;
+      do {
+        seed = mum(read64(p) ^ secret[1], read64(p + 8) ^ seed);
+        seed1 = mum(read64(p + 16) ^ secret[2], read64(p + 24) ^ seed1);
+        seed2 = mum(read64(p + 32) ^ secret[3], read64(p + 40) ^ seed2);
+        p += 48;
+        i -= 48;
+      } while (i > 48);
+      seed ^= seed1 ^ seed2;
+    }
+
+    while (i > 16) {
+      seed = mum(read64(p) ^ secret[1], read64(p + 8) ^ seed);
+      i -= 16;
+      p += 16;
+    }
+
+    /* The last 16 bytes, overlapping what came before. */
+    a = read64(p + i - 16);
+    b = read64(p + i - 8);
   }
+
+  a ^= secret[1];
+  b ^= seed;
+  multiply(a, b);
+  return mum(a ^ secret[0] ^ size, b ^ secret[1]);
 }
 
-inline HashInt hash(int i)
+/** Mixes all bits of @p value into all bits of the result. */
+inline HashInt mix(uint64_t value)
 {
-  return HashInt(i);
+  /* Squaring-like (value on both sides) spreads structured keys better than
+   * multiplying by a constant, for the same single multiply. */
+  return detail::mum(value ^ detail::secret[0], value ^ detail::secret[1]);
 }
 
-/** NOT cryptographically secure! */
-inline HashInt hash(const char *str)
+/** Hash of a sequence: the hash so far, combined with the next element's. */
+inline HashInt hash_combine(HashInt seed, HashInt value)
 {
-  const char *c = str;
-  HashInt h = 0;
+  return detail::mum(seed ^ detail::secret[2], value ^ detail::secret[3]);
+}
 
-  /* TODO: check this. */
-  for (; *c; c++) {
-    h = ((h + *c) * (*c) + 23423432) & ((1 << 19) - 1);
+template <typename T>
+  requires std::is_integral_v<T> || std::is_enum_v<T>
+inline HashInt hash(T value)
+{
+  if constexpr (std::is_enum_v<T>) {
+    return mix(uint64_t(std::underlying_type_t<T>(value)));
+  } else {
+    return mix(uint64_t(value));
   }
+}
+
+/** -0.0 == 0.0, so both hash the same. */
+inline HashInt hash(float value)
+{
+  return mix(value == 0.0f ? 0 : std::bit_cast<uint32_t>(value));
+}
+
+inline HashInt hash(double value)
+{
+  return mix(value == 0.0 ? 0 : std::bit_cast<uint64_t>(value));
+}
+
+template <typename T> inline HashInt hash(T *ptr)
+{
+  return mix(uint64_t(reinterpret_cast<uintptr_t>(ptr)));
+}
 
-  return h;
+/** Hashes the characters of @p str, without the terminator. */
+inline HashInt hash(const char *str)
+{
+  return hash_bytes(str, strlen(str));
 }
-inline HashInt hash(const util::string &str)
+
+template <typename Char> inline HashInt hash(const util::StringRef<Char> &str)
 {
-  return hash(str.c_str());
+  return hash_bytes(str.c_str(), str.size() * sizeof(Char));
 }
-inline HashInt hash(const util::stringref &str)
+
+template <typename Char, int static_size, alloc::AllocatorPolicy Allocator>
+inline HashInt hash(const util::String<Char, static_size, Allocator> &str)
 {
-  return hash(str.c_str());
+  return hash_bytes(str.c_str(), str.size() * sizeof(Char));
 }
+
+/**
+ * Hash of @p key, including hash() overloads in the namespace of its type.
+ * Hash tables hash their keys through this.
+ */
+template <typename T> inline HashInt hash_of(const T &key)
+{
+  return hash(key);
+}
+
+namespace detail {
+template <typename T> struct is_string_key : std::false_type {};
+template <typename Char> struct is_string_key<util::StringRef<Char>> : std::true_type {};
+template <typename Char, int static_size, alloc::AllocatorPolicy Allocator>
+struct is_string_key<util::String<Char, static_size, Allocator>> : std::true_type {};
+} // namespace detail
+
+/**
+ * Whether hash tables keyed by @p Key can be searched with a @p K as is,
+ * without first converting it to a Key.  Equal values must hash the same
+ * through hash_of(), and `key == k` must compare them.
+ *
+ * Holds for string and stringref keys searched with any string type,
+ * including C strings; specialize it for other pairs of types.
+ */
+template <typename Key, typename K> struct is_transparent : std::false_type {};
+
+template <typename Key, typename K>
+  requires detail::is_string_key<Key>::value &&
+           (detail::is_string_key<K>::value || std::is_same_v<K, const char *> ||
+            std::is_same_v<K, char *>)
+struct is_transparent<Key, K> : std::true_type {};
 } // namespace litestl::hash
@@ -0,0 +1,516 @@
+#pragma once
+
+#include "allocator.h"
+#include "compiler_util.h"
+#include "hash.h"
+#include "index_range.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LITESTL_HASH_TABLE_SSE2
+#endif
+
+/*
+ * Open-addressing hash table engine behind Map and Set, after Abseil's Swiss
+ * tables.
+ *
+ * Every slot has one control byte: empty, deleted (a tombstone), or full and
+ * holding the low 7 bits of the key's hash (H2).  Slots come in groups of 16
+ * whose control bytes are checked against H2 with one SSE2 compare, so a
+ * lookup reads a group's control bytes and then only the slots whose H2
+ * matches, about one in 128 of the others.  The rest of the hash (H1) picks the
+ * first group.  Tables are a power of two groups and probe 1, 2, 3, ... groups
+ * further at each step, which visits every group.  A lookup ends at the first
+ * group with an empty slot.
+ *
+ * Tables grow when more than 7/8 of the slots are full or deleted.  Erasing
+ * from a group that still has an empty slot leaves no tombstone, since no
+ * probe can have gone past that group.
+ */
+namespace litestl::util::detail {
+namespace hash_table {
+using Ctrl = int8_t;
+
+static constexpr Ctrl ctrl_empty = -128;
+static constexpr Ctrl ctrl_deleted = -2;
+static constexpr size_t group_width = 16;
+
+/** Spreads a key's hash over all bits, in case a key type's hash() overload is weak. */
+inline hash::HashInt mix(hash::HashInt h)
+{
+  h *= 0x9E3779B97F4A7C15ull;
+  return h ^ (h >> 32);
+}
+
+/** The control bytes of one group, bit i of the masks is slot i. */
+class Group {
+public:
+  explicit Group(const Ctrl *ctrl)
+  {
+#ifdef LITESTL_HASH_TABLE_SSE2
+    ctrl_ = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrl));
+#else
+    memcpy(ctrl_, ctrl, group_width);
+#endif
+  }
+
+  uint32_t match(Ctrl h2) const
+  {
+#ifdef LITESTL_HASH_TABLE_SSE2
+    return uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl_, _mm_set1_epi8(h2))));
+#else
+    uint32_t bits = 0;
+    for (size_t i = 0; i < group_width; i++) {
+      bits |= uint32_t(ctrl_[i] == h2) << i;
+    }
+    return bits;
+#endif
+  }
+
+  uint32_t match_empty() const
+  {
+    return match(ctrl_empty);
+  }
+
+  /** Empty or deleted slots, the ones with the sign bit set. */
+  uint32_t match_free() const
+  {
+#ifdef LITESTL_HASH_TABLE_SSE2
+    return uint32_t(_mm_movemask_epi8(ctrl_));
+#else
+    uint32_t bits = 0;
+    for (size_t i = 0; i < group_width; i++) {
+      bits |= uint32_t(ctrl_[i] < 0) << i;
+    }
+    return bits;
+#endif
+  }
+
+private:
+#ifdef LITESTL_HASH_TABLE_SSE2
+  __m128i ctrl_;
+#else
+  Ctrl ctrl_[group_width];
+#endif
+};
+
+/** Smallest table that holds @p size elements, at least @p min_capacity slots. */
+constexpr size_t capacity_for(size_t size, size_t min_capacity)
+{
+  return std::max(std::bit_ceil(size + size / 7 + 1), min_capacity);
+}
+
+constexpr size_t max_load(size_t capacity)
+{
+  return capacity - capacity / 8;
+}
+
+/** A type other than @p Key that can search tables of it, see hash::is_transparent. */
+template <typename K, typename Key>
+concept TransparentKey = !std::is_same_v<std::decay_t<K>, Key> &&
+                         hash::is_transparent<Key, std::decay_t<K>>::value;
+
+/**
+ * What a table is searched with for @p key: C strings and character arrays
+ * become stringrefs, so their length is taken once and not at every compare.
+ */
+template <typename K> decltype(auto) lookup_key(const K &key)
+{
+  using T = std::decay_t<K>;
+
+  if constexpr (std::is_same_v<T, const char *> || std::is_same_v<T, char *>) {
+    return StringRef<char>(key);
+  } else {
+    return key;
+  }
+}
+} // namespace hash_table
+
+/**
+ * Table of @p Slot (a key, or a key-value pair with a `key` member), with
+ * room for @p inline_capacity slots inside the object before it allocates
+ * from @p Allocator.  Callers construct slots in place: insertion claims a
+ * slot and marks it full, and the caller then constructs the element in it.
+ */
+template <typename Key,
+          typename Slot,
+          size_t inline_capacity,
+          alloc::AllocatorPolicy Allocator>
+class HashTable {
+  static_assert(inline_capacity >= hash_table::group_width &&
+                    std::has_single_bit(inline_capacity),
+                "inline capacity must be a power of two of at least one group");
+
+  using Ctrl = hash_table::Ctrl;
+  using Group = hash_table::Group;
+  static constexpr size_t group_width = hash_table::group_width;
+
+public:
+  HashTable()
+  {
+    init_inline();
+  }
+
+  explicit HashTable(const Allocator &allocator) : allocator_(allocator)
+  {
+    init_inline();
+  }
+
+  HashTable(const HashTable &b) : allocator_(b.allocator_)
+  {
+    init_inline();
+    copy_from(b);
+  }
+
+  HashTable(HashTable &&b) noexcept : allocator_(b.allocator_)
+  {
+    if (!b.is_inline()) {
+      slots_ = b.slots_;
+      ctrl_ = b.ctrl_;
+      capacity_ = b.capacity_;
+      size_ = b.size_;
+      growth_left_ = b.growth_left_;
+      b.init_inline();
+      return;
+    }
+
+    /* Same capacity and hashes, so every element keeps its slot. */
+    init_inline();
+    memcpy(ctrl_, b.ctrl_, capacity_);
+    for (size_t i = 0; i < capacity_; i++) {
+      if (is_full(IndexInt(i))) {
+        new (static_cast<void *>(&slots_[i])) Slot(std::move(b.slots_[i]));
+      }
+    }
+    size_ = b.size_;
+    growth_left_ = b.growth_left_;
+    b.clear();
+  }
+
+  ~HashTable()
+  {
+    destroy_slots();
+    if (!is_inline()) {
+      allocator_.deallocate(static_cast<void *>(slots_));
+    }
+  }
+
+  const Allocator &get_allocator() const
+  {
+    return allocator_;
+  }
+
+  static const Key &key_of(const Slot &slot)
+  {
+    if constexpr (std::is_same_v<Key, Slot>) {
+      return slot;
+    } else {
+      return slot.key;
+    }
+  }
+
+  /**
+   * Returns the slot holding @p key, or -1.  @p key is a Key, or another type
+   * that hashes and compares the same (see hash::is_transparent).
+   */
+  template <typename K> IndexInt find(const K &key) const
+  {
+    return find_hashed(key, hash_key(key));
+  }
+
+  /** find() with the hash_key() of @p key, for callers that already have it. */
+  template <typename K> IndexInt find(const K &key, hash::HashInt h) const
+  {
+    return find_hashed(key, h);
+  }
+
+  /**
+   * Returns the slot holding @p key and true, or claims an empty slot for
+   * it and returns that and false.  The caller constructs the new element.
+   */
+  template <typename K> std::pair<IndexInt, bool> find_or_prepare_insert(const K &key)
+  {
+    return find_or_prepare_insert(key, hash_key(key));
+  }
+
+  template <typename K>
+  std::pair<IndexInt, bool> find_or_prepare_insert(const K &key, hash::HashInt h)
+  {
+    const IndexInt i = find_hashed(key, h);
+    if (i != -1) {
+      return {i, true};
+    }
+
+    return {prepare_insert(h), false};
+  }
+
+  /** Claims a slot for @p key without checking whether it is already present. */
+  IndexInt prepare_insert(const Key &key)
+  {
+    return prepare_insert(hash_key(key));
+  }
+
+  /**
+   * The hash the table files @p key under.  Only the low 7 bits and the ones
+   * above them that pick a group are used, so the top bits are free for
+   * callers to split keys over several tables.
+   */
+  template <typename K> static hash::HashInt hash_key(const K &key)
+  {
+    return hash_table::mix(hash::hash_of(key));
+  }
+
+  /** Destroys the element in full slot @p i. */
+  void erase(IndexInt i)
+  {
+    if constexpr (!std::is_trivially_destructible_v<Slot>) {
+      slots_[i].~Slot();
+    }
+
+    const size_t group_start = size_t(i) & ~(group_width - 1);
+    if (Group(ctrl_ + group_start).match_empty()) {
+      ctrl_[i] = hash_table::ctrl_empty;
+      growth_left_++;
+    } else {
+      ctrl_[i] = hash_table::ctrl_deleted;
+    }
+
+    size_--;
+  }
+
+  /** Destroys all elements, keeping the memory. */
+  void clear()
+  {
+    destroy_slots();
+    memset(ctrl_, hash_table::ctrl_empty, capacity_);
+    size_ = 0;
+    growth_left_ = hash_table::max_load(capacity_);
+  }
+
+  /** Makes room for @p size elements without further allocation. */
+  void reserve(size_t size)
+  {
+    const size_t capacity = hash_table::capacity_for(size, inline_capacity);
+    if (capacity > capacity_) {
+      resize(capacity);
+    }
+  }
+
+  bool is_full(IndexInt i) const
+  {
+    return ctrl_[i] >= 0;
+  }
+
+  /** First full slot at or after @p i, or capacity(). */
+  IndexInt next_full(IndexInt i) const
+  {
+    while (size_t(i) < capacity_ && !is_full(i)) {
+      i++;
+    }
+    return i;
+  }
+
+  Slot &slot(IndexInt i)
+  {
+    return slots_[i];
+  }
+
+  const Slot &slot(IndexInt i) const
+  {
+    return slots_[i];
+  }
+
+  size_t size() const
+  {
+    return size_;
+  }
+
+  size_t capacity() const
+  {
+    return capacity_;
+  }
+
+private:
+  template <typename K> IndexInt find_hashed(const K &key, hash::HashInt h) const
+  {
+    const Ctrl h2 = Ctrl(h & 0x7F);
+    const size_t group_mask = capacity_ / group_width - 1;
+    size_t group = size_t(h >> 7) & group_mask;
+
+    for (size_t step = 1;; step++) {
+      const size_t start = group * group_width;
+
+      /* Overlaps the slot's cache miss with the control bytes'. */
+      prefetch_read(&slots_[start]);
+      const Group ctrl(ctrl_ + start);
+
+      for (uint32_t bits = ctrl.match(h2); bits; bits &= bits - 1) {
+        const size_t i = start + size_t(std::countr_zero(bits));
+        if (key_of(slots_[i]) == key) [[likely]] {
+          return IndexInt(i);
+        }
+      }
+
+      if (ctrl.match_empty()) [[likely]] {
+        return -1;
+      }
+
+      group = (group + step) & group_mask;
+    }
+  }
+
+  /** First empty or deleted slot on the probe sequence of hash @p h. */
+  size_t find_free(hash::HashInt h) const
+  {
+    const size_t group_mask = capacity_ / group_width - 1;
+    size_t group = size_t(h >> 7) & group_mask;
+
+    for (size_t step = 1;; step++) {
+      const size_t start = group * group_width;
+
+      if (const uint32_t bits = Group(ctrl_ + start).match_free()) {
+        return start + size_t(std::countr_zero(bits));
+      }
+
+      group = (group + step) & group_mask;
+    }
+  }
+
+  IndexInt prepare_insert(hash::HashInt h)
+  {
+    size_t i = find_free(h);
+
+    /* Tombstones can be reused without growing. */
+    if (growth_left_ == 0 && ctrl_[i] == hash_table::ctrl_empty) [[unlikely]] {
+      grow();
+      i = find_free(h);
+    }
+
+    growth_left_ -= size_t(ctrl_[i] == hash_table::ctrl_empty);
+    ctrl_[i] = Ctrl(h & 0x7F);
+    size_++;
+
+    return IndexInt(i);
+  }
+
+  /** Doubles the table, or rebuilds it at the same size if it is mostly tombstones. */
+  [[gnu::noinline]] void grow()
+  {
+    if (size_ * 2 <= hash_table::max_load(capacity_)) {
+      resize(capacity_);
+    } else {
+      resize(capacity_ * 2);
+    }
+  }
+
+  /** Moves all elements into a new heap table with @p capacity slots. */
+  void resize(size_t capacity)
+  {
+    Slot *old_slots = slots_;
+    Ctrl *old_ctrl = ctrl_;
+    const size_t old_capacity = capacity_;
+    const bool old_inline = is_inline();
+
+    allocate(capacity);
+
+    for (size_t i = 0; i < old_capacity; i++) {
+      if (old_ctrl[i] < 0) {
+        continue;
+      }
+
+      const hash::HashInt h = hash_key(key_of(old_slots[i]));
+      const size_t j = find_free(h);
+
+      ctrl_[j] = Ctrl(h & 0x7F);
+      new (static_cast<void *>(&slots_[j])) Slot(std::move(old_slots[i]));
+
+      if constexpr (!std::is_trivially_destructible_v<Slot>) {
+        old_slots[i].~Slot();
+      }
+    }
+
+    growth_left_ -= size_;
+
+    if (!old_inline) {
+      allocator_.deallocate(static_cast<void *>(old_slots));
+    }
+  }
+
+  /** Points the table at a new, empty heap block; size_ is kept. */
+  void allocate(size_t capacity)
+  {
+    /* Control bytes go after the slots, in the same block. */
+    const size_t ctrl_slots = (capacity + sizeof(Slot) - 1) / sizeof(Slot);
+
+    slots_ = alloc::allocate_array<Slot>(
+        allocator_, "HashTable slots", capacity + ctrl_slots);
+    ctrl_ = reinterpret_cast<Ctrl *>(slots_ + capacity);
+    capacity_ = capacity;
+    growth_left_ = hash_table::max_load(capacity);
+    memset(ctrl_, hash_table::ctrl_empty, capacity);
+  }
+
+  void init_inline()
+  {
+    slots_ = reinterpret_cast<Slot *>(inline_slots_);
+    ctrl_ = inline_ctrl_;
+    capacity_ = inline_capacity;
+    size_ = 0;
+    growth_left_ = hash_table::max_load(inline_capacity);
+    memset(ctrl_, hash_table::ctrl_empty, inline_capacity);
+  }
+
+  bool is_inline() const
+  {
+    return ctrl_ == inline_ctrl_;
+  }
+
+  void copy_from(const HashTable &b)
+  {
+    if (b.capacity_ > capacity_) {
+      allocate(b.capacity_);
+    }
+
+    /* Same capacity and hashes, so every element keeps its slot. */
+    memcpy(ctrl_, b.ctrl_, capacity_);
+    for (size_t i = 0; i < capacity_; i++) {
+      if (is_full(IndexInt(i))) {
+        new (static_cast<void *>(&slots_[i])) Slot(b.slots_[i]);
+      }
+    }
+
+    size_ = b.size_;
+    growth_left_ = b.growth_left_;
+  }
+
+  void destroy_slots()
+  {
+    if constexpr (!std::is_trivially_destructible_v<Slot>) {
+      for (size_t i = 0; i < capacity_; i++) {
+        if (is_full(IndexInt(i))) {
+          slots_[i].~Slot();
+        }
+      }
+    }
+  }
+
+  Slot *slots_;
+  Ctrl *ctrl_;
+  size_t capacity_;
+  size_t size_;
+  /* Empty slots that may still be filled before the table must grow. */
+  size_t growth_left_;
+  alignas(Slot) char inline_slots_[sizeof(Slot) * inline_capacity];
+  Ctrl inline_ctrl_[inline_capacity];
+  no_unique_addr Allocator allocator_;
+};
+} // namespace litestl::util::detail
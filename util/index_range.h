@@ -1,7 +1,17 @@
 #pragma once
+
+#include <cstddef>
+
 namespace litestl::util {
 /**
- * Represents a contiguous range starting from index 0 up to `start + size`.
+ * Signed index type of the containers and of IndexRange.  Pointer sized, so
+ * 64 bit platforms can index past 2^31 elements while 32 bit ones (WASM)
+ * keep 32 bit arithmetic.
+ */
+using IndexInt = std::ptrdiff_t;
+
+/**
+ * Represents the contiguous range of indices [`start`, `start + size`).
  * Primarily useful for iterating over a count of elements.
  *
  * Example:
@@ -13,7 +23,7 @@ namespace litestl::util {
  * @endcode
  */
 struct IndexRange {
-  int start, size;
+  IndexInt start, size;
 
   /** Default constructs an empty range. */
   IndexRange() : start(0), size(0)
@@ -21,18 +31,18 @@ struct IndexRange {
   }
 
   /** Constructs a range of `count` indices starting from 0. */
-  IndexRange(int count) : start(0), size(count)
+  IndexRange(IndexInt count) : start(0), size(count)
   {
   }
 
   /** Constructs a range with the given start offset and size. */
-  IndexRange(int a, int b) : start(a), size(b)
+  IndexRange(IndexInt a, IndexInt b) : start(a), size(b)
   {
   }
 
   /** Forward iterator that yields sequential integer values. */
   struct iterator {
-    iterator(int i) : i_(i)
+    iterator(IndexInt i) : i_(i)
     {
     }
     iterator(const iterator &b) : i_(b.i_)
@@ -48,7 +58,7 @@ struct IndexRange {
       return !operator==(b);
     }
 
-    int operator*() const
+    IndexInt operator*() const
     {
       return i_;
     }
@@ -60,13 +70,13 @@ struct IndexRange {
     }
 
   private:
-    int i_;
+    IndexInt i_;
   };
 
-  /** Returns an iterator to index 0. */
+  /** Returns an iterator to `start`. */
   iterator begin() const
   {
-    return iterator(0);
+    return iterator(start);
   }
 
   /** Returns an iterator past the last index (`start + size`). */
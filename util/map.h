@@ -1,11 +1,11 @@
 #pragma once
 
 #include "alloc.h"
-#include "boolvector.h"
+#include "allocator.h"
 #include "compiler_util.h"
 #include "concepts.h"
 #include "hash.h"
-#include "hashtable_sizes.h"
+#include "hash_table.h"
 
 #include <concepts>
 #include <initializer_list>
@@ -55,8 +55,8 @@ template <typename Key, typename Value> struct Pair {
       return *this;
     }
 
-    key = std::move(key);
-    value = std::move(value);
+    key = std::move(b.key);
+    value = std::move(b.value);
 
     return *this;
   }
@@ -82,30 +82,33 @@ template <typename Key, typename Value> struct Pair {
 };
 } // namespace detail::map
 /**
- * Open-addressing hash map with quadratic probing.
+ * Open-addressing hash map, see detail::HashTable.
  *
- * Stores up to @p static_size key-value pairs inline (actual table capacity
- * is roughly 3x to maintain load factor). Falls back to heap via alloc::alloc
- * when the element count exceeds the static capacity. Rehashes when more than
- * one-third of slots are occupied. Uses tombstones for deletion.
+ * Stores up to @p static_size key-value pairs inline (the table inside the
+ * object is the next power of two above that, at least 16 slots). Falls back
+ * to heap via @p Allocator when it fills up, and grows by doubling whenever
+ * more than 7/8 of the slots are taken.
  */
-template <typename Key, typename Value, int static_size = 16>
+template <typename Key,
+          typename Value,
+          int static_size = 16,
+          alloc::AllocatorPolicy Allocator = alloc::TaggedAllocator>
 class alignas(ContainerAlign<detail::map::Pair<Key, Value>>()) Map {
   using Pair = detail::map::Pair<Key, Value>;
-  const static int real_static_size = static_size * 3 + 1;
+  using Table = detail::HashTable<
+      Key,
+      Pair,
+      detail::hash_table::capacity_for(static_size, detail::hash_table::group_width),
+      Allocator>;
 
 public:
   using key_type = Key;
   using value_type = Value;
+  using allocator_type = Allocator;
 
   struct iterator {
-    iterator(const Map *map, int i) : map_(map), i_(i)
+    iterator(const Map *map, IndexInt i) : map_(map), i_(map->table_.next_full(i))
     {
-      if (i_ == 0) {
-        /* Find first item. */
-        i_ = -1;
-        operator++();
-      }
     }
 
     iterator(const iterator &b) : map_(b.map_), i_(b.i_)
@@ -123,32 +126,24 @@ public:
 
     const Pair &operator*() const
     {
-      return map_->table_[i_];
+      return map_->table_.slot(i_);
     }
 
     iterator &operator++()
     {
-      i_++;
-
-      while (i_ < map_->table_.size() && !map_->used_[i_]) {
-        i_++;
-      }
-
+      i_ = map_->table_.next_full(i_ + 1);
       return *this;
     }
 
   private:
-    int i_;
     const Map *map_;
+    IndexInt i_;
   };
 
   template <bool is_key, typename T> struct key_value_range {
-    key_value_range(const Map *map, int i = 0) : map_(map), i_(i)
+    key_value_range(const Map *map, IndexInt i = 0)
+        : map_(map), i_(map->table_.next_full(i))
     {
-      if (i == 0) {
-        i_--;
-        operator++();
-      }
     }
 
     key_value_range(const key_value_range &b) : map_(b.map_), i_(b.i_)
@@ -167,23 +162,19 @@ public:
 
     T &operator*()
     {
+      /* Ranges from a const map still hand out mutable values. */
+      Pair &pair = const_cast<Pair &>(map_->table_.slot(i_));
+
       if constexpr (is_key) {
-        return map_->table_[i_].key;
+        return pair.key;
       } else {
-        return map_->table_[i_].value;
+        return pair.value;
       }
     }
 
     key_value_range &operator++()
     {
-      i_++;
-
-      int table_size = int(map_->table_.size());
-
-      while (i_ < map_->table_.size() && !map_->used_[i_]) {
-        i_++;
-      }
-
+      i_ = map_->table_.next_full(i_ + 1);
       return *this;
     }
 
@@ -194,98 +185,43 @@ public:
 
     key_value_range end() const
     {
-      return key_value_range(map_, map_->table_.size());
+      return key_value_range(map_, IndexInt(map_->table_.capacity()));
     }
 
   private:
     const Map *map_;
-    int i_ = 0;
+    IndexInt i_ = 0;
   };
 
   using key_range = key_value_range<true, Key>;
   using value_range = key_value_range<false, Value>;
 
-  friend struct key_value_range<true, Key>;
-
-  Map(const Map &b) : cur_size_(b.cur_size_)
-  {
-    int size = hashsizes[cur_size_];
-
-    if (size <= real_static_size) {
-      table_ = std::span(get_static(), size);
-    } else {
-      table_ = std::span(
-          static_cast<Pair *>(alloc::alloc("copied map table", sizeof(Pair) * size)),
-          size);
-    }
-
-    used_ = b.used_;
-    used_count_ = b.used_count_;
-    clear_ = b.clear_;
-
-    for (int i = 0; i < size; i++) {
-      if (used_[i]) {
-        table_[i] = b.table_[i];
-      }
-    }
-  }
+  Map(const Map &b) = default;
 
   Map()
-      : table_(get_static(), hashsizes[find_hashsize_prev(real_static_size)]),
-        cur_size_(find_hashsize_prev(real_static_size))
   {
-    reserve_usedmap();
   }
 
-  Map(Map &&b)
+  explicit Map(const Allocator &allocator) : table_(allocator)
   {
-    if (table_.data() == get_static()) {
-      Map(static_cast<const Map &>(b));
-    } else {
-      table_ = std::move(b.table_);
-      used_count_ = b.used_count_;
-      used_ = std::move(b.used_);
-      clear_ = std::move(b.clear_);
-      cur_size_ = b.cur_size_;
-    }
   }
 
+  Map(Map &&b) = default;
+
   DEFAULT_MOVE_ASSIGNMENT(Map)
 
   Map(std::initializer_list<Pair> list)
   {
-    cur_size_ = find_hashsize(list.size() * 3 + 1);
-    int size = hashsizes[cur_size_];
-
-    if (size <= real_static_size) {
-      table_ = std::span(get_static(), size);
-    } else {
-      table_ = std::span(
-          static_cast<Pair *>(alloc::alloc("Map table", sizeof(Pair) * size)), size);
-    }
-
-    reserve_usedmap();
+    table_.reserve(list.size());
 
     for (auto &&item : list) {
       add_overwrite(item.key, item.value);
     }
   }
 
-  ~Map()
+  const Allocator &get_allocator() const
   {
-    if (table_.data() == get_static()) {
-      return;
-    }
-
-    if constexpr (!Pair::is_simple()) {
-      for (int i = 0; i < table_.size(); i++) {
-        if (used_[i]) {
-          table_[i].~Pair();
-        }
-      }
-    }
-
-    alloc::release(static_cast<void *>(table_.data()));
+    return table_.get_allocator();
   }
 
   /** Returns an iterable range over all keys in the map. */
@@ -307,13 +243,13 @@ public:
 
   iterator end() const
   {
-    return iterator(this, table_.size());
+    return iterator(this, IndexInt(table_.capacity()));
   }
 
   /** Returns the number of entries currently in the map. */
   size_t size() const
   {
-    return size_t(used_count_);
+    return table_.size();
   }
 
   /**
@@ -323,19 +259,13 @@ public:
    */
   void insert(const Key &key, const Value &value)
   {
-    check_load();
-
-    int i = find_pair<false, true>(key);
-    add_finalize(i, key, value);
+    construct(table_.prepare_insert(key), key, value);
   }
 
   /** Rvalue overload of insert method above. */
   void insert(Key &&key, Value &&value)
   {
-    check_load();
-
-    int i = find_pair<false, true>(key);
-    add_finalize(i, key, value);
+    construct(table_.prepare_insert(key), std::move(key), std::move(value));
   }
 
   /**
@@ -351,6 +281,30 @@ public:
     return add_intern<false>(key, value);
   }
 
+  /**
+   * Searches with @p key as is (see hash::is_transparent) and converts it to a
+   * Key only when inserting, so adding a stringref or C string to a Map<string>
+   * that already has it does not allocate.
+   */
+  template <detail::hash_table::TransparentKey<Key> K>
+  bool add(const K &key, const Value &value)
+  {
+    const auto &k = detail::hash_table::lookup_key(key);
+    auto [i, found] = table_.find_or_prepare_insert(k);
+
+    if (found) {
+      return false;
+    }
+
+    construct(i, Key(k), value);
+    return true;
+  }
+  template <detail::hash_table::TransparentKey<Key> K>
+  bool add(const K &key, const Value &&value)
+  {
+    return add(key, value);
+  }
+
   /**
    * Inserts or overwrites. Returns true if @p key was new, false if an
    * existing value was overwritten.
@@ -370,48 +324,61 @@ public:
    */
   Value &operator[](const Key &key)
   {
-    check_load();
-    int first_clearcell = -1;
-    int i = find_pair<true, true>(key, &first_clearcell);
+    auto [i, found] = table_.find_or_prepare_insert(key);
 
-    if (!used_[i]) {
-      if (first_clearcell != -1) {
-        i = first_clearcell;
-        clear_.set(first_clearcell, false);
-      }
+    if (!found) {
+      construct(i, key, Value());
+    }
+    return table_.slot(i).value;
+  }
 
-      if constexpr (!is_simple<Value>()) {
-        new (static_cast<void *>(&table_[i].value)) Value();
-      }
+  /** Like above, with @p key converted to a Key only if it is inserted. */
+  template <detail::hash_table::TransparentKey<Key> K> Value &operator[](const K &key)
+  {
+    const auto &k = detail::hash_table::lookup_key(key);
+    auto [i, found] = table_.find_or_prepare_insert(k);
 
-      used_.set(i, true);
-      new (static_cast<void *>(&table_[i].key)) Key(key);
-      used_count_++;
+    if (!found) {
+      construct(i, Key(k), Value());
     }
-    return table_[i].value;
+    return table_.slot(i).value;
   }
 
   /** Returns true if @p key is present in the map. */
-  bool contains(const Key &key)
+  bool contains(const Key &key) const
   {
-    int i = find_pair<true, false>(key);
-    return i != -1;
+    return table_.find(key) != -1;
   }
-  bool contains(const Key &&key)
+
+  /**
+   * contains() for a @p key of another type that hashes and compares like Key,
+   * such as a stringref in a Map<string>, without converting it.
+   */
+  template <detail::hash_table::TransparentKey<Key> K> bool contains(const K &key) const
   {
-    int i = find_pair<true, false>(key);
-    return i != -1;
+    return table_.find(detail::hash_table::lookup_key(key)) != -1;
   }
 
   /** Returns a pointer to the value for @p key, or nullptr if not found. */
   Value *lookup_ptr(const Key &key)
   {
-    int i = find_pair<true, false>(key);
+    const IndexInt i = table_.find(key);
     if (i < 0) {
       return nullptr;
     }
 
-    return &table_[i].value;
+    return &table_.slot(i).value;
+  }
+
+  /** lookup_ptr() without converting @p key, see contains(). */
+  template <detail::hash_table::TransparentKey<Key> K> Value *lookup_ptr(const K &key)
+  {
+    const IndexInt i = table_.find(detail::hash_table::lookup_key(key));
+    if (i < 0) {
+      return nullptr;
+    }
+
+    return &table_.slot(i).value;
   }
 
   /**
@@ -422,25 +389,13 @@ public:
   template <detail::map::KeyCopier<Key> KeyCopyFunc, typename ValueSetFunc>
   Value &add_callback(const Key &key, KeyCopyFunc copy_key, ValueSetFunc set_value)
   {
-    check_load();
-
-    int first_clearcell = -1;
-    int i = find_pair<true, true>(key, &first_clearcell);
-    if (!used_[i]) {
-      if (first_clearcell != -1) {
-        i = first_clearcell;
-        clear_.set(first_clearcell, false);
-      }
-
-      used_.set(i, true);
-      used_count_++;
+    auto [i, found] = table_.find_or_prepare_insert(key);
 
-      /* Use copy/move constructors since we have unallocated memory. */
-      new (static_cast<void *>(&table_[i].key)) Key(copy_key(key));
-      new (static_cast<void *>(&table_[i].value)) Value(set_value());
+    if (!found) {
+      construct(i, copy_key(key), set_value());
     }
 
-    return table_[i].value;
+    return table_.slot(i).value;
   }
 
   /**
@@ -451,35 +406,27 @@ public:
    */
   bool add_uninitialized(const Key &key, Value **value)
   {
-    check_load();
-
-    int first_clearcell = -1;
-    int i = find_pair<true, true>(key, &first_clearcell);
+    auto [i, found] = table_.find_or_prepare_insert(key);
+    Pair &pair = table_.slot(i);
 
     if (value) {
-      *value = &table_[i].value;
+      *value = &pair.value;
     }
 
-    if (!used_[i]) {
-      if (first_clearcell != -1) {
-        i = first_clearcell;
-        clear_.set(first_clearcell, false);
-      }
-      // make life easier to client code by
-      // default initializing the value, which allows them to
-      // use assignment operator instead of placement new.
-      if (!is_simple<Value>()) {
-        new (static_cast<void *>(&table_[i].value)) Value();
-      }
+    if (found) {
+      return false;
+    }
 
-      // use placement new instead of assignment
-      new (static_cast<void *>(&table_[i].key)) Key(key);
-      used_.set(i, true);
-      used_count_++;
-      return true;
+    // make life easier to client code by
+    // default initializing the value, which allows them to
+    // use assignment operator instead of placement new.
+    if constexpr (!is_simple<Value>()) {
+      new (static_cast<void *>(&pair.value)) Value();
     }
 
-    return false;
+    // use placement new instead of assignment
+    new (static_cast<void *>(&pair.key)) Key(key);
+    return true;
   }
 
   /**
@@ -488,8 +435,7 @@ public:
    */
   Value &lookup(const Key &key)
   {
-    int i = find_pair<true, false>(key);
-    return table_[i].value;
+    return table_.slot(table_.find(key)).value;
   }
 
   /**
@@ -498,24 +444,14 @@ public:
    */
   bool remove(const Key &key, Value *out_value = nullptr)
   {
-    int i = find_pair<true, false>(key);
-
-    if (i == -1) {
-      return false;
-    }
-
-    this->used_.set(i, false);
-    this->clear_.set(i, true);
-
-    if (out_value) {
-      *out_value = std::move(table_[i].value);
-    }
-
-    if constexpr (!Pair::is_simple()) {
-      table_[i].~Pair();
-    }
+    return remove_at(table_.find(key), out_value);
+  }
 
-    return true;
+  /** remove() without converting @p key, see contains(). */
+  template <detail::hash_table::TransparentKey<Key> K>
+  bool remove(const K &key, Value *out_value = nullptr)
+  {
+    return remove_at(table_.find(detail::hash_table::lookup_key(key)), out_value);
   }
 
   /**
@@ -524,193 +460,56 @@ public:
    */
   void reserve(size_t size)
   {
-    size = size * 3 + 1;
-
-    if (table_.size() >= size) {
-      return;
-    }
-
-    realloc_to_size(size);
+    table_.reserve(size);
   }
 
 private:
-  using MyBoolVector = BoolVector<static_size * 3 + 1>;
-
-  std::span<Pair> table_;
-  char *static_storage_[real_static_size * sizeof(Pair)];
-  MyBoolVector used_;
-  // used to mark deleted tombstones
-  MyBoolVector clear_;
-  int cur_size_ = 0;
-  int used_count_ = 0;
-
-  void reserve_usedmap()
-  {
-    hash::HashInt size = hash::HashInt(hashsizes[cur_size_]);
-    used_.resize(size);
-    used_.clear();
-    clear_.resize(size);
-    clear_.clear();
-  }
+  Table table_;
 
   template <bool overwrite = false> bool add_intern(const Key &key, const Value &value)
   {
-    check_load();
+    auto [i, found] = table_.find_or_prepare_insert(key);
 
-    int i = find_pair<true, true>(key);
-    if (used_[i]) {
+    if (found) {
       if constexpr (overwrite) {
-        add_finalize(i, key, value);
+        table_.slot(i).value = value;
       }
 
       return false;
     }
 
-    add_finalize(i, key, value);
-
+    construct(i, key, value);
     return true;
   }
 
-  /* Handles rvalues. */
-  template <typename KeyArg, typename ValueArg>
-  void add_finalize(int i, const KeyArg key, const ValueArg value)
+  bool remove_at(IndexInt i, Value *out_value)
   {
-    if constexpr (!Pair::is_simple()) {
-      if (!used_[i]) {
-        /* Use copy/move constructors. */
-        new (static_cast<void *>(&table_[i].key)) Key(key);
-        new (static_cast<void *>(&table_[i].value)) Value(value);
-      } else {
-        table_[i].key = key;
-        table_[i].value = value;
-      }
-    } else {
-      table_[i].key = key;
-      table_[i].value = value;
+    if (i == -1) {
+      return false;
     }
 
-    used_count_++;
-    used_.set(i, true);
-  }
-
-  template <bool check_key_equals = true, bool return_unused_cell = false>
-  int find_pair(const Key &key, int *first_clearcell = nullptr)
-  {
-    const hash::HashInt size = hash::HashInt(table_.size());
-    hash::HashInt hashval = hash::hash(key) % size;
-    hash::HashInt h = hashval, probe = hashval;
-
-    int count = 0;
-    while (1) {
-      if (count > size) {
-        clear_clearcells();
-        return find_pair<check_key_equals, return_unused_cell>(key, first_clearcell);
-      }
-
-      if (!used_[h]) {
-        if constexpr (return_unused_cell) {
-          if (!clear_[h]) {
-            return h;
-          } else if (first_clearcell) {
-            *first_clearcell = h;
-          }
-        } else {
-          return -1;
-        }
-      }
-
-      if constexpr (check_key_equals) {
-        if (table_[h].key == key) {
-          return h;
-        }
-      }
-
-      probe++;
-      hashval += probe;
-      h = hashval % size;
+    if (out_value) {
+      *out_value = std::move(table_.slot(i).value);
     }
+
+    table_.erase(i);
+    return true;
   }
 
-  inline bool check_load()
+  /** Constructs the pair in a slot claimed by the table. */
+  template <typename KeyArg, typename ValueArg>
+  void construct(IndexInt i, KeyArg &&key, ValueArg &&value)
   {
-    if (used_count_ > table_.size() / 3) {
-      realloc_to_size(table_.size() * 3);
-      return true;
-    }
+    Pair &pair = table_.slot(i);
 
-    return false;
+    new (static_cast<void *>(&pair.key)) Key(std::forward<KeyArg>(key));
+    new (static_cast<void *>(&pair.value)) Value(std::forward<ValueArg>(value));
   }
 
   inline Map &clear()
   {
-    // destruct all used pairs
-    if constexpr (!Pair::is_simple()) {
-      int size = table_.size();
-      for (int i = 0; i < size; i++) {
-        if (!(used_[i])) {
-          continue;
-        }
-
-        table_[i].~Pair();
-      }
-    }
-
-    // reset used map and count
-    used_count_ = 0;
-    used_.clear();
-    clear_.clear();
+    table_.clear();
     return *this;
   }
-
-  void clear_clearcells()
-  {
-    realloc_to_size(table_.size());
-  }
-
-  inline void realloc_to_size(size_t size)
-  {
-    size_t old_size = hashsizes[cur_size_];
-    while (hashsizes[cur_size_] < size) {
-      cur_size_++;
-    }
-
-    size_t newsize = hashsizes[cur_size_];
-
-    std::span<Pair> old = table_;
-    MyBoolVector old_used = used_;
-
-    table_ = std::span(static_cast<Pair *>(alloc::alloc("sculpecore::util::map table",
-                                                        newsize * sizeof(Pair))),
-                       newsize);
-
-    used_count_ = 0;
-    used_.resize(newsize);
-    used_.clear();
-    clear_.resize(newsize);
-    clear_.clear();
-
-    for (int i = 0; i < old.size(); i++) {
-      if (old_used[i]) {
-        int index = find_pair<false, true>(old[i].key);
-
-        new (static_cast<void *>(&table_[index].key)) Key(std::move(old[i].key));
-        new (static_cast<void *>(&table_[index].value)) Value(std::move(old[i].value));
-
-        if constexpr (!Pair::is_simple()) {
-          old[i].~Pair();
-        }
-        used_.set(index, true);
-      }
-    }
-
-    if (old.data() != get_static()) {
-      alloc::release(static_cast<void *>(old.data()));
-    }
-  }
-
-  Pair *get_static()
-  {
-    return reinterpret_cast<Pair *>(static_storage_);
-  }
 };
 } // namespace litestl::util
@@ -0,0 +1,176 @@
+#pragma once
+
+#include "alloc.h"
+#include "compiler_util.h"
+#include "index_range.h"
+#include "task.h"
+#include "vector.h"
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+/*
+ * Parallel merge sort behind Vector::parallel_sort and
+ * Vector::parallel_stable_sort.
+ *
+ * The array is cut into a power of two number of runs, one per thread, which
+ * are sorted serially in parallel.  Runs are then merged pairwise in log2(runs)
+ * rounds.  Each round splits every merge along its merge path, so all threads
+ * stay busy up to the last merge.  Merging is stable, so stable run sorts give
+ * a stable sort.  Needs a scratch buffer the size of the array.
+ */
+namespace litestl::util::detail {
+template <typename T> struct ParallelSort {
+  /** Arrays smaller than twice this are sorted serially, as are runs. */
+  static constexpr size_t serial_cutoff = size_t(1) << 15;
+
+  template <typename Less>
+  static void sort(T *data, size_t size, Less less, bool stable, int thread_count)
+  {
+    if (thread_count <= 0) {
+      thread_count = platform::max_thread_count();
+    }
+
+    int runs = 1;
+    while (runs < thread_count && size / (size_t(runs) * 2) >= serial_cutoff) {
+      runs *= 2;
+    }
+
+    if (runs == 1) {
+      serial_sort(data, data + size, less, stable);
+      return;
+    }
+
+    T *buffer = static_cast<T *>(
+        alloc::alloc_for<T>("parallel_sort buffer", sizeof(T) * size));
+    T *src = data;
+    T *dst = buffer;
+
+    auto run_start = [&](IndexInt run) { return size_t(run) * size / size_t(runs); };
+
+    task::parallel_for(IndexRange(runs), [&](IndexRange range) {
+      for (IndexInt run : range) {
+        serial_sort(data + run_start(run), data + run_start(run + 1), less, stable);
+
+        /* Merges assign into their destination, which must hold live objects. */
+        if constexpr (!util::is_simple<T>()) {
+          std::uninitialized_move(
+              data + run_start(run), data + run_start(run + 1), buffer + run_start(run));
+        }
+      }
+    });
+
+    if constexpr (!util::is_simple<T>()) {
+      std::swap(src, dst);
+    }
+
+    /* Per merge slice, how many elements it takes from the pair's first run. */
+    Vector<size_t, 64> splits;
+    splits.resize(runs);
+
+    for (int width = 1; width < runs; width *= 2) {
+      /* Runs [pair, pair + width) and [pair + width, pair + 2 * width) merge. */
+      auto pair_of = [&](IndexInt task) { return task - task % (width * 2); };
+
+      /* Output offset of merge slice @p task within its pair. */
+      auto diagonal = [&](IndexInt task) {
+        const IndexInt pair = pair_of(task);
+        return size_t(task - pair) * (run_start(pair + width * 2) - run_start(pair)) /
+               size_t(width * 2);
+      };
+
+      /*
+       * One task per run: the 2 * width tasks of a pair each merge a slice of
+       * it.  All splits are found before merging starts, since moving out of
+       * src may write to it (resetting the moved-from objects).
+       */
+      task::parallel_for(IndexRange(runs), [&](IndexRange range) {
+        for (IndexInt task : range) {
+          const IndexInt pair = pair_of(task);
+          const size_t a = run_start(pair);
+          const size_t b = run_start(pair + width);
+          const size_t end = run_start(pair + width * 2);
+
+          splits[task] = merge_path(
+              src + a, b - a, src + b, end - b, diagonal(task), less);
+        }
+      });
+
+      task::parallel_for(IndexRange(runs), [&](IndexRange range) {
+        for (IndexInt task : range) {
+          const IndexInt pair = pair_of(task);
+          const size_t a = run_start(pair);
+          const size_t b = run_start(pair + width);
+          const bool last = pair_of(task + 1) != pair;
+
+          const size_t d0 = diagonal(task);
+          const size_t d1 = last ? run_start(pair + width * 2) - a : diagonal(task + 1);
+          const size_t i0 = splits[task];
+          const size_t i1 = last ? b - a : splits[task + 1];
+
+          std::merge(std::make_move_iterator(src + a + i0),
+                     std::make_move_iterator(src + a + i1),
+                     std::make_move_iterator(src + b + (d0 - i0)),
+                     std::make_move_iterator(src + b + (d1 - i1)),
+                     dst + a + d0,
+                     less);
+        }
+      });
+
+      std::swap(src, dst);
+    }
+
+    if (src != data) {
+      task::parallel_for(IndexRange(runs), [&](IndexRange range) {
+        for (IndexInt run : range) {
+          std::move(
+              src + run_start(run), src + run_start(run + 1), data + run_start(run));
+        }
+      });
+    }
+
+    if constexpr (!util::is_simple<T>()) {
+      std::destroy(buffer, buffer + size);
+    }
+    alloc::release(static_cast<void *>(buffer));
+  }
+
+private:
+  template <typename Less>
+  static void serial_sort(T *first, T *last, Less less, bool stable)
+  {
+    if (stable) {
+      std::stable_sort(first, last, less);
+    } else {
+      std::sort(first, last, less);
+    }
+  }
+
+  /**
+   * Returns how many elements of @p a are among the first @p diagonal
+   * elements of the stable merge of sorted @p a and @p b.
+   */
+  template <typename Less>
+  static size_t merge_path(
+      const T *a, size_t a_size, const T *b, size_t b_size, size_t diagonal, Less &less)
+  {
+    size_t lo = diagonal > b_size ? diagonal - b_size : 0;
+    size_t hi = std::min(diagonal, a_size);
+
+    while (lo < hi) {
+      const size_t i = (lo + hi) / 2;
+
+      /* a[i] is taken unless b has more elements before it than fit. */
+      if (less(b[diagonal - i - 1], a[i])) {
+        hi = i;
+      } else {
+        lo = i + 1;
+      }
+    }
+
+    return lo;
+  }
+};
+} // namespace litestl::util::detail
@@ -0,0 +1,48 @@
+#include "pool.h"
+
+#include <bit>
+
+namespace litestl::alloc::detail {
+namespace {
+static_assert(pool_thread_slots <= 64);
+
+/* Bit i is set while slot i has an owner. */
+std::atomic<uint64_t> used_thread_slots = {0};
+
+/** Gives the thread's slot back on thread exit. */
+struct ThreadSlotOwner {
+  int index = -1;
+
+  ~ThreadSlotOwner()
+  {
+    if (index >= 0) {
+      used_thread_slots.fetch_and(~(uint64_t(1) << index), std::memory_order_release);
+    }
+
+    /* Frees from later thread_local destructors take the locked path. */
+    pool_thread_index = -1;
+  }
+};
+thread_local ThreadSlotOwner thread_slot_owner;
+} // namespace
+
+int pool_thread_slot_assign()
+{
+  uint64_t used = used_thread_slots.load(std::memory_order_relaxed);
+  int index;
+
+  do {
+    if (used == ~uint64_t(0)) {
+      pool_thread_index = -1;
+      return -1;
+    }
+
+    index = std::countr_one(used);
+  } while (!used_thread_slots.compare_exchange_weak(
+      used, used | (uint64_t(1) << index), std::memory_order_acquire));
+
+  thread_slot_owner.index = index;
+  pool_thread_index = index;
+  return index;
+}
+} // namespace litestl::alloc::detail
@@ -0,0 +1,269 @@
+#pragma once
+
+#include "alloc.h"
+#include "compiler_util.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace litestl::alloc {
+/** Usage counters of a Pool. */
+struct PoolStats {
+  /** Objects currently allocated. */
+  int64_t live;
+  /** Total number of New calls. */
+  uint64_t allocations;
+  /** Slabs held, and the bytes they take. */
+  size_t slabs;
+  size_t slab_bytes;
+};
+
+namespace detail {
+/** Threads that get a private cache in each thread-caching pool. */
+static constexpr int pool_thread_slots = 64;
+
+/* Calling thread's slot, -2 until assigned. */
+inline thread_local int pool_thread_index = -2;
+
+int pool_thread_slot_assign();
+
+/**
+ * Returns the calling thread's cache slot in [0, pool_thread_slots), or -1
+ * if all are taken.  Slots are handed to new threads when their thread
+ * exits, along with whatever objects its caches still hold.
+ */
+inline int pool_thread_slot()
+{
+  const int index = pool_thread_index;
+  return index != -2 ? index : pool_thread_slot_assign();
+}
+} // namespace detail
+
+/**
+ * Pool of fixed-size objects.
+ *
+ * Objects are carved out of slabs of @p slab_objects slots taken from
+ * alloc::alloc, and freed slots go on a free list, so New and Delete are O(1)
+ * pointer pops and pushes.  Slabs are only returned when the pool is
+ * destroyed, which must happen after every object was deleted.
+ *
+ *   alloc::Pool<Node> nodes("tree nodes");
+ *   Node *node = nodes.New(key, value);
+ *   nodes.Delete(node);
+ *
+ * A plain pool is not thread safe.  With @p thread_cache each thread keeps a
+ * private free list and trades slots with a shared, locked list in batches;
+ * objects may then be deleted on any thread.
+ */
+template <typename T, bool thread_cache = false> class Pool {
+  union Slot {
+    Slot *next;
+    alignas(T) unsigned char storage[sizeof(T)];
+  };
+
+  struct Slab {
+    Slab *next;
+  };
+
+  /* Slots handed between a thread cache and the shared list at once. */
+  static constexpr int batch_size = 32;
+  /* Slab header size, keeping the first slot aligned. */
+  static constexpr size_t slab_header = std::max(sizeof(Slab), alignof(Slot));
+
+  struct alignas(64) ThreadCache {
+    Slot *head = nullptr;
+    int count = 0;
+    /* Only written by the owning thread. */
+    std::atomic<int64_t> live = {0};
+    std::atomic<uint64_t> allocations = {0};
+  };
+
+public:
+  explicit Pool(const char *tag = "Pool", int slab_objects = 64)
+      : tag_(tag), slab_objects_(std::max(slab_objects, 1))
+  {
+  }
+
+  Pool(const Pool &) = delete;
+  Pool &operator=(const Pool &) = delete;
+
+  ~Pool()
+  {
+    Slab *slab = slabs_;
+
+    while (slab) {
+      Slab *next = slab->next;
+      release(static_cast<void *>(slab));
+      slab = next;
+    }
+  }
+
+  /** Allocates and constructs a @p T. */
+  template <typename... Args> T *New(Args &&...args)
+  {
+    return new (pop()) T(std::forward<Args>(args)...);
+  }
+
+  /** Destructs and frees an object returned by New.  Null is ignored. */
+  void Delete(T *obj)
+  {
+    if (obj) {
+      obj->~T();
+      push(reinterpret_cast<Slot *>(obj));
+    }
+  }
+
+  PoolStats stats() const
+  {
+    if constexpr (thread_cache) {
+      std::lock_guard guard(mutex_);
+      PoolStats stats = {live_, allocations_, slab_count_, slab_count_ * slab_bytes()};
+
+      for (const ThreadCache &cache : caches_) {
+        stats.live += cache.live.load(std::memory_order_relaxed);
+        stats.allocations += cache.allocations.load(std::memory_order_relaxed);
+      }
+      return stats;
+    } else {
+      return {live_, allocations_, slab_count_, slab_count_ * slab_bytes()};
+    }
+  }
+
+private:
+  size_t slab_bytes() const
+  {
+    return slab_header + sizeof(Slot) * size_t(slab_objects_);
+  }
+
+  /** Allocates a new slab and threads its slots onto free_.  Caller holds the lock. */
+  void add_slab()
+  {
+    void *mem = alignof(Slot) > default_align ?
+                    alloc_aligned(tag_, slab_bytes(), alignof(Slot)) :
+                    alloc(tag_, slab_bytes());
+    Slab *slab = static_cast<Slab *>(mem);
+    Slot *slots = reinterpret_cast<Slot *>(static_cast<char *>(mem) + slab_header);
+
+    for (int i = 0; i < slab_objects_ - 1; i++) {
+      slots[i].next = slots + i + 1;
+    }
+    slots[slab_objects_ - 1].next = free_;
+    free_ = slots;
+
+    slab->next = slabs_;
+    slabs_ = slab;
+    slab_count_++;
+  }
+
+  Slot *pop_shared()
+  {
+    if (!free_) {
+      add_slab();
+    }
+
+    Slot *slot = free_;
+    free_ = slot->next;
+    return slot;
+  }
+
+  void *pop()
+  {
+    if constexpr (thread_cache) {
+      const int index = detail::pool_thread_slot();
+
+      if (index >= 0) {
+        ThreadCache &cache = caches_[index];
+
+        if (!cache.head) {
+          std::lock_guard guard(mutex_);
+          for (int i = 0; i < batch_size; i++) {
+            Slot *slot = pop_shared();
+            slot->next = cache.head;
+            cache.head = slot;
+          }
+          cache.count = batch_size;
+        }
+
+        Slot *slot = cache.head;
+        cache.head = slot->next;
+        cache.count--;
+        add_owned(cache.live, int64_t(1));
+        add_owned(cache.allocations, uint64_t(1));
+        return static_cast<void *>(slot);
+      }
+
+      std::lock_guard guard(mutex_);
+      live_++;
+      allocations_++;
+      return static_cast<void *>(pop_shared());
+    } else {
+      live_++;
+      allocations_++;
+      return static_cast<void *>(pop_shared());
+    }
+  }
+
+  void push(Slot *slot)
+  {
+    if constexpr (thread_cache) {
+      const int index = detail::pool_thread_slot();
+
+      if (index >= 0) {
+        ThreadCache &cache = caches_[index];
+
+        slot->next = cache.head;
+        cache.head = slot;
+        add_owned(cache.live, int64_t(-1));
+
+        /* Hand a batch back so slots freed here can be reused by other threads. */
+        if (++cache.count > batch_size * 2) {
+          std::lock_guard guard(mutex_);
+          for (int i = 0; i < batch_size; i++) {
+            Slot *next = cache.head->next;
+            cache.head->next = free_;
+            free_ = cache.head;
+            cache.head = next;
+          }
+          cache.count -= batch_size;
+        }
+        return;
+      }
+
+      std::lock_guard guard(mutex_);
+      live_--;
+      slot->next = free_;
+      free_ = slot;
+    } else {
+      live_--;
+      slot->next = free_;
+      free_ = slot;
+    }
+  }
+
+  template <typename Int> static void add_owned(std::atomic<Int> &counter, Int delta)
+  {
+    counter.store(counter.load(std::memory_order_relaxed) + delta,
+                  std::memory_order_relaxed);
+  }
+
+  struct Empty {};
+
+  const char *tag_;
+  int slab_objects_;
+  Slot *free_ = nullptr;
+  Slab *slabs_ = nullptr;
+  size_t slab_count_ = 0;
+  int64_t live_ = 0;
+  uint64_t allocations_ = 0;
+  no_unique_addr mutable std::conditional_t<thread_cache, std::mutex, Empty> mutex_;
+  no_unique_addr std::conditional_t<thread_cache,
+                                    ThreadCache[detail::pool_thread_slots],
+                                    Empty> caches_;
+};
+} // namespace litestl::alloc
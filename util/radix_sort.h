@@ -0,0 +1,254 @@
+#pragma once
+
+#include "alloc.h"
+#include "allocator.h"
+#include "vector.h"
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+/*
+ * LSD radix sort on 8-bit digits, for keys that are integers or floats.
+ *
+ *   radix_sort(ints);                                  // sort the values themselves
+ *   radix_sort(hits, [](const Hit &h) { return h.t; });  // sort records by a key
+ *   radix_sort_pairs(keys, values);                    // sort keys, permute values
+ *
+ * Keys are mapped to unsigned integers with the same order: signed integers
+ * get their sign bit flipped, floats get all bits flipped when negative and
+ * the sign bit flipped otherwise (so -0.0 sorts before 0.0, and NaNs end up
+ * at either end depending on their sign bit).
+ *
+ * One pass counts all digits, then each digit is one stable scatter pass
+ * into a scratch buffer; passes where every key has the same digit are
+ * skipped.  Sorts are stable.  Elements are copied with memcpy, so they must
+ * be trivially copyable.  Pass a scratch Vector to reuse its memory across
+ * sorts instead of allocating a buffer each time.
+ */
+namespace litestl::util {
+namespace detail {
+template <typename Key> struct RadixKey {
+  static_assert(std::is_integral_v<Key> || std::is_floating_point_v<Key>,
+                "radix sort keys must be integers or floats");
+
+  using Bits = std::conditional_t<
+      sizeof(Key) == 1,
+      uint8_t,
+      std::conditional_t<sizeof(Key) == 2,
+                         uint16_t,
+                         std::conditional_t<sizeof(Key) == 4, uint32_t, uint64_t>>>;
+
+  static_assert(sizeof(Key) == sizeof(Bits), "unsupported radix sort key size");
+
+  static constexpr Bits sign_bit = Bits(Bits(1) << (sizeof(Bits) * 8 - 1));
+
+  /** Maps @p key to an unsigned integer that sorts the same way. */
+  static Bits bits(Key key)
+  {
+    if constexpr (std::is_floating_point_v<Key>) {
+      const Bits b = std::bit_cast<Bits>(key);
+      return (b & sign_bit) ? Bits(~b) : Bits(b ^ sign_bit);
+    } else if constexpr (std::is_signed_v<Key>) {
+      return Bits(Bits(key) ^ sign_bit);
+    } else {
+      return Bits(key);
+    }
+  }
+};
+
+/** Stands in for the value array when there is none. */
+struct RadixNoValues {};
+
+/** Below this many elements, insertion sort beats the counting passes. */
+static constexpr size_t radix_serial_cutoff = 64;
+
+/**
+ * Sorts @p data by @p key_of, carrying @p values along when V isn't
+ * RadixNoValues.  @p data_tmp and @p values_tmp are scratch space of the
+ * same size.
+ */
+template <typename T, typename V, typename KeyOf>
+void radix_sort_impl(
+    T *data, T *data_tmp, V *values, V *values_tmp, size_t size, KeyOf key_of)
+{
+  static_assert(std::is_trivially_copyable_v<T>,
+                "radix sort needs trivially copyable elements");
+
+  using Key = std::remove_cvref_t<decltype(key_of(*data))>;
+  using Bits = typename RadixKey<Key>::Bits;
+  static constexpr bool has_values = !std::is_same_v<V, RadixNoValues>;
+  static constexpr int passes = int(sizeof(Bits));
+
+  auto bits_of = [&](const T &elem) { return RadixKey<Key>::bits(key_of(elem)); };
+
+  if (size <= radix_serial_cutoff) {
+    for (size_t i = 1; i < size; i++) {
+      T elem = data[i];
+      const Bits b = bits_of(elem);
+      size_t j = i;
+
+      if constexpr (has_values) {
+        V value = values[i];
+        for (; j > 0 && bits_of(data[j - 1]) > b; j--) {
+          data[j] = data[j - 1];
+          values[j] = values[j - 1];
+        }
+        values[j] = value;
+      } else {
+        for (; j > 0 && bits_of(data[j - 1]) > b; j--) {
+          data[j] = data[j - 1];
+        }
+      }
+      data[j] = elem;
+    }
+    return;
+  }
+
+  size_t counts[passes][256];
+  memset(counts, 0, sizeof(counts));
+
+  for (size_t i = 0; i < size; i++) {
+    const Bits b = bits_of(data[i]);
+    for (int pass = 0; pass < passes; pass++) {
+      counts[pass][(b >> (pass * 8)) & 0xFF]++;
+    }
+  }
+
+  T *src = data, *dst = data_tmp;
+  V *values_src = values, *values_dst = values_tmp;
+
+  for (int pass = 0; pass < passes; pass++) {
+    size_t *count = counts[pass];
+
+    /* Every key has the same digit here, the pass would be a plain copy. */
+    if (count[(bits_of(src[0]) >> (pass * 8)) & 0xFF] == size) {
+      continue;
+    }
+
+    size_t offset = 0;
+    for (int digit = 0; digit < 256; digit++) {
+      const size_t n = count[digit];
+      count[digit] = offset;
+      offset += n;
+    }
+
+    for (size_t i = 0; i < size; i++) {
+      const size_t j = count[(bits_of(src[i]) >> (pass * 8)) & 0xFF]++;
+
+      dst[j] = src[i];
+      if constexpr (has_values) {
+        values_dst[j] = values_src[i];
+      }
+    }
+
+    std::swap(src, dst);
+    if constexpr (has_values) {
+      std::swap(values_src, values_dst);
+    }
+  }
+
+  if (src != data) {
+    memcpy(static_cast<void *>(data), static_cast<const void *>(src), sizeof(T) * size);
+    if constexpr (has_values) {
+      memcpy(static_cast<void *>(values),
+             static_cast<const void *>(values_src),
+             sizeof(V) * size);
+    }
+  }
+}
+
+template <typename T> struct RadixIdentity {
+  T operator()(const T &value) const
+  {
+    return value;
+  }
+};
+} // namespace detail
+
+/**
+ * Sorts @p items by the integer or float returned by @p key, using @p scratch
+ * as the scratch buffer (it is resized to items.size(), contents undefined).
+ */
+template <typename T, typename KeyFn, int static_size, alloc::AllocatorPolicy Allocator>
+void radix_sort(std::span<T> items, KeyFn key, Vector<T, static_size, Allocator> &scratch)
+{
+  scratch.template resize<false>(items.size());
+  detail::radix_sort_impl<T, detail::RadixNoValues>(
+      items.data(), scratch.data(), nullptr, nullptr, items.size(), key);
+}
+
+/** Sorts @p items by the integer or float returned by @p key. */
+template <typename T, typename KeyFn> void radix_sort(std::span<T> items, KeyFn key)
+{
+  if (items.size() <= detail::radix_serial_cutoff) {
+    detail::radix_sort_impl<T, detail::RadixNoValues>(
+        items.data(), nullptr, nullptr, nullptr, items.size(), key);
+    return;
+  }
+
+  T *tmp = static_cast<T *>(
+      alloc::alloc_for<T>("radix_sort buffer", sizeof(T) * items.size()));
+  detail::radix_sort_impl<T, detail::RadixNoValues>(
+      items.data(), tmp, nullptr, nullptr, items.size(), key);
+  alloc::release(static_cast<void *>(tmp));
+}
+
+/** Sorts integer or float @p items in ascending order. */
+template <typename T> void radix_sort(std::span<T> items)
+{
+  radix_sort(items, detail::RadixIdentity<T>());
+}
+
+template <typename T, int static_size, alloc::AllocatorPolicy Allocator, typename... Args>
+void radix_sort(Vector<T, static_size, Allocator> &vec, Args &&...args)
+{
+  radix_sort(std::span<T>(vec.data(), vec.size()), std::forward<Args>(args)...);
+}
+
+/**
+ * Sorts integer or float @p keys in ascending order and applies the same
+ * permutation to @p values, which must be as long as @p keys.
+ */
+template <typename K, typename V>
+void radix_sort_pairs(std::span<K> keys, std::span<V> values)
+{
+  static_assert(std::is_trivially_copyable_v<V>,
+                "radix sort needs trivially copyable values");
+
+  const size_t size = keys.size();
+
+  if (size <= detail::radix_serial_cutoff) {
+    detail::radix_sort_impl<K, V>(
+        keys.data(), nullptr, values.data(), nullptr, size, detail::RadixIdentity<K>());
+    return;
+  }
+
+  K *keys_tmp =
+      static_cast<K *>(alloc::alloc_for<K>("radix_sort buffer", sizeof(K) * size));
+  V *values_tmp =
+      static_cast<V *>(alloc::alloc_for<V>("radix_sort buffer", sizeof(V) * size));
+
+  detail::radix_sort_impl<K, V>(
+      keys.data(), keys_tmp, values.data(), values_tmp, size, detail::RadixIdentity<K>());
+
+  alloc::release(static_cast<void *>(keys_tmp));
+  alloc::release(static_cast<void *>(values_tmp));
+}
+
+template <typename K,
+          int ks,
+          alloc::AllocatorPolicy KA,
+          typename V,
+          int vs,
+          alloc::AllocatorPolicy VA>
+void radix_sort_pairs(Vector<K, ks, KA> &keys, Vector<V, vs, VA> &values)
+{
+  radix_sort_pairs(std::span<K>(keys.data(), keys.size()),
+                   std::span<V>(values.data(), values.size()));
+}
+} // namespace litestl::util
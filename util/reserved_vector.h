@@ -0,0 +1,272 @@
+#pragma once
+
+#include "platform/memory.h"
+#include "compiler_util.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <span>
+#include <utility>
+
+namespace litestl::util {
+/**
+ * Growable array that never moves its elements.
+ *
+ * The constructor reserves address space for @p max_size elements up front
+ * (see platform::reserve_pages) and pages are committed as the array grows,
+ * so growth never copies, pointers to elements stay valid until they're
+ * removed, and no old buffer lingers while growing.  Committed pages only
+ * take memory once touched, so resident memory follows the live size.
+ *
+ *   ReservedVector<Particle> particles(10'000'000);
+ *   Particle &p = particles.grow_one();
+ *
+ * Memory is mapped directly from the OS, it doesn't show up in alloc stats.
+ * Growing past max_size() is fatal.
+ *
+ * WASM has no virtual memory, so there the whole reservation is allocated
+ * (and zeroed) up front.  The default reservation would take 256mb that way,
+ * so on WASM there is none and @p max_size must be given.
+ */
+template <typename T> class ReservedVector {
+#ifndef WASM
+  /* Default reservation, plenty of address space for 64 bit platforms. */
+  static constexpr size_t default_max_bytes =
+      sizeof(void *) == 8 ? size_t(1) << 34 : size_t(256) << 20;
+#endif
+  /* Smallest commit step, to keep mprotect calls rare. */
+  static constexpr size_t min_commit = 64 * 1024;
+
+public:
+  using value_type = T;
+  using iterator = T *;
+  using const_iterator = const T *;
+
+#ifdef WASM
+  explicit ReservedVector(size_t max_size)
+#else
+  explicit ReservedVector(size_t max_size = default_max_bytes / sizeof(T))
+#endif
+  {
+    const size_t page = platform::page_size();
+    const size_t bytes = std::min(max_size, SIZE_MAX / 2 / sizeof(T)) * sizeof(T);
+
+    reserved_ = (bytes + page - 1) & ~(page - 1);
+    if (reserved_) {
+      data_ = static_cast<T *>(platform::reserve_pages(reserved_));
+      if (!data_) {
+        fprintf(stderr, "ReservedVector: failed to reserve %zu bytes\n", reserved_);
+        reserved_ = 0;
+      }
+    }
+  }
+
+  ReservedVector(const ReservedVector &) = delete;
+  ReservedVector &operator=(const ReservedVector &) = delete;
+
+  ReservedVector(ReservedVector &&b) noexcept
+      : data_(b.data_), size_(b.size_), committed_(b.committed_), reserved_(b.reserved_)
+  {
+    b.data_ = nullptr;
+    b.size_ = b.committed_ = b.reserved_ = 0;
+  }
+
+  DEFAULT_MOVE_ASSIGNMENT(ReservedVector)
+
+  ~ReservedVector()
+  {
+    destruct(0, size_);
+    if (data_) {
+      platform::release_pages(static_cast<void *>(data_), reserved_);
+    }
+  }
+
+  /** Appends an element constructed from @p args, returns a reference to it. */
+  template <typename... Args> T &grow_one(Args &&...args)
+  {
+    ensure_committed(size_ + 1);
+    T *elem = new (static_cast<void *>(data_ + size_)) T(std::forward<Args>(args)...);
+    size_++;
+    return *elem;
+  }
+
+  void append(const T &value)
+  {
+    grow_one(value);
+  }
+
+  void append(T &&value)
+  {
+    grow_one(std::move(value));
+  }
+
+  T pop_back()
+  {
+    size_--;
+    T ret = std::move(data_[size_]);
+    destruct(size_, size_ + 1);
+    return ret;
+  }
+
+  /** Resizes to @p newsize elements, value-initializing new ones. */
+  void resize(size_t newsize)
+  {
+    if (newsize < size_) {
+      destruct(newsize, size_);
+    } else {
+      ensure_committed(newsize);
+      for (size_t i = size_; i < newsize; i++) {
+        new (static_cast<void *>(data_ + i)) T();
+      }
+    }
+
+    size_ = newsize;
+  }
+
+  /** Commits room for at least @p size elements. */
+  void ensure_capacity(size_t size)
+  {
+    ensure_committed(size);
+  }
+
+  /** Removes all elements, keeping committed pages. */
+  void clear()
+  {
+    destruct(0, size_);
+    size_ = 0;
+  }
+
+  /** Returns committed pages past the last element to the OS. */
+  void contract()
+  {
+    const size_t page = platform::page_size();
+    const size_t keep = (size_ * sizeof(T) + page - 1) & ~(page - 1);
+
+    if (keep < committed_) {
+      platform::decommit_pages(reinterpret_cast<char *>(data_) + keep, committed_ - keep);
+      committed_ = keep;
+    }
+  }
+
+  T &operator[](size_t idx)
+  {
+    return data_[idx];
+  }
+
+  const T &operator[](size_t idx) const
+  {
+    return data_[idx];
+  }
+
+  T &last()
+  {
+    return data_[size_ - 1];
+  }
+
+  T *data()
+  {
+    return data_;
+  }
+
+  const T *data() const
+  {
+    return data_;
+  }
+
+  size_t size() const
+  {
+    return size_;
+  }
+
+  /** Elements that fit in the committed pages. */
+  size_t capacity() const
+  {
+    return committed_ / sizeof(T);
+  }
+
+  /** Elements that fit in the reserved range. */
+  size_t max_size() const
+  {
+    return reserved_ / sizeof(T);
+  }
+
+  iterator begin()
+  {
+    return data_;
+  }
+  iterator end()
+  {
+    return data_ + size_;
+  }
+  const_iterator begin() const
+  {
+    return data_;
+  }
+  const_iterator end() const
+  {
+    return data_ + size_;
+  }
+
+  operator std::span<T>()
+  {
+    return std::span<T>(data_, size_);
+  }
+
+  operator std::span<const T>() const
+  {
+    return std::span<const T>(data_, size_);
+  }
+
+private:
+  void destruct(size_t start, size_t end)
+  {
+    if constexpr (!is_simple<T>()) {
+      for (size_t i = start; i < end; i++) {
+        data_[i].~T();
+      }
+    }
+  }
+
+  flatten_inline void ensure_committed(size_t count)
+  {
+    if (count * sizeof(T) > committed_) [[unlikely]] {
+      commit(count * sizeof(T));
+    }
+  }
+
+  /** Commits at least @p bytes, growing the committed range geometrically. */
+  [[gnu::noinline]] void commit(size_t bytes)
+  {
+    if (bytes > reserved_) {
+      fprintf(stderr,
+              "ReservedVector: size exceeds max_size() of %zu elements\n",
+              max_size());
+      abort();
+    }
+
+    const size_t page = platform::page_size();
+    size_t target = std::max({bytes, committed_ * 2, min_commit});
+    target = std::min((target + page - 1) & ~(page - 1), reserved_);
+
+    char *start = reinterpret_cast<char *>(data_) + committed_;
+    if (!platform::commit_pages(static_cast<void *>(start), target - committed_)) {
+      fprintf(stderr,
+              "ReservedVector: failed to commit %zu bytes\n",
+              target - committed_);
+      abort();
+    }
+
+    committed_ = target;
+  }
+
+  T *data_ = nullptr;
+  size_t size_ = 0;
+  /* Bytes committed and reserved, both multiples of the page size. */
+  size_t committed_ = 0;
+  size_t reserved_ = 0;
+};
+} // namespace litestl::util
@@ -0,0 +1,183 @@
+#pragma once
+
+#include "compiler_util.h"
+#include "index_range.h"
+#include "vector.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+
+namespace litestl::util {
+/**
+ * Immutable lower_bound index over a sorted array, for tables that are
+ * searched far more often than they change.
+ *
+ *   SearchIndex<float> index(sorted_times);
+ *   IndexInt i = index.lower_bound(t); // same as std::lower_bound on sorted_times
+ *
+ * Keys are stored in Eytzinger (BFS) order: node k has children 2k and
+ * 2k + 1.  The first levels of the tree share a few cache lines, and the 16
+ * (for 4 byte keys) descendants four levels down are contiguous, so a search
+ * prefetches them while it walks the levels in between.  The tree is padded
+ * to a complete one with maximal keys, which makes every search take exactly
+ * height() branchless steps.  Batched lookups interleave many searches so
+ * their cache misses overlap.
+ *
+ * Takes up to twice the input's size for keys, plus an index per node to
+ * map results back to positions in the input.  @p T needs operator< and
+ * std::numeric_limits, i.e. integers and floats (no NaNs).
+ */
+template <typename T> class SearchIndex {
+  /* How far below the current node the prefetch reaches: one cache line of
+   * descendants. */
+  static constexpr size_t prefetch_stride = std::max(size_t(64) / sizeof(T), size_t(1));
+
+  /* Searches run side by side in batched lookups. */
+  static constexpr size_t batch_lanes = 16;
+
+public:
+  SearchIndex()
+  {
+    build(std::span<const T>());
+  }
+
+  explicit SearchIndex(std::span<const T> sorted)
+  {
+    build(sorted);
+  }
+
+  template <int static_size, alloc::AllocatorPolicy Allocator>
+  explicit SearchIndex(const Vector<T, static_size, Allocator> &sorted)
+  {
+    build(std::span<const T>(sorted.data(), sorted.size()));
+  }
+
+  /**
+   * Returns the position of the first input element not less than @p key,
+   * or size() if there is none.
+   */
+  IndexInt lower_bound(const T &key) const
+  {
+    const T *nodes = nodes_.data();
+    size_t k = 1;
+
+    for (int level = 0; level < height_; level++) {
+      prefetch_read(descendants(k));
+      k = 2 * k + size_t(nodes[k] < key);
+    }
+
+    return ranks_[IndexInt(finish(k))];
+  }
+
+  /** lower_bound() of every key in @p keys, written to @p r_indices. */
+  void lower_bound(std::span<const T> keys, std::span<IndexInt> r_indices) const
+  {
+    const T *nodes = nodes_.data();
+
+    for (size_t start = 0; start < keys.size(); start += batch_lanes) {
+      const size_t count = std::min(batch_lanes, keys.size() - start);
+      const T *lane_keys = keys.data() + start;
+      size_t k[batch_lanes];
+
+      for (size_t lane = 0; lane < count; lane++) {
+        k[lane] = 1;
+      }
+
+      for (int level = 0; level < height_; level++) {
+        for (size_t lane = 0; lane < count; lane++) {
+          prefetch_read(descendants(k[lane]));
+          k[lane] = 2 * k[lane] + size_t(nodes[k[lane]] < lane_keys[lane]);
+        }
+      }
+
+      for (size_t lane = 0; lane < count; lane++) {
+        r_indices[start + lane] = ranks_[IndexInt(finish(k[lane]))];
+      }
+    }
+  }
+
+  /** Number of elements indexed. */
+  IndexInt size() const
+  {
+    return size_;
+  }
+
+  /** Steps every search takes. */
+  int height() const
+  {
+    return height_;
+  }
+
+private:
+  void build(std::span<const T> sorted)
+  {
+    size_ = IndexInt(sorted.size());
+    height_ = int(std::bit_width(sorted.size()));
+
+    /* Node 0 is unused by the tree; its rank answers searches past the end. */
+    const size_t node_count = (size_t(1) << height_) - 1;
+    nodes_.resize(node_count + 1);
+    ranks_.resize(node_count + 1);
+    nodes_[0] = T();
+    ranks_[0] = size_;
+
+    build_subtree(sorted, 0, 1);
+  }
+
+  /** Fills node @p k's subtree in order from @p sorted[@p i], returns the next i. */
+  size_t build_subtree(std::span<const T> sorted, size_t i, size_t k)
+  {
+    if (k >= size_t(nodes_.size())) {
+      return i;
+    }
+
+    i = build_subtree(sorted, i, 2 * k);
+
+    if (i < sorted.size()) {
+      nodes_[IndexInt(k)] = sorted[i];
+      ranks_[IndexInt(k)] = IndexInt(i);
+    } else {
+      nodes_[IndexInt(k)] = padding();
+      ranks_[IndexInt(k)] = size_;
+    }
+    i++;
+
+    return build_subtree(sorted, i, 2 * k + 1);
+  }
+
+  /** Key of the padding nodes, not less than any real key. */
+  static T padding()
+  {
+    if constexpr (std::numeric_limits<T>::has_infinity) {
+      return std::numeric_limits<T>::infinity();
+    } else {
+      return std::numeric_limits<T>::max();
+    }
+  }
+
+  const void *descendants(size_t k) const
+  {
+    /* May point past the end, which prefetching tolerates. */
+    return reinterpret_cast<const void *>(uintptr_t(nodes_.data()) +
+                                          k * prefetch_stride * sizeof(T));
+  }
+
+  /**
+   * Undoes the right turns taken after the last left one: the node where
+   * the search last went left holds the answer, 0 if it never did.
+   */
+  static size_t finish(size_t k)
+  {
+    return k >> (std::countr_one(k) + 1);
+  }
+
+  Vector<T> nodes_;
+  Vector<IndexInt> ranks_;
+  IndexInt size_ = 0;
+  int height_ = 0;
+};
+} // namespace litestl::util
@@ -0,0 +1,260 @@
+#pragma once
+
+#include "alloc.h"
+#include "allocator.h"
+#include "compiler_util.h"
+#include "index_range.h"
+#include "vector.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <new>
+#include <span>
+#include <utility>
+
+namespace litestl::util {
+/**
+ * Dynamic array made of fixed-size chunks of @p chunk_size elements.
+ *
+ * Appending adds chunks instead of reallocating, so elements never move and
+ * pointers to them stay valid until they're removed.  Indexing goes through a
+ * chunk table: one shift, one mask and one extra load.
+ *
+ * Chunks are contiguous, loop over them for vectorizable inner loops:
+ *
+ *   for (int c : vec.chunk_range()) {
+ *     for (float &f : vec.chunk(c)) {
+ *       f *= 2.0f;
+ *     }
+ *   }
+ *
+ * chunk_range() can be handed to task::parallel_for as is, each task then
+ * gets whole chunks.
+ */
+template <typename T,
+          int chunk_size = 1024,
+          alloc::AllocatorPolicy Allocator = alloc::TaggedAllocator>
+class SegmentedVector {
+  static_assert(chunk_size > 0 && (chunk_size & (chunk_size - 1)) == 0,
+                "chunk_size must be a power of two");
+
+  static constexpr int chunk_shift = std::countr_zero(unsigned(chunk_size));
+  static constexpr size_t chunk_mask = size_t(chunk_size) - 1;
+
+public:
+  using value_type = T;
+  using allocator_type = Allocator;
+
+  template <typename QualVec, typename QualT> struct iterator_base {
+    iterator_base(QualVec &vec, size_t i) : vec_(vec), i_(i)
+    {
+    }
+
+    bool operator==(const iterator_base &b) const
+    {
+      return i_ == b.i_;
+    }
+    bool operator!=(const iterator_base &b) const
+    {
+      return i_ != b.i_;
+    }
+
+    QualT &operator*() const
+    {
+      return vec_[i_];
+    }
+
+    iterator_base &operator++()
+    {
+      i_++;
+      return *this;
+    }
+
+  private:
+    QualVec &vec_;
+    size_t i_;
+  };
+
+  using iterator = iterator_base<SegmentedVector, T>;
+  using const_iterator = iterator_base<const SegmentedVector, const T>;
+
+  SegmentedVector()
+  {
+  }
+
+  explicit SegmentedVector(const Allocator &allocator)
+      : chunks_(allocator), allocator_(allocator)
+  {
+  }
+
+  SegmentedVector(const SegmentedVector &b)
+      : chunks_(b.allocator_), allocator_(b.allocator_)
+  {
+    for (const T &value : b) {
+      append(value);
+    }
+  }
+
+  SegmentedVector(SegmentedVector &&b)
+      : chunks_(std::move(b.chunks_)), size_(b.size_), allocator_(b.allocator_)
+  {
+    b.size_ = 0;
+  }
+
+  DEFAULT_MOVE_ASSIGNMENT(SegmentedVector)
+
+  SegmentedVector &operator=(const SegmentedVector &b)
+  {
+    if (this != &b) {
+      clear();
+      for (const T &value : b) {
+        append(value);
+      }
+    }
+    return *this;
+  }
+
+  ~SegmentedVector()
+  {
+    clear();
+    for (T *chunk : chunks_) {
+      allocator_.deallocate(static_cast<void *>(chunk));
+    }
+  }
+
+  /** Appends an element constructed from @p args, returns a reference to it. */
+  template <typename... Args> T &grow_one(Args &&...args)
+  {
+    if ((size_ >> chunk_shift) == chunks_.size()) [[unlikely]] {
+      add_chunk();
+    }
+
+    T *elem = new (static_cast<void *>(slot(size_))) T(std::forward<Args>(args)...);
+    size_++;
+    return *elem;
+  }
+
+  void append(const T &value)
+  {
+    grow_one(value);
+  }
+
+  void append(T &&value)
+  {
+    grow_one(std::move(value));
+  }
+
+  T pop_back()
+  {
+    size_--;
+    T ret = std::move(*slot(size_));
+    if constexpr (!is_simple<T>()) {
+      slot(size_)->~T();
+    }
+    return ret;
+  }
+
+  /** Resizes to @p newsize elements, value-initializing new ones. */
+  void resize(size_t newsize)
+  {
+    if constexpr (!is_simple<T>()) {
+      for (size_t i = newsize; i < size_; i++) {
+        slot(i)->~T();
+      }
+    }
+
+    while (size_ < newsize) {
+      grow_one();
+    }
+    size_ = newsize;
+  }
+
+  /** Removes all elements, keeping the chunks for reuse. */
+  void clear()
+  {
+    resize(0);
+  }
+
+  T &operator[](size_t idx)
+  {
+    return *slot(idx);
+  }
+
+  const T &operator[](size_t idx) const
+  {
+    return *slot(idx);
+  }
+
+  T &last()
+  {
+    return *slot(size_ - 1);
+  }
+
+  size_t size() const
+  {
+    return size_;
+  }
+
+  /** Number of chunks holding elements. */
+  IndexInt chunk_count() const
+  {
+    return IndexInt((size_ + chunk_mask) >> chunk_shift);
+  }
+
+  /** Chunk indices, e.g. for task::parallel_for. */
+  IndexRange chunk_range() const
+  {
+    return IndexRange(chunk_count());
+  }
+
+  /** Elements of chunk @p chunk; only the last chunk may be partial. */
+  std::span<T> chunk(IndexInt chunk)
+  {
+    return std::span<T>(chunks_[chunk], chunk_length(chunk));
+  }
+
+  std::span<const T> chunk(IndexInt chunk) const
+  {
+    return std::span<const T>(chunks_[chunk], chunk_length(chunk));
+  }
+
+  iterator begin()
+  {
+    return iterator(*this, 0);
+  }
+  iterator end()
+  {
+    return iterator(*this, size_);
+  }
+  const_iterator begin() const
+  {
+    return const_iterator(*this, 0);
+  }
+  const_iterator end() const
+  {
+    return const_iterator(*this, size_);
+  }
+
+private:
+  flatten_inline T *slot(size_t idx) const
+  {
+    return chunks_[IndexInt(idx >> chunk_shift)] + (idx & chunk_mask);
+  }
+
+  size_t chunk_length(IndexInt chunk) const
+  {
+    return std::min(size_t(chunk_size), size_ - (size_t(chunk) << chunk_shift));
+  }
+
+  [[gnu::noinline]] void add_chunk()
+  {
+    chunks_.append(
+        alloc::allocate_array<T>(allocator_, "SegmentedVector chunk", chunk_size));
+  }
+
+  Vector<T *, 4, Allocator> chunks_;
+  size_t size_ = 0;
+  no_unique_addr Allocator allocator_;
+};
+} // namespace litestl::util
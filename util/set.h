@@ -1,42 +1,39 @@
 #pragma once
 
-#include "boolvector.h"
+#include "allocator.h"
 #include "compiler_util.h"
 #include "hash.h"
-#include "map.h"
-#include "vector.h"
+#include "hash_table.h"
 
-#include "hashtable_sizes.h"
 #include <cstdint>
-#include <span>
 
 namespace litestl::util {
 
 /**
- * Open-addressing hash set with quadratic probing.
+ * Open-addressing hash set, see detail::HashTable.
  *
- * Stores up to @p static_size_logical keys inline (actual table capacity
- * is roughly 4x to maintain load factor). Falls back to heap via alloc::alloc
- * when the element count exceeds the static capacity. Rehashes when more than
- * one-third of slots are occupied. Uses tombstones for deletion.
+ * Stores up to @p static_size_logical keys inline (the table inside the
+ * object is the next power of two above that, at least 16 slots). Falls back
+ * to heap via @p Allocator when it fills up, and grows by doubling whenever
+ * more than 7/8 of the slots are taken.
  */
 // cannot rely on pointer members forcibly aligning to 8
 // because of wasm
-template <typename Key, size_t static_size_logical = 4>
+template <typename Key,
+          size_t static_size_logical = 4,
+          alloc::AllocatorPolicy Allocator = alloc::TaggedAllocator>
 struct alignas(ContainerAlign<Key>()) Set {
   using key_type = Key;
-  static constexpr size_t static_size = static_size_logical * 4;
+  using allocator_type = Allocator;
+  /** Slots in the inline table. */
+  static constexpr size_t static_size = detail::hash_table::capacity_for(
+      static_size_logical, detail::hash_table::group_width);
 
   struct iterator {
     using key_type = Key;
 
-    iterator(const Set *set, int i) : set_(set), i_(i)
+    iterator(const Set *set, IndexInt i) : set_(set), i_(set->table_.next_full(i))
     {
-      if (i == 0) {
-        /* Prewind iterator to first key. */
-        i_--;
-        operator++();
-      }
     }
     iterator(const iterator &b) : set_(b.set_), i_(b.i_)
     {
@@ -53,294 +50,146 @@ struct alignas(ContainerAlign<Key>()) Set {
 
     const Key &operator*() const
     {
-      return set_->table_[i_];
+      return set_->table_.slot(i_);
     }
 
     iterator &operator++()
     {
-      i_++;
-
-      while (i_ < set_->table_.size() && !set_->usedmap_[i_]) {
-        i_++;
-      }
-
+      i_ = set_->table_.next_full(i_ + 1);
       return *this;
     }
 
   private:
     const Set *set_;
-    int i_;
+    IndexInt i_;
   };
 
   Set()
   {
-    realloc(hashsizes[find_hashsize_prev(static_size)]);
   }
 
-  Set(Set &&b)
-      : usedmap_(std::move(b.usedmap_)), cursize_(b.cursize_), size_(b.size_),
-        clearmap_(std::move(b.clearmap_)), max_size_(b.max_size_)
+  explicit Set(const Allocator &allocator) : table_(allocator)
   {
-    if (static_cast<const void *>(b.table_.data()) ==
-        static_cast<const void *>(b.static_storage_))
-    {
-      table_ = {reinterpret_cast<Key *>(static_storage_), b.table_.size()};
-
-      if constexpr (!is_simple<Key>()) {
-        for (int i = 0; i < b.table_.size(); i++) {
-          if (usedmap_[i]) {
-            new (static_cast<void *>(&table_[i])) Key(std::move(b.table_[i]));
-          }
-        }
-      } else {
-        memcpy(static_storage_, b.static_storage_, sizeof(static_storage_));
-      }
-    } else {
-      table_ = b.table_;
-    }
-
-    b.table_ = nullptr;
-    b.size_ = 0;
   }
 
-  Set(const Set &b)
-      : usedmap_(b.usedmap_), clearmap_(b.clearmap_), cursize_(b.cursize_),
-        size_(b.size_), max_size_(b.max_size_)
-  {
-    if (static_cast<const void *>(b.table_.data()) ==
-        static_cast<const void *>(b.static_storage_))
-    {
-      table_ = {reinterpret_cast<Key *>(static_storage_), b.table_.size()};
-    } else {
-      table_ = {
-          static_cast<Key *>(alloc::alloc("Set table", sizeof(Key) * b.table_.size())),
-          b.table_.size()};
-    }
-
-    if constexpr (!is_simple<Key>()) {
-      for (int i = 0; i < b.table_.size(); i++) {
-        if (usedmap_[i]) {
-          new (static_cast<void *>(&table_[i])) Key(b.table_[i]);
-        }
-      }
-    } else {
-      memcpy(static_cast<void *>(table_.data()),
-             static_cast<void *>(b.table_.data()),
-             sizeof(Key) * b.table_.size());
-    }
-  }
+  Set(Set &&b) = default;
+  Set(const Set &b) = default;
 
-  ~Set()
+  const Allocator &get_allocator() const
   {
-    if constexpr (!is_simple<Key>()) {
-      for (int i = 0; i < table_.size(); i++) {
-        if (usedmap_[i]) {
-          table_[i].~Key();
-        }
-      }
-    }
-
-    if (static_cast<void *>(table_.data()) != static_cast<void *>(static_storage_)) {
-      alloc::release(static_cast<void *>(table_.data()));
-    }
+    return table_.get_allocator();
   }
 
   DEFAULT_MOVE_ASSIGNMENT(Set)
   DEFAULT_COPY_ASSIGNMENT(Set)
 
-  iterator begin()
+  iterator begin() const
   {
     return iterator(this, 0);
   }
-  iterator end()
+  iterator end() const
   {
-    return iterator(this, table_.size());
+    return iterator(this, IndexInt(table_.capacity()));
   }
 
   /** Inserts @p key if not already present. Returns true if inserted, false
    * if the key already existed. */
   bool add(const Key &key)
   {
-    check_capacity();
+    auto [i, found] = table_.find_or_prepare_insert(key);
 
-    int first_clearcell = -1;
-    int i = find_cell(key, first_clearcell);
-
-    if (!usedmap_[i]) {
-      // if we hit a clear cell in the chain, use it
-      // and clear it's clearcell bit.
-      if (first_clearcell != -1) {
-        i = first_clearcell;
-        clearmap_.set(first_clearcell, false);
-      }
+    if (found) {
+      return false;
+    }
 
-      usedmap_.set(i, true);
-      table_[i] = key;
+    new (static_cast<void *>(&table_.slot(i))) Key(key);
+    return true;
+  }
 
-      size_++;
+  /**
+   * Searches with @p key as is (see hash::is_transparent) and converts it to a
+   * Key only when inserting.
+   */
+  template <detail::hash_table::TransparentKey<Key> K> bool add(const K &key)
+  {
+    const auto &k = detail::hash_table::lookup_key(key);
+    auto [i, found] = table_.find_or_prepare_insert(k);
 
-      return true;
+    if (found) {
+      return false;
     }
 
-    return false;
+    new (static_cast<void *>(&table_.slot(i))) Key(k);
+    return true;
   }
 
   /** Removes @p key from the set. Returns true if the key was found and removed. */
   bool remove(const Key &key)
   {
-    int first_clearcell = -1;
-    int i = find_cell(key, first_clearcell);
-
-    if (usedmap_[i]) {
-      table_[i].~Key();
-      size_--;
-      usedmap_.set(i, false);
-      clearmap_.set(i, true);
-
-      return true;
-    }
-
-    return false;
+    return remove_at(table_.find(key));
   }
 
-  /** Returns true if @p key is present in the set. */
-  bool contains(const Key &key) const
+  /** remove() without converting @p key, see contains(). */
+  template <detail::hash_table::TransparentKey<Key> K> bool remove(const K &key)
   {
-    int first_clearcell = -1;
-    int i = find_cell(key, first_clearcell);
-    return usedmap_[i];
+    return remove_at(table_.find(detail::hash_table::lookup_key(key)));
   }
 
-  /** Alias for contains(). */
-  bool operator[](const Key &key) const
+  /** Returns true if @p key is present in the set. */
+  bool contains(const Key &key) const
   {
-    return contains(key);
+    return table_.find(key) != -1;
   }
 
-  /** Returns the number of entries currently in the set. */
-  size_t size()
+  /**
+   * contains() for a @p key of another type that hashes and compares like Key,
+   * such as a stringref in a Set<string>, without converting it.
+   */
+  template <detail::hash_table::TransparentKey<Key> K> bool contains(const K &key) const
   {
-    return size_;
+    return table_.find(detail::hash_table::lookup_key(key)) != -1;
   }
 
-  /** Removes all entries from the set, destructing non-trivial keys. */
-  Set &clear()
+  /** Alias for contains(). */
+  bool operator[](const Key &key) const
   {
-    if constexpr (!is_simple<Key>()) {
-      int size = table_.size();
-      for (int i = 0; i < size; i++) {
-        if (!(usedmap_[i])) {
-          continue;
-        }
-
-        table_[i].~Key();
-      }
-    }
-
-    size_ = 0;
-    usedmap_.clear();
-    return *this;
+    return contains(key);
   }
-
-private:
-  void check_capacity()
+  template <detail::hash_table::TransparentKey<Key> K> bool operator[](const K &key) const
   {
-    if (size_ + 1 >= max_size_) {
-      realloc((max_size_ + 1) * 9);
-    }
+    return contains(key);
   }
 
-  int find_cell(const Key &key, int &first_clearcell) const
+  /** Returns the number of entries currently in the set. */
+  size_t size() const
   {
-    return const_cast<Set *>(this)->find_cell<false>(key, first_clearcell);
+    return table_.size();
   }
 
-  template <bool realloc_clearcells = true>
-  int find_cell(const Key &key, int &first_clearcell)
+  /** Pre-allocates table capacity for at least @p size keys. */
+  void reserve(size_t size)
   {
-    const hash::HashInt size = hash::HashInt(table_.size());
-    hash::HashInt hashval = hash::hash(key) % size;
-    hash::HashInt h = hashval, probe = hashval;
-
-    int count = 0;
-    while (1) {
-      if (count > size) {
-        // clearcell chain is full
-        if constexpr (realloc_clearcells) {
-          clear_clearcell();
-        }
-        return find_cell<realloc_clearcells>(key, first_clearcell);
-      }
-      // hit free cell?
-      if (!usedmap_[h]) {
-        // was this cell previously cleared? if so keep looking
-        if (clearmap_[h]) {
-          first_clearcell = h;
-        } else {
-          return h;
-        }
-      } else if (table_[h] == key) {
-        return h;
-      }
-
-      probe++;
-      hashval += probe;
-      h = hashval % size;
-      count++;
-    }
+    table_.reserve(size);
   }
 
-  void clear_clearcell()
+  /** Removes all entries from the set, destructing non-trivial keys. */
+  Set &clear()
   {
-    realloc(table_.size());
+    table_.clear();
+    return *this;
   }
 
-  void realloc(size_t size)
+private:
+  bool remove_at(IndexInt i)
   {
-    cursize_ = find_hashsize(size);
-    size = hashsizes[cursize_];
-
-    std::span<Key> old = table_;
-    BoolVector<> usedmap_old = usedmap_;
-
-    if (size < static_size) {
-      table_ = {reinterpret_cast<Key *>(static_storage_), size};
-    } else {
-      table_ = {static_cast<Key *>(alloc::alloc("Set table", sizeof(Key) * size)), size};
+    if (i == -1) {
+      return false;
     }
 
-    max_size_ = size / 3;
-    usedmap_.resize(size);
-    usedmap_.clear();
-    clearmap_.resize(size);
-    clearmap_.clear();
-
-    int oldsize = old.size();
-    for (int i = 0; i < oldsize; i++) {
-      if (!(usedmap_old[i])) {
-        continue;
-      }
-
-      int first_clearcell = -1;
-      int new_i = find_cell(old[i], first_clearcell);
-      table_[new_i] = std::move(old[i]);
-      usedmap_.set(new_i, true);
-
-      if constexpr (!is_simple<Key>()) {
-        old[i].~Key();
-      }
-    }
-
-    if (old.data() && old.data() != reinterpret_cast<Key *>(static_storage_)) {
-      alloc::release(static_cast<void *>(old.data()));
-    }
+    table_.erase(i);
+    return true;
   }
 
-  std::span<Key> table_;
-  int cursize_ = 0;                /* index into hashsizes[] */
-  size_t size_ = 0, max_size_ = 0; /* hashsizes[cursize_]*3 */
-  char static_storage_[sizeof(Key) * static_size];
-  BoolVector<> usedmap_;
-  BoolVector<> clearmap_;
+  detail::HashTable<Key, Key, static_size, Allocator> table_;
 };
 } // namespace litestl::util
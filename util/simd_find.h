@@ -0,0 +1,411 @@
+#pragma once
+
+#include "compiler_util.h"
+#include "index_range.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define LITESTL_SIMD_FIND_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LITESTL_SIMD_FIND_SSE2
+#endif
+
+/*
+ * Vectorized linear search for the equality scans in Vector (index_of,
+ * contains, count, find_all).
+ *
+ * Covers integers, enums, pointers, floats, doubles and small vectors of
+ * those with `value_type` and `size` members (math::Vec), as long as the
+ * element is 1, 2, 4 or 8 bytes.  Each step compares one register of
+ * elements: as integers of the element's size for integer-like types, as
+ * floats for float-like ones so that -0.0 == 0.0 and NaN != NaN as with
+ * operator==.  Larger elements (float3, float4, ...) compare faster with
+ * operator==, which usually fails on the first component, and use plain
+ * loops.
+ *
+ * Uses AVX2 when the compiler targets it (-mavx2 or -march=...), else SSE2 on
+ * x86, else plain loops.
+ */
+namespace litestl::util::simd {
+namespace detail {
+enum class CompareKind { Scalar, Bytes, Float, Double };
+
+template <typename T> struct Component {
+  using type = T;
+};
+
+template <typename T>
+  requires requires {
+    typename T::value_type;
+    T::size;
+  }
+struct Component<T> {
+  using type = std::conditional_t<sizeof(T) == sizeof(typename T::value_type) * T::size,
+                                  typename T::value_type,
+                                  void>;
+};
+
+template <typename T> static constexpr CompareKind compare_kind()
+{
+  using C = typename Component<T>::type;
+
+  if constexpr (!util::is_simple<T>() || !std::has_single_bit(sizeof(T)) ||
+                sizeof(T) > 8) {
+    return CompareKind::Scalar;
+  } else if constexpr (std::is_same_v<C, float>) {
+    return CompareKind::Float;
+  } else if constexpr (std::is_same_v<C, double>) {
+    return CompareKind::Double;
+  } else if constexpr (std::is_integral_v<C> || std::is_enum_v<C> ||
+                       std::is_pointer_v<C>) {
+    return CompareKind::Bytes;
+  } else {
+    return CompareKind::Scalar;
+  }
+}
+
+#if defined(LITESTL_SIMD_FIND_AVX2)
+static constexpr size_t register_bytes = 32;
+using Register = __m256i;
+#elif defined(LITESTL_SIMD_FIND_SSE2)
+static constexpr size_t register_bytes = 16;
+using Register = __m128i;
+#else
+static constexpr size_t register_bytes = 0;
+
+/* Only named in branches is_vectorized() discards on this target. */
+template <typename T> struct Matcher;
+#endif
+
+#if defined(LITESTL_SIMD_FIND_AVX2) || defined(LITESTL_SIMD_FIND_SSE2)
+/** Compares a register of elements at a time against copies of one value. */
+template <typename T> struct Matcher {
+  static constexpr CompareKind kind = compare_kind<T>();
+  static constexpr size_t per_register = register_bytes / sizeof(T);
+
+  /** Element i of a register is bit i * bit_stride of bits(). */
+  static constexpr int bit_stride = sizeof(T) == 2 ? 2 : 1;
+
+  /** Registers count() can add up before a lane may overflow. */
+  static constexpr size_t count_chunk = sizeof(T) == 1   ? 255
+                                        : sizeof(T) == 2 ? 65535
+                                                         : size_t(1) << 31;
+
+  using Lane = std::conditional_t<
+      sizeof(T) == 1,
+      uint8_t,
+      std::conditional_t<sizeof(T) == 2,
+                         uint16_t,
+                         std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>>>;
+
+  explicit Matcher(const T &value)
+  {
+    alignas(32) unsigned char bytes[register_bytes];
+    for (size_t i = 0; i < register_bytes; i += sizeof(T)) {
+      memcpy(bytes + i, &value, sizeof(T));
+    }
+    pattern_ = load(bytes);
+  }
+
+  /** All bits of each element set where it matches, clear elsewhere. */
+  Register eq(const T *data) const
+  {
+    const Register reg = load(data);
+    Register eq;
+
+#if defined(LITESTL_SIMD_FIND_AVX2)
+    if constexpr (kind == CompareKind::Float) {
+      eq = _mm256_castps_si256(_mm256_cmp_ps(
+          _mm256_castsi256_ps(reg), _mm256_castsi256_ps(pattern_), _CMP_EQ_OQ));
+    } else if constexpr (kind == CompareKind::Double) {
+      eq = _mm256_castpd_si256(_mm256_cmp_pd(
+          _mm256_castsi256_pd(reg), _mm256_castsi256_pd(pattern_), _CMP_EQ_OQ));
+    } else if constexpr (sizeof(T) == 1) {
+      eq = _mm256_cmpeq_epi8(reg, pattern_);
+    } else if constexpr (sizeof(T) == 2) {
+      eq = _mm256_cmpeq_epi16(reg, pattern_);
+    } else if constexpr (sizeof(T) == 4) {
+      eq = _mm256_cmpeq_epi32(reg, pattern_);
+    } else {
+      eq = _mm256_cmpeq_epi64(reg, pattern_);
+    }
+
+    /* Pairs of floats (float2): both halves must match. */
+    if constexpr (kind == CompareKind::Float && sizeof(T) == 8) {
+      eq = _mm256_and_si256(eq, _mm256_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+    }
+#else
+    if constexpr (kind == CompareKind::Float) {
+      eq = _mm_castps_si128(
+          _mm_cmpeq_ps(_mm_castsi128_ps(reg), _mm_castsi128_ps(pattern_)));
+    } else if constexpr (kind == CompareKind::Double) {
+      eq = _mm_castpd_si128(
+          _mm_cmpeq_pd(_mm_castsi128_pd(reg), _mm_castsi128_pd(pattern_)));
+    } else if constexpr (sizeof(T) == 1) {
+      eq = _mm_cmpeq_epi8(reg, pattern_);
+    } else if constexpr (sizeof(T) == 2) {
+      eq = _mm_cmpeq_epi16(reg, pattern_);
+    } else {
+      eq = _mm_cmpeq_epi32(reg, pattern_);
+    }
+
+    /* SSE2 has no 64 bit compare: both 32 bit halves must match. */
+    if constexpr (sizeof(T) == 8 && kind != CompareKind::Double) {
+      eq = _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+    }
+#endif
+
+    return eq;
+  }
+
+  /** Element match bits of an eq() result, see bit_stride. */
+  static uint32_t bits(Register eq)
+  {
+#if defined(LITESTL_SIMD_FIND_AVX2)
+    if constexpr (sizeof(T) == 4) {
+      return uint32_t(_mm256_movemask_ps(_mm256_castsi256_ps(eq)));
+    } else if constexpr (sizeof(T) == 8) {
+      return uint32_t(_mm256_movemask_pd(_mm256_castsi256_pd(eq)));
+    } else {
+      return uint32_t(_mm256_movemask_epi8(eq)) & (sizeof(T) == 2 ? 0x55555555u : ~0u);
+    }
+#else
+    if constexpr (sizeof(T) == 4) {
+      return uint32_t(_mm_movemask_ps(_mm_castsi128_ps(eq)));
+    } else if constexpr (sizeof(T) == 8) {
+      return uint32_t(_mm_movemask_pd(_mm_castsi128_pd(eq)));
+    } else {
+      return uint32_t(_mm_movemask_epi8(eq)) & (sizeof(T) == 2 ? 0x5555u : ~0u);
+    }
+#endif
+  }
+
+  /** True if any element of an eq() result (or several OR'ed) matched. */
+  static bool any(Register eq)
+  {
+#if defined(LITESTL_SIMD_FIND_AVX2)
+    return _mm256_movemask_epi8(eq) != 0;
+#else
+    return _mm_movemask_epi8(eq) != 0;
+#endif
+  }
+
+  static Register any_of(Register a, Register b, Register c, Register d)
+  {
+#if defined(LITESTL_SIMD_FIND_AVX2)
+    return _mm256_or_si256(_mm256_or_si256(a, b), _mm256_or_si256(c, d));
+#else
+    return _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+#endif
+  }
+
+  static Register zero()
+  {
+#if defined(LITESTL_SIMD_FIND_AVX2)
+    return _mm256_setzero_si256();
+#else
+    return _mm_setzero_si128();
+#endif
+  }
+
+  /** Adds one to the lanes of @p acc whose element matched (eq() is -1 there). */
+  static Register accumulate(Register acc, Register eq)
+  {
+#if defined(LITESTL_SIMD_FIND_AVX2)
+    if constexpr (sizeof(T) == 1) {
+      return _mm256_sub_epi8(acc, eq);
+    } else if constexpr (sizeof(T) == 2) {
+      return _mm256_sub_epi16(acc, eq);
+    } else if constexpr (sizeof(T) == 4) {
+      return _mm256_sub_epi32(acc, eq);
+    } else {
+      return _mm256_sub_epi64(acc, eq);
+    }
+#else
+    if constexpr (sizeof(T) == 1) {
+      return _mm_sub_epi8(acc, eq);
+    } else if constexpr (sizeof(T) == 2) {
+      return _mm_sub_epi16(acc, eq);
+    } else if constexpr (sizeof(T) == 4) {
+      return _mm_sub_epi32(acc, eq);
+    } else {
+      return _mm_sub_epi64(acc, eq);
+    }
+#endif
+  }
+
+  /** Sum of the lanes of an accumulate() result. */
+  static size_t total(Register acc)
+  {
+    alignas(32) Lane lanes[per_register];
+    memcpy(lanes, &acc, sizeof(lanes));
+
+    size_t sum = 0;
+    for (Lane lane : lanes) {
+      sum += lane;
+    }
+    return sum;
+  }
+
+private:
+  static Register load(const void *ptr)
+  {
+#if defined(LITESTL_SIMD_FIND_AVX2)
+    return _mm256_loadu_si256(static_cast<const __m256i *>(ptr));
+#else
+    return _mm_loadu_si128(static_cast<const __m128i *>(ptr));
+#endif
+  }
+
+  Register pattern_;
+};
+#endif
+
+/** Scalar equality with the same semantics as Matcher, for tails. */
+template <typename T> static bool equal(const T &a, const T &b)
+{
+  using C = typename Component<T>::type;
+  constexpr CompareKind kind = compare_kind<T>();
+
+  if constexpr (kind == CompareKind::Bytes) {
+    return memcmp(&a, &b, sizeof(T)) == 0;
+  } else if constexpr (kind == CompareKind::Float || kind == CompareKind::Double) {
+    const C *ca = reinterpret_cast<const C *>(&a);
+    const C *cb = reinterpret_cast<const C *>(&b);
+    for (size_t i = 0; i < sizeof(T) / sizeof(C); i++) {
+      if (!(ca[i] == cb[i])) {
+        return false;
+      }
+    }
+    return true;
+  } else {
+    return a == b;
+  }
+}
+} // namespace detail
+
+/** True when find, count and friends use SIMD for @p T. */
+template <typename T> static constexpr bool is_vectorized()
+{
+  return detail::register_bytes != 0 &&
+         detail::compare_kind<T>() != detail::CompareKind::Scalar;
+}
+
+/** Index of the first element equal to @p value, -1 if there is none. */
+template <typename T> IndexInt find(std::span<const T> items, const T &value)
+{
+  const T *data = items.data();
+  const size_t size = items.size();
+  size_t i = 0;
+
+  if constexpr (is_vectorized<T>()) {
+    using Matcher = detail::Matcher<T>;
+    const Matcher matcher(value);
+    constexpr size_t step = Matcher::per_register;
+
+    /* Four registers per iteration, checked with one branch. */
+    for (; i + step * 4 <= size; i += step * 4) {
+      const auto any = Matcher::any_of(matcher.eq(data + i),
+                                       matcher.eq(data + i + step),
+                                       matcher.eq(data + i + step * 2),
+                                       matcher.eq(data + i + step * 3));
+      if (Matcher::any(any)) [[unlikely]] {
+        break;
+      }
+    }
+
+    for (; i + step <= size; i += step) {
+      if (const uint32_t bits = Matcher::bits(matcher.eq(data + i))) {
+        return IndexInt(i + size_t(std::countr_zero(bits) / Matcher::bit_stride));
+      }
+    }
+  }
+
+  for (; i < size; i++) {
+    if (detail::equal(data[i], value)) {
+      return IndexInt(i);
+    }
+  }
+  return -1;
+}
+
+/** Number of elements equal to @p value. */
+template <typename T> size_t count(std::span<const T> items, const T &value)
+{
+  const T *data = items.data();
+  const size_t size = items.size();
+  size_t i = 0, total = 0;
+
+  if constexpr (is_vectorized<T>()) {
+    using Matcher = detail::Matcher<T>;
+    const Matcher matcher(value);
+    constexpr size_t step = Matcher::per_register;
+
+    /* Counts per lane, emptied before they can wrap around. */
+    while (i + step <= size) {
+      const size_t registers = std::min((size - i) / step, Matcher::count_chunk);
+      auto acc = Matcher::zero();
+
+      for (size_t r = 0; r < registers; r++, i += step) {
+        acc = Matcher::accumulate(acc, matcher.eq(data + i));
+      }
+      total += Matcher::total(acc);
+    }
+  }
+
+  for (; i < size; i++) {
+    total += detail::equal(data[i], value);
+  }
+  return total;
+}
+
+/** Calls @p fn(index) for every element equal to @p value, in order. */
+template <typename T, typename Fn>
+void for_each_match(std::span<const T> items, const T &value, Fn fn)
+{
+  const T *data = items.data();
+  const size_t size = items.size();
+  size_t i = 0;
+
+  if constexpr (is_vectorized<T>()) {
+    using Matcher = detail::Matcher<T>;
+    const Matcher matcher(value);
+    constexpr size_t step = Matcher::per_register;
+
+    for (; i + step <= size; i += step) {
+      for (uint32_t bits = Matcher::bits(matcher.eq(data + i)); bits; bits &= bits - 1) {
+        fn(IndexInt(i + size_t(std::countr_zero(bits) / Matcher::bit_stride)));
+      }
+    }
+  }
+
+  for (; i < size; i++) {
+    if (detail::equal(data[i], value)) {
+      fn(IndexInt(i));
+    }
+  }
+}
+
+/**
+ * Sets bit i % 64 of @p r_mask[i / 64] when items[i] equals @p value and
+ * clears it otherwise.  @p r_mask needs (items.size() + 63) / 64 words.
+ */
+template <typename T>
+void find_mask(std::span<const T> items, const T &value, std::span<uint64_t> r_mask)
+{
+  memset(r_mask.data(), 0, sizeof(uint64_t) * ((items.size() + 63) / 64));
+
+  for_each_match(items, value, [&](IndexInt i) {
+    r_mask[size_t(i) / 64] |= uint64_t(1) << (size_t(i) % 64);
+  });
+}
+} // namespace litestl::util::simd
@@ -0,0 +1,312 @@
+#pragma once
+
+#include "alloc.h"
+#include "allocator.h"
+#include "compiler_util.h"
+#include "index_range.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace litestl::util {
+/**
+ * Dynamic array that keeps each field of its elements in a separate
+ * contiguous column (structure of arrays), so loops that read one field only
+ * pull that field through the cache:
+ *
+ *   SoAVector<float3, float3, int> points; // position, normal, flags
+ *   points.append(co, no, 0);
+ *
+ *   for (float3 &co : points.column<0>()) {
+ *     co *= 2.0f;
+ *   }
+ *
+ *   auto [co, no, flag] = points[i]; // row of references
+ *
+ * All columns share one size and capacity and live in a single allocation,
+ * each starting on its own cache line, so growing reallocates them together.
+ *
+ * The field list takes the trailing template parameters, so the allocation
+ * policy comes first: SoAVector is BasicSoAVector with alloc::TaggedAllocator.
+ */
+template <alloc::AlignedAllocatorPolicy Allocator, typename... Fields>
+class BasicSoAVector {
+  static_assert(sizeof...(Fields) > 0, "SoAVector needs at least one field");
+  static_assert(((alignof(Fields) <= 64) && ...),
+                "SoAVector fields are at most 64 byte aligned");
+
+  static constexpr size_t column_align = 64;
+  using Indices = std::index_sequence_for<Fields...>;
+
+public:
+  static constexpr size_t field_count = sizeof...(Fields);
+
+  template <size_t I> using field_type = std::tuple_element_t<I, std::tuple<Fields...>>;
+
+  /** References to the fields of one element. */
+  using Row = std::tuple<Fields &...>;
+  using ConstRow = std::tuple<const Fields &...>;
+  using allocator_type = Allocator;
+
+  BasicSoAVector()
+  {
+  }
+
+  explicit BasicSoAVector(const Allocator &allocator) : allocator_(allocator)
+  {
+  }
+
+  BasicSoAVector(const BasicSoAVector &b) : allocator_(b.allocator_)
+  {
+    copy_from(b);
+  }
+
+  BasicSoAVector(BasicSoAVector &&b) noexcept
+      : columns_(b.columns_),
+        size_(b.size_),
+        capacity_(b.capacity_),
+        allocator_(std::move(b.allocator_))
+  {
+    b.columns_ = {};
+    b.size_ = b.capacity_ = 0;
+  }
+
+  DEFAULT_MOVE_ASSIGNMENT(BasicSoAVector)
+
+  BasicSoAVector &operator=(const BasicSoAVector &b)
+  {
+    if (this != &b) {
+      clear();
+      copy_from(b);
+    }
+    return *this;
+  }
+
+  ~BasicSoAVector()
+  {
+    clear();
+    if (capacity_) {
+      allocator_.deallocate(static_cast<void *>(std::get<0>(columns_)));
+    }
+  }
+
+  void append(const Fields &...values)
+  {
+    ensure_capacity(size_ + 1);
+    construct_row(size_, Indices(), values...);
+    size_++;
+  }
+
+  void append(Fields &&...values)
+  {
+    ensure_capacity(size_ + 1);
+    construct_row(size_, Indices(), std::move(values)...);
+    size_++;
+  }
+
+  /** Appends a value-initialized element and returns its row. */
+  Row grow_one()
+  {
+    ensure_capacity(size_ + 1);
+    construct_row(size_, Indices());
+    return (*this)[IndexInt(size_++)];
+  }
+
+  /** Removes the last element and returns its fields. */
+  std::tuple<Fields...> pop_back()
+  {
+    size_--;
+    std::tuple<Fields...> ret = take_row(size_, Indices());
+    destruct(size_, size_ + 1);
+    return ret;
+  }
+
+  /** Resizes to @p newsize elements, value-initializing new ones. */
+  void resize(size_t newsize)
+  {
+    if (newsize < size_) {
+      destruct(newsize, size_);
+    } else {
+      ensure_capacity(newsize);
+      for (size_t i = size_; i < newsize; i++) {
+        construct_row(i, Indices());
+      }
+    }
+
+    size_ = newsize;
+  }
+
+  /** Makes room for @p size elements in every column. */
+  void ensure_capacity(size_t size)
+  {
+    if (size > capacity_) [[unlikely]] {
+      reallocate(std::max({size, capacity_ * 2, size_t(16)}));
+    }
+  }
+
+  /** Destroys all elements, keeping the memory for reuse. */
+  void clear()
+  {
+    destruct(0, size_);
+    size_ = 0;
+  }
+
+  Row operator[](IndexInt idx)
+  {
+    return row<Row>(*this, size_t(idx), Indices());
+  }
+
+  ConstRow operator[](IndexInt idx) const
+  {
+    return row<ConstRow>(*this, size_t(idx), Indices());
+  }
+
+  /** Field @p I of all elements, contiguous. */
+  template <size_t I> std::span<field_type<I>> column()
+  {
+    return std::span<field_type<I>>(std::get<I>(columns_), size_);
+  }
+
+  template <size_t I> std::span<const field_type<I>> column() const
+  {
+    return std::span<const field_type<I>>(std::get<I>(columns_), size_);
+  }
+
+  /** Element indices, e.g. for task::parallel_for. */
+  IndexRange index_range() const
+  {
+    return IndexRange(IndexInt(size_));
+  }
+
+  size_t size() const
+  {
+    return size_;
+  }
+
+  size_t capacity() const
+  {
+    return capacity_;
+  }
+
+  const Allocator &get_allocator() const
+  {
+    return allocator_;
+  }
+
+private:
+  template <typename F> static size_t column_bytes(size_t capacity)
+  {
+    return (sizeof(F) * capacity + column_align - 1) & ~(column_align - 1);
+  }
+
+  /** Calls @p fn with std::integral_constant<size_t, I> for every field I. */
+  template <typename Fn> static void for_each_field(Fn fn)
+  {
+    [&]<size_t... Is>(std::index_sequence<Is...>) {
+      (fn(std::integral_constant<size_t, Is>()), ...);
+    }(Indices());
+  }
+
+  template <typename RowT, typename Self, size_t... Is>
+  static RowT row(Self &self, size_t idx, std::index_sequence<Is...>)
+  {
+    return RowT(std::get<Is>(self.columns_)[idx]...);
+  }
+
+  template <size_t... Is, typename... Args>
+  void construct_row(size_t idx, std::index_sequence<Is...>, Args &&...args)
+  {
+    if constexpr (sizeof...(Args) == 0) {
+      (new (static_cast<void *>(std::get<Is>(columns_) + idx)) Fields(), ...);
+    } else {
+      (new (static_cast<void *>(std::get<Is>(columns_) + idx))
+           Fields(std::forward<Args>(args)),
+       ...);
+    }
+  }
+
+  template <size_t... Is>
+  std::tuple<Fields...> take_row(size_t idx, std::index_sequence<Is...>)
+  {
+    return std::tuple<Fields...>(std::move(std::get<Is>(columns_)[idx])...);
+  }
+
+  void destruct(size_t start, size_t end)
+  {
+    for_each_field([&](auto I) {
+      using F = field_type<I>;
+      if constexpr (!is_simple<F>()) {
+        std::destroy(std::get<I>(columns_) + start, std::get<I>(columns_) + end);
+      }
+    });
+  }
+
+  void copy_from(const BasicSoAVector &b)
+  {
+    ensure_capacity(b.size_);
+    for_each_field([&](auto I) {
+      using F = field_type<I>;
+      if constexpr (is_simple<F>()) {
+        memcpy(static_cast<void *>(std::get<I>(columns_)),
+               static_cast<const void *>(std::get<I>(b.columns_)),
+               sizeof(F) * b.size_);
+      } else {
+        std::uninitialized_copy_n(
+            std::get<I>(b.columns_), b.size_, std::get<I>(columns_));
+      }
+    });
+    size_ = b.size_;
+  }
+
+  /** Moves every column into one new block with room for @p capacity elements. */
+  [[gnu::noinline]] void reallocate(size_t capacity)
+  {
+    size_t total = 0;
+    for_each_field([&](auto I) { total += column_bytes<field_type<I>>(capacity); });
+
+    char *block = static_cast<char *>(
+        allocator_.allocate_aligned("SoAVector data", total, column_align));
+    void *old_block = capacity_ ? static_cast<void *>(std::get<0>(columns_)) : nullptr;
+
+    for_each_field([&](auto I) {
+      using F = field_type<I>;
+      F *&column = std::get<I>(columns_);
+      F *new_column = reinterpret_cast<F *>(block);
+
+      if constexpr (is_simple<F>()) {
+        if (size_) {
+          memcpy(static_cast<void *>(new_column),
+                 static_cast<void *>(column),
+                 sizeof(F) * size_);
+        }
+      } else {
+        std::uninitialized_move_n(column, size_, new_column);
+        std::destroy_n(column, size_);
+      }
+
+      column = new_column;
+      block += column_bytes<F>(capacity);
+    });
+
+    if (old_block) {
+      allocator_.deallocate(old_block);
+    }
+    capacity_ = capacity;
+  }
+
+  std::tuple<Fields *...> columns_ = {};
+  size_t size_ = 0;
+  size_t capacity_ = 0;
+  no_unique_addr Allocator allocator_;
+};
+
+template <typename... Fields>
+using SoAVector = BasicSoAVector<alloc::TaggedAllocator, Fields...>;
+} // namespace litestl::util
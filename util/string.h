@@ -8,11 +8,15 @@
 #include <utility>
 
 #include "util/alloc.h"
+#include "util/allocator.h"
 #include "util/compiler_util.h"
 
 namespace litestl::util {
 // reserve enough space for a guid
-template <typename Char, int static_size = 40> struct String;
+template <typename Char,
+          int static_size = 40,
+          alloc::AllocatorPolicy Allocator = alloc::TaggedAllocator>
+struct String;
 
 template <size_t N> struct StrLiteral {
   constexpr StrLiteral(const char (&str)[N])
@@ -139,6 +143,10 @@ template <typename Char> struct StringRef {
   StringRef(const char *c) : data_(c), size_(strlen(c))
   {
   }
+  /** The first @p size characters of @p c, which need not be null-terminated. */
+  StringRef(const char *c, size_t size) : data_(c), size_(int(size))
+  {
+  }
   StringRef(const StringRef &b) : data_(b.data_), size_(b.size_)
   {
   }
@@ -190,32 +198,31 @@ template <typename Char> struct StringRef {
     return size_;
   }
 
-  bool operator==(StringRef &b) const
-  {
-    return detail::strcmp(data_, b.data_);
-  }
-
-  bool operator!=(StringRef &b) const
-  {
-    return !operator==(b);
-  }
-
 private:
   const char *data_ = nullptr;
   int size_ = 0;
 };
 
-template <typename Char, int static_size> class alignas(8) String {
+template <typename Char, int static_size, alloc::AllocatorPolicy Allocator>
+class alignas(8) String {
 public:
+  using allocator_type = Allocator;
+
   String() : size_(0)
   {
     data_ = static_storage_;
     data_[0] = 0;
   }
 
+  explicit String(const Allocator &allocator) : size_(0), allocator_(allocator)
+  {
+    data_ = static_storage_;
+    data_[0] = 0;
+  }
+
   operator StringRef<Char>() const
   {
-    return StringRef<Char>(data_);
+    return StringRef<Char>(data_, size_t(size_));
   }
 
   template <size_t N> String(StrLiteral<N> lit)
@@ -230,7 +237,7 @@ public:
     data_[N] = 0;
   }
 
-  ATTR_NO_OPT String(const String &b)
+  ATTR_NO_OPT String(const String &b) : allocator_(b.allocator_)
   {
     data_ = static_storage_;
 
@@ -248,7 +255,7 @@ public:
     }
   }
 
-  String(String &&b)
+  String(String &&b) : allocator_(b.allocator_)
   {
     size_ = b.size_;
 
@@ -295,10 +302,15 @@ public:
   ~String()
   {
     if (data_ && data_ != static_storage_) {
-      alloc::release(static_cast<void *>(data_));
+      allocator_.deallocate(static_cast<void *>(data_));
     }
   }
 
+  const Allocator &get_allocator() const
+  {
+    return allocator_;
+  }
+
   String(const char *str)
   {
     data_ = static_storage_;
@@ -314,9 +326,20 @@ public:
     data_[len] = 0;
   }
 
+  /** Copies the characters of @p ref, which need not be null-terminated. */
   String(const StringRef<Char> &ref)
   {
-    String(ref.c_str());
+    data_ = static_storage_;
+    size_ = 0;
+    const int len = int(ref.size());
+
+    ensure_size(len);
+    size_ = len;
+
+    for (int i = 0; i < len; i++) {
+      data_[i] = ref[i];
+    }
+    data_[len] = 0;
   }
 
   const char *c_str() const
@@ -347,6 +370,20 @@ public:
     return true;
   }
 
+  /** Compares characters, without building a String from @p b. */
+  bool operator==(const StringRef<Char> &b) const
+  {
+    if (size_t(size_) != b.size()) {
+      return false;
+    }
+    for (int i = 0; i < size_; i++) {
+      if (data_[i] != b[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
   String operator+(const String &b) const
   {
     return String(*this).operator+=(b);
@@ -417,8 +454,14 @@ private:
 
       if (size < static_size - 1) {
         data2 = static_storage_;
+      } else if (data_ != static_storage_) {
+        /* Grow the heap buffer, in place when possible. */
+        data_ = alloc::reallocate_array<Char>(allocator_, "string", data_, size_ + 1,
+                                              size + 1);
+        return;
       } else {
-        data2 = static_cast<Char *>(alloc::alloc("string", size + 1));
+        data2 = static_cast<Char *>(
+            allocator_.allocate("string", sizeof(Char) * (size + 1)));
       }
 
       for (int i = 0; i < size_; i++) {
@@ -427,7 +470,7 @@ private:
       data2[size_] = 0;
 
       if (data_ != static_storage_) {
-        alloc::release(static_cast<void *>(data_));
+        allocator_.deallocate(static_cast<void *>(data_));
       }
       data_ = data2;
     }
@@ -436,6 +479,7 @@ private:
   Char *data_;
   int size_ = 0; /* does not include null-terminating byte. */
   Char static_storage_[static_size];
+  no_unique_addr Allocator allocator_;
 };
 
 template <typename Char> String<Char> operator+(const Char *a, const String<Char> &b)
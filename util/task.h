@@ -10,6 +10,7 @@
 #include "util/index_range.h"
 #include "util/vector.h"
 
+#include <algorithm>
 #include <chrono>
 #include <condition_variable>
 #include <functional>
@@ -227,14 +228,15 @@ template <typename Callback> static void run(Callback cb)
 /**
  * Splits @p range into @p grain_size chunks distributed across threads.
  *
- * Spawns up to platform::max_thread_count() threads, distributes chunks
- * round-robin, and blocks until all threads complete. Falls back to a
+ * Spawns up to platform::max_thread_count() threads, but no more than there
+ * are chunks, distributes chunks round-robin, and blocks until all threads
+ * complete. Falls back to a
  * single synchronous call when the range size is at or below @p grain_size.
  *
  * @p cb signature: `[&](IndexRange range) {}`
  */
 template <typename Callback>
-void parallel_for(util::IndexRange range, Callback cb, int grain_size = 1)
+void parallel_for(util::IndexRange range, Callback cb, util::IndexInt grain_size = 1)
 {
   using namespace util;
 
@@ -248,34 +250,34 @@ void parallel_for(util::IndexRange range, Callback cb, int grain_size = 1)
 
   bool have_remain = false;
 
-  int task_count = range.size / grain_size;
+  IndexInt task_count = range.size / grain_size;
   if (range.size % grain_size) {
     task_count++;
     have_remain = true;
   }
 
-  int thread_count = platform::max_thread_count();
+  /* No point starting threads that would get no tasks. */
+  int thread_count = int(std::min(IndexInt(platform::max_thread_count()), task_count));
 
   struct ThreadData {
     Vector<IndexRange> tasks;
-    bool done = false;
   };
 
   Vector<ThreadData> thread_datas;
   thread_datas.resize(thread_count);
   int thread_i = 0;
 
-  for (int i = 0; i < task_count; i++) {
-    int start = range.start + grain_size * i;
-    IndexRange range;
+  for (IndexInt i = 0; i < task_count; i++) {
+    IndexInt start = range.start + grain_size * i;
+    IndexRange task;
 
     if (i == task_count - 1 && have_remain) {
-      range = IndexRange(start, range.size - start);
+      task = IndexRange(start, range.start + range.size - start);
     } else {
-      range = IndexRange(start, grain_size);
+      task = IndexRange(start, grain_size);
     }
 
-    thread_datas[thread_i].tasks.append(range);
+    thread_datas[thread_i].tasks.append(task);
     thread_i = (thread_i + 1) % thread_count;
   }
 
@@ -287,27 +289,11 @@ void parallel_for(util::IndexRange range, Callback cb, int grain_size = 1)
                                   for (IndexRange &range : thread_datas[i].tasks) {
                                     cb(range);
                                   }
-
-                                  thread_datas[i].done = true;
                                 }));
 
     threads.append(thread);
   }
 
-  while (1) {
-    bool ok = true;
-    for (ThreadData &data : thread_datas) {
-      ok = ok && data.done;
-    }
-
-    if (ok) {
-      break;
-    }
-
-    /* TODO: use a condition variable. */
-    time::sleep_ns(100);
-  }
-
   for (std::thread *thread : threads) {
     thread->join();
     alloc::Delete<std::thread>(thread);
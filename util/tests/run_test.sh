@@ -1,4 +1,4 @@
 #!/usr/bin/env bash
 mkdir -p dist
-g++ $1 -o dist/$1.bin -I../.. -std=c++2a ../alloc.cc ../string.cc ../task.cc ../util.cc && ./dist/$1.bin
+g++ $1 -o dist/$1.bin -I../.. -std=c++2a ../alloc.cc ../alloc_engine.cc ../alloc_profile.cc ../alloc_stats.cc ../arena.cc ../pool.cc ../../platform/memory.cc ../string.cc ../task.cc ../util.cc && ./dist/$1.bin
 
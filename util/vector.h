@@ -1,14 +1,18 @@
 #pragma once
 #include "alloc.h"
+#include "allocator.h"
 #include "compiler_util.h"
 #include "concepts.h"
 #include "index_range.h"
+#include "simd_find.h"
 #include <algorithm>
 #include <concepts>
 #include <cstdint>
 #include <cstdio>
 #include <cstring>
 #include <initializer_list>
+#include <iterator>
+#include <memory>
 #include <ranges>
 #include <span>
 #include <type_traits>
@@ -45,6 +49,9 @@ template <typename T, VectorSortComparator<T> CB> struct Comparator {
     return cb(a, b) < 0;
   }
 };
+
+/** Defined in parallel_sort.h. */
+template <typename T> struct ParallelSort;
 } // namespace detail
 
 static constexpr int VectorDefaultStaticSize = 1;
@@ -52,27 +59,30 @@ static constexpr int VectorDefaultStaticSize = 1;
  * Small-buffer-optimized dynamic array.
  *
  * Stores up to @p static_size elements inline to avoid heap allocation.
- * Falls back to heap via alloc::alloc when the element count exceeds the
- * static capacity. Supports move semantics, range-based for loops, and
- * std::ranges algorithms.
+ * Falls back to heap via @p Allocator (alloc::alloc by default) when the
+ * element count exceeds the static capacity. Supports move semantics,
+ * range-based for loops, and std::ranges algorithms.
  */
-template <typename T, int static_size = VectorDefaultStaticSize>
+template <typename T,
+          int static_size = VectorDefaultStaticSize,
+          alloc::AllocatorPolicy Allocator = alloc::TaggedAllocator>
 class alignas(ContainerAlign<T>()) Vector {
 public:
   using value_type = T;
+  using allocator_type = Allocator;
 
   template <typename Iter> struct iterator_diff {
     flatten_inline iterator_diff()
     {
     }
-    flatten_inline iterator_diff(int i) : i_(i)
+    flatten_inline iterator_diff(IndexInt i) : i_(i)
     {
     }
     flatten_inline iterator_diff(const iterator_diff &b) : i_(b.i_)
     {
     }
 
-    operator int()
+    operator IndexInt()
     {
       return i_;
     }
@@ -82,7 +92,7 @@ public:
       i_ = b.i_;
       return *this;
     }
-    flatten_inline iterator_diff &operator=(int b)
+    flatten_inline iterator_diff &operator=(IndexInt b)
     {
       i_ = b;
       return *this;
@@ -96,7 +106,7 @@ public:
     {
       return iterator_diff(i_ + b.i_);
     }
-    flatten_inline iterator_diff operator+(int b) const
+    flatten_inline iterator_diff operator+(IndexInt b) const
     {
       return iterator_diff(i_ + b);
     }
@@ -110,7 +120,7 @@ public:
       i_ += b.i_;
       return *this;
     }
-    flatten_inline iterator_diff &operator+=(int b)
+    flatten_inline iterator_diff &operator+=(IndexInt b)
     {
       i_ += b;
       return *this;
@@ -124,7 +134,7 @@ public:
     {
       return iterator_diff(i_ - b.i_);
     }
-    flatten_inline iterator_diff operator-(int b) const
+    flatten_inline iterator_diff operator-(IndexInt b) const
     {
       return iterator_diff(i_ - b);
     }
@@ -138,7 +148,7 @@ public:
       i_ -= b.i_;
       return *this;
     }
-    flatten_inline iterator_diff &operator-=(int b)
+    flatten_inline iterator_diff &operator-=(IndexInt b)
     {
       i_ -= b;
       return *this;
@@ -149,23 +159,23 @@ public:
       return i_ <=> b.i_;
     }
 
-    flatten_inline int value() const
+    flatten_inline IndexInt value() const
     {
       return i_;
     }
 
   private:
-    int i_;
+    IndexInt i_;
   };
   template <typename QualifiedVector, typename QualT> struct iterator_base {
-    using difference_type = int;
+    using difference_type = IndexInt;
     using value_type = QualT;
 
     flatten_inline QualifiedVector &vector()
     {
       return *vec_;
     }
-    flatten_inline int index()
+    flatten_inline IndexInt index()
     {
       return i_;
     }
@@ -175,7 +185,7 @@ public:
     {
     }
 
-    flatten_inline iterator_base(QualifiedVector &vec, int i) : i_(i), vec_(&vec)
+    flatten_inline iterator_base(QualifiedVector &vec, IndexInt i) : i_(i), vec_(&vec)
     {
     }
 
@@ -218,7 +228,6 @@ public:
     // preincrement
     flatten_inline iterator_base &operator++()
     {
-      iterator_base a = 5 - *this;
       i_++;
       return *this;
     }
@@ -226,7 +235,7 @@ public:
     flatten_inline iterator_base operator++(int arg)
     {
       i_++;
-      return iterator_base(vec_, i_ - 1);
+      return iterator_base(*vec_, i_ - 1);
     }
     // preincrement
     flatten_inline iterator_base &operator--()
@@ -238,7 +247,7 @@ public:
     flatten_inline iterator_base operator--(int arg)
     {
       i_--;
-      return iterator_base(vec_, i_ + 1);
+      return iterator_base(*vec_, i_ + 1);
     }
 
     flatten_inline auto operator<=>(const iterator_base &b) const
@@ -257,34 +266,34 @@ public:
       return *this;
     }
 
-    flatten_inline QualT &operator[](int i) const
+    flatten_inline QualT &operator[](difference_type i) const
     {
-      return vec_->data_[i];
+      return vec_->data_[i_ + i];
     }
 
     friend difference_type operator-(const iterator_base &a, const iterator_base &b)
     {
       return a.i_ - b.i_;
     }
-    friend iterator_base operator+(int n, const iterator_base &b)
+    friend iterator_base operator+(difference_type n, const iterator_base &b)
     {
       return iterator_base(*b.vec_, n + b.i_);
     }
-    friend iterator_base operator+(const iterator_base &b, int n)
+    friend iterator_base operator+(const iterator_base &b, difference_type n)
     {
       return iterator_base(*b.vec_, b.i_ + n);
     }
-    friend iterator_base operator-(int n, const iterator_base &b)
+    friend iterator_base operator-(difference_type n, const iterator_base &b)
     {
       return iterator_base(*b.vec_, n - b.i_);
     }
-    friend iterator_base operator-(const iterator_base &b, int n)
+    friend iterator_base operator-(const iterator_base &b, difference_type n)
     {
       return iterator_base(*b.vec_, b.i_ - n);
     }
 
   private:
-    int i_;
+    IndexInt i_;
     QualifiedVector *vec_;
   };
 
@@ -296,7 +305,7 @@ public:
   flatten_inline Vector(std::initializer_list<T> list)
   {
     if (list.size() > static_size) {
-      data_ = static_cast<T *>(alloc::alloc("Vector data", sizeof(T) * list.size()));
+      data_ = alloc::allocate_array<T>(allocator_, "Vector data", list.size());
       capacity_ = size_ = list.size();
     } else {
       data_ = reinterpret_cast<T *>(static_storage_);
@@ -304,7 +313,7 @@ public:
     }
 
     size_ = list.size();
-    int i = 0;
+    size_t i = 0;
     for (auto &&item : list) {
       new (static_cast<void *>(data_ + i)) T(std::move(item));
       i++;
@@ -317,21 +326,21 @@ public:
    * allocated memory (or the local static
    * storage if `itemCount < static_size`).
    */
-  Vector(T *items, int itemCount)
+  Vector(T *items, size_t itemCount)
   {
     if (itemCount <= static_size) {
       capacity_ = static_size;
       size_ = 0;
       data_ = reinterpret_cast<T *>(static_storage_);
-      for (int i = 0; i < itemCount; i++) {
+      for (size_t i = 0; i < itemCount; i++) {
         this->append(std::move(items[i]));
       }
     } else {
-      data_ = static_cast<T *>(alloc::alloc("Vector data", sizeof(T) * itemCount));
+      data_ = alloc::allocate_array<T>(allocator_, "Vector data", itemCount);
       capacity_ = size_ = itemCount;
 
       if constexpr (!is_simple<T>()) {
-        for (int i = 0; i < itemCount; i++) {
+        for (size_t i = 0; i < itemCount; i++) {
           new (static_cast<void *>(data_ + i)) T(std::move(items[i]));
         }
       } else {
@@ -347,6 +356,17 @@ public:
     data_ = static_storage();
   }
 
+  explicit Vector(const Allocator &allocator)
+      : capacity_(static_size), allocator_(allocator)
+  {
+    data_ = static_storage();
+  }
+
+  const Allocator &get_allocator() const
+  {
+    return allocator_;
+  }
+
   operator span()
   {
     return std::span<T>(data_, size_);
@@ -364,18 +384,18 @@ public:
     }
   }
 
-  Vector(const Vector &b)
+  Vector(const Vector &b) : allocator_(b.allocator_)
   {
     size_ = b.size_;
     capacity_ = b.capacity_;
 
     if (size_ > static_size) {
-      data_ = static_cast<T *>(alloc::alloc("Vector", sizeof(T) * b.capacity_));
+      data_ = alloc::allocate_array<T>(allocator_, "Vector", b.capacity_);
     } else {
       data_ = static_storage();
     }
 
-    for (int i = 0; i < size_; i++) {
+    for (size_t i = 0; i < size_; i++) {
       // use copy constructor
       new (static_cast<void *>(data_ + i)) T(std::forward<T &>(b.data_[i]));
     }
@@ -405,6 +425,25 @@ public:
     std::ranges::sort(iterator(*this, 0), iterator(*this, size_), std::ranges::less());
   }
 
+  /**
+   * Sorts on up to @p thread_count threads (0 for platform::max_thread_count())
+   * with a parallel merge sort.  Small vectors are sorted serially.  Needs
+   * parallel_sort.h, which is kept out of this header since it pulls in task.h.
+   */
+  template <VectorSortComparator<T> CB> void parallel_sort(CB cb, int thread_count = 0)
+  {
+    detail::ParallelSort<T>::sort(
+        data_, size_, detail::Comparator<T, CB>(cb), false, thread_count);
+  }
+
+  /** parallel_sort() that keeps equal elements in their original order. */
+  template <VectorSortComparator<T> CB>
+  void parallel_stable_sort(CB cb, int thread_count = 0)
+  {
+    detail::ParallelSort<T>::sort(
+        data_, size_, detail::Comparator<T, CB>(cb), true, thread_count);
+  }
+
   bool hasStaticStorage() const
   {
     return data_ == reinterpret_cast<const T *>(static_storage_);
@@ -419,7 +458,7 @@ public:
 
     if (size_ == 0) {
       if (data_ && data_ != static_storage()) {
-        alloc::release(static_cast<void *>(data_));
+        allocator_.deallocate(static_cast<void *>(data_));
       }
 
       capacity_ = static_size;
@@ -439,11 +478,11 @@ public:
       newdata = static_storage();
     } else {
       capacity_ = size_;
-      newdata = static_cast<T *>(alloc::alloc("Vector", sizeof(T) * size_));
+      newdata = alloc::allocate_array<T>(allocator_, "Vector", size_);
     }
 
     if (!is_simple<T>()) {
-      for (int i = 0; i < size_; i++) {
+      for (size_t i = 0; i < size_; i++) {
         newdata[i] = std::move(data_[i]);
       }
 
@@ -453,7 +492,7 @@ public:
     }
 
     if (data_ != static_storage()) {
-      alloc::release(static_cast<void *>(data_));
+      allocator_.deallocate(static_cast<void *>(data_));
     }
 
     data_ = newdata;
@@ -469,7 +508,7 @@ public:
 
     resize<false>(b.size());
 
-    for (int i = 0; i < size_; i++) {
+    for (size_t i = 0; i < size_; i++) {
       data_[i] = b.data_[i];
     }
 
@@ -478,7 +517,7 @@ public:
 
   DEFAULT_MOVE_ASSIGNMENT(Vector)
 
-  Vector(Vector &&b)
+  Vector(Vector &&b) : allocator_(b.allocator_)
   {
     size_ = b.size_;
     capacity_ = b.capacity_;
@@ -486,7 +525,7 @@ public:
     if (size_ <= static_size) {
       data_ = static_storage();
 
-      for (int i = 0; i < size_; i++) {
+      for (size_t i = 0; i < size_; i++) {
         if constexpr (!is_simple<T>()) {
           new (static_cast<void *>(data_ + i)) T(std::move(b.data_[i]));
         } else {
@@ -495,7 +534,7 @@ public:
       }
 
       if (b.data_ && b.data_ != b.static_storage()) {
-        alloc::release(static_cast<void *>(b.data_));
+        allocator_.deallocate(static_cast<void *>(b.data_));
       }
     } else {
       data_ = b.data_;
@@ -546,10 +585,7 @@ public:
   T pop_front()
   {
     T ret = std::move(data_[0]);
-    for (int i = 0; i < size_ - 1; i++) {
-      data_[i] = std::move(data_[i + 1]);
-    }
-    size_--;
+    erase(IndexRange(0, 1));
     return ret;
   }
 
@@ -566,7 +602,7 @@ public:
 
   template <typename TArg> bool remove_intern(TArg value, bool swap_end_only = false)
   {
-    int i = index_of(value);
+    IndexInt i = index_of(value);
     if (i < 0) {
       fprintf(stderr, "Item not in list\n");
       return false;
@@ -575,39 +611,98 @@ public:
   }
 
   /** Removes the element at index @p i. See remove() for @p swap_end_only semantics. */
-  bool remove_at(int i, bool swap_end_only = false)
+  bool remove_at(IndexInt i, bool swap_end_only = false)
   {
-    if constexpr (!is_simple<T>()) {
-      data_[i].~T();
+    if (!swap_end_only) {
+      erase(IndexRange(i, 1));
+      return true;
     }
 
-    if (swap_end_only) {
+    if (size_t(i) != size_ - 1) {
       data_[i] = std::move(data_[size_ - 1]);
-    } else {
-      while (i < size_ - 1) {
-        data_[i] = std::move(data_[i + 1]);
-        i++;
-      }
+    }
+    destruct(size_ - 1, size_);
+    size_--;
+    return true;
+  }
 
-      /* Run end's destructor even though we moved its contents. */
-      if constexpr (!is_simple<T>()) {
-        data_[i].~T();
+  /**
+   * Removes the elements in @p range, shifting later elements down in one
+   * pass (a memmove for simple types).
+   */
+  void erase(IndexRange range)
+  {
+    const size_t start = size_t(range.start);
+    const size_t count = size_t(range.size);
+
+    if (count == 0) {
+      return;
+    }
+
+    if constexpr (is_simple<T>()) {
+      memmove(static_cast<void *>(data_ + start),
+              static_cast<const void *>(data_ + start + count),
+              sizeof(T) * (size_ - start - count));
+    } else {
+      for (size_t i = start; i + count < size_; i++) {
+        data_[i] = std::move(data_[i + count]);
       }
+      destruct(size_ - count, size_);
     }
 
-    size_--;
-    return true;
+    size_ -= count;
   }
 
-  int index_of(const T &value) const
+  /**
+   * Removes all elements for which @p pred returns true, keeping the order of
+   * the rest, in a single pass.  Returns the number of elements removed.
+   */
+  template <typename Pred> size_t remove_if(Pred pred)
   {
-    for (int i = 0; i < size_; i++) {
-      if (data_[i] == value) {
-        return i;
+    size_t kept = 0;
+
+    for (size_t i = 0; i < size_; i++) {
+      if (pred(std::as_const(data_[i]))) {
+        continue;
+      }
+      if (kept != i) {
+        data_[kept] = std::move(data_[i]);
       }
+      kept++;
     }
 
-    return -1;
+    const size_t removed = size_ - kept;
+    destruct(kept, size_);
+    size_ = kept;
+    return removed;
+  }
+
+  /**
+   * Returns the index of the first element equal to @p value, or -1.  Simple
+   * types are compared a SIMD register at a time, see simd_find.h.
+   */
+  IndexInt index_of(const T &value) const
+  {
+    return simd::find(std::span<const T>(data_, size_), value);
+  }
+
+  /** Number of elements equal to @p value. */
+  size_t count(const T &value) const
+  {
+    return simd::count(std::span<const T>(data_, size_), value);
+  }
+
+  /**
+   * Indices of all elements equal to @p value, in order.  See
+   * simd::find_mask for a bitmask instead.
+   */
+  Vector<IndexInt> find_all(const T &value) const
+  {
+    Vector<IndexInt> indices;
+    simd::for_each_match(std::span<const T>(data_, size_),
+                         value,
+                         [&](IndexInt i) { indices.append(i); });
+    return indices;
   }
 
   /** Appends @p value only if it is not already present (linear search). Returns true if
@@ -655,6 +750,111 @@ public:
     new (static_cast<void *>(&append_intern())) T(std::forward<T &&>(value));
   }
 
+  /**
+   * Appends copies of @p items, growing at most once.  @p items may point
+   * into this vector.
+   */
+  void extend(std::span<const T> items)
+  {
+    const size_t count = items.size();
+    const T *src = items.data();
+
+    if (count == 0) {
+      return;
+    }
+
+    if (overlaps(src, count)) {
+      /* Growing may move our elements, find them again afterwards. */
+      const size_t offset = size_t(src - data_);
+      ensure_size(size_ + count);
+      src = data_ + offset;
+    } else {
+      ensure_size(size_ + count);
+    }
+
+    copy_construct(data_ + size_, src, count);
+    size_ += count;
+  }
+
+  template <int other_static_size, alloc::AllocatorPolicy OtherAllocator>
+  void extend(const Vector<T, other_static_size, OtherAllocator> &b)
+  {
+    extend(std::span<const T>(b.data(), b.size()));
+  }
+
+  /**
+   * Appends the elements of [@p first, @p last), growing once for forward
+   * iterators.  Contiguous ranges of T go through extend(std::span) and may
+   * point into this vector; other iterators must not, since growing moves
+   * the elements they refer to.
+   */
+  template <std::input_iterator Iter, std::sentinel_for<Iter> Sentinel>
+  void extend(Iter first, Sentinel last)
+  {
+    if constexpr (std::contiguous_iterator<Iter> &&
+                  std::same_as<std::iter_value_t<Iter>, T>)
+    {
+      const size_t count = size_t(std::ranges::distance(first, last));
+      extend(std::span<const T>(std::to_address(first), count));
+    } else if constexpr (std::forward_iterator<Iter>) {
+      const size_t count = size_t(std::ranges::distance(first, last));
+      if (count == 0) {
+        return;
+      }
+
+      ensure_size(size_ + count);
+      for (T *dst = data_ + size_; first != last; ++first, ++dst) {
+        new (static_cast<void *>(dst)) T(*first);
+      }
+      size_ += count;
+    } else {
+      for (; first != last; ++first) {
+        append(*first);
+      }
+    }
+  }
+
+  /**
+   * Inserts copies of @p items before index @p index, shifting later
+   * elements up once (a memmove for simple types).
+   */
+  void insert(IndexInt index, std::span<const T> items)
+  {
+    const size_t count = items.size();
+
+    if (count == 0) {
+      return;
+    }
+
+    if (overlaps(items.data(), count)) {
+      Vector copy(allocator_);
+      copy.extend(items);
+      insert(index, std::span<const T>(copy.data(), count));
+      return;
+    }
+
+    ensure_size(size_ + count);
+    const size_t start = size_t(index);
+
+    if constexpr (is_simple<T>()) {
+      memmove(static_cast<void *>(data_ + start + count),
+              static_cast<const void *>(data_ + start),
+              sizeof(T) * (size_ - start));
+    } else {
+      for (size_t i = size_; i-- > start;) {
+        if (i + count >= size_) {
+          new (static_cast<void *>(data_ + i + count)) T(std::move(data_[i]));
+        } else {
+          data_[i + count] = std::move(data_[i]);
+        }
+      }
+      destruct(start, std::min(start + count, size_t(size_)));
+    }
+
+    copy_construct(data_ + start, items.data(), count);
+    size_ += count;
+  }
+
   /** Inserts @p value at the front, shifting all existing elements right. O(n). */
   void prepend(const T &value)
   {
@@ -689,7 +889,7 @@ public:
       remain = newsize - size_;
     } else if (newsize < size_) {
       if constexpr (construct_destruct && !is_simple<T>()) {
-        for (int i = newsize; i < size_; i++) {
+        for (size_t i = newsize; i < size_; i++) {
           data_[i].~T();
         }
       }
@@ -700,7 +900,7 @@ public:
 
     /* Construct new elements. */
     if constexpr (construct_destruct && !shrink_only) {
-      for (int i = 0; i < remain; i++) {
+      for (size_t i = 0; i < remain; i++) {
         if constexpr (!is_simple<T>()) {
           new (&data_[size_ - i - 1]) T;
         } else {
@@ -710,12 +910,12 @@ public:
     }
   }
 
-  T &operator[](int idx)
+  T &operator[](IndexInt idx)
   {
     return data_[idx];
   }
 
-  const T &operator[](int idx) const
+  const T &operator[](IndexInt idx) const
   {
     return data_[idx];
   }
@@ -735,21 +935,55 @@ public:
     return data_;
   }
 
+  const T *data() const
+  {
+    return data_;
+  }
+
   /** Reverses the vector in-place. Returns a reference to *this. */
-  Vector<T, static_size> &reverse()
+  Vector &reverse()
   {
-    int size = size_ >> 1;
-    for (int i = 0; i < size; i++) {
+    size_t size = size_ >> 1;
+    for (size_t i = 0; i < size; i++) {
       std::swap(data_[i], data_[size_ - i - 1]);
     }
     return *this;
   }
 
 private:
+  flatten_inline void destruct(size_t start, size_t end)
+  {
+    if constexpr (!is_simple<T>()) {
+      for (size_t i = start; i < end; i++) {
+        data_[i].~T();
+      }
+    }
+  }
+
+  static void copy_construct(T *dst, const T *src, size_t count)
+  {
+    if constexpr (is_simple<T>()) {
+      memcpy(static_cast<void *>(dst), static_cast<const void *>(src), sizeof(T) * count);
+    } else {
+      for (size_t i = 0; i < count; i++) {
+        new (static_cast<void *>(dst + i)) T(src[i]);
+      }
+    }
+  }
+
+  /** Returns true if [@p ptr, @p ptr + @p count) overlaps our elements. */
+  bool overlaps(const T *ptr, size_t count) const
+  {
+    const uintptr_t start = uintptr_t(ptr);
+    const uintptr_t data = uintptr_t(data_);
+
+    return start < data + sizeof(T) * size_ && start + sizeof(T) * count > data;
+  }
+
   flatten_inline void deconstruct_all()
   {
     if constexpr (!is_simple<T>()) {
-      for (int i = 0; i < size_; i++) {
+      for (size_t i = 0; i < size_; i++) {
         data_[i].~T();
       }
     }
@@ -763,7 +997,7 @@ private:
       memmove(
           static_cast<void *>(data_), static_cast<void *>(data_ + 1), sizeof(T) * size_);
     } else {
-      for (int i = size_; i > 0; i--) {
+      for (size_t i = size_; i > 0; i--) {
         data_[i] = std::move(data_[i - 1]);
       }
     }
@@ -790,16 +1024,25 @@ private:
 
     size_t new_capacity = (newsize + 1) << 1;
     new_capacity -= newsize >> 1;
-    capacity_ = new_capacity;
     T *old = data_;
 
-    data_ = static_cast<T *>(
-        static_cast<void *>(alloc::alloc("Vector data", new_capacity * sizeof(T))));
+    if constexpr (is_simple<T>()) {
+      /* Heap storage can often grow in place (or be remapped) instead of copied. */
+      if (old != static_storage()) {
+        data_ = alloc::reallocate_array<T>(allocator_, "Vector data", old, capacity_,
+                                           new_capacity);
+        capacity_ = new_capacity;
+        return;
+      }
+    }
+
+    capacity_ = new_capacity;
+    data_ = alloc::allocate_array<T>(allocator_, "Vector data", new_capacity);
 
     if constexpr (is_simple<T>()) {
       memcpy(static_cast<void *>(data_), static_cast<void *>(old), sizeof(T) * size_);
     } else {
-      for (int i = 0; i < size_; i++) {
+      for (size_t i = 0; i < size_; i++) {
         new (static_cast<void *>(data_ + i)) T(std::move(old[i]));
       }
     }
@@ -807,17 +1050,17 @@ private:
     release_data(old, size_);
   }
 
-  ATTR_NO_OPT void release_data(T *old, int size)
+  ATTR_NO_OPT void release_data(T *old, size_t size)
   {
     if constexpr (!is_simple<T>()) {
       /* Run destructors. */
-      for (int i = 0; i < size; i++) {
+      for (size_t i = 0; i < size; i++) {
         old[i].~T();
       }
     }
 
     if (old && old != static_storage()) {
-      alloc::release(static_cast<void *>(old));
+      allocator_.deallocate(static_cast<void *>(old));
     }
   }
 
@@ -829,12 +1072,13 @@ private:
   T *data_ = nullptr;
   size_t size_ = 0;
   size_t capacity_ = 0;
+  no_unique_addr Allocator allocator_;
 #ifdef WASM
   // pad to eight bytes
   // since pointer size is 4 on WASM.
   int _pad;
 #endif
-  uint8_t static_storage_[static_size * sizeof(T)];
+  alignas(T) uint8_t static_storage_[static_size * sizeof(T)];
 };
 
 } // namespace litestl::util
\ No newline at end of file